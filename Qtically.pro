@@ -1,6 +1,8 @@
 QT       += core gui
 QT       += multimedia
 QT       += widgets
+QT       += concurrent
+QT       += network
 
 
 greaterThan(QT_MAJOR_VERSION, 4): QT += widgets
@@ -12,15 +14,69 @@ CONFIG += c++11
 #DEFINES += QT_DISABLE_DEPRECATED_BEFORE=0x060000    # disables all the APIs deprecated before Qt 6.0.0
 
 SOURCES += \
+    albumgridmodel.cpp \
+    albumgridwindow.cpp \
+    coverloader.cpp \
+    cuesheet.cpp \
+    durationprober.cpp \
+    fuzzymatcher.cpp \
+    healthchecker.cpp \
+    journal.cpp \
     main.cpp \
+    memorydialog.cpp \
+    memorymonitor.cpp \
+    pathtable.cpp \
+    playhistory.cpp \
+    playlists.cpp \
+    prefetcher.cpp \
     qticallymainwindow.cpp \
-    settingsdialog.cpp
+    settingsdialog.cpp \
+    singleinstance.cpp \
+    smartplaylists.cpp \
+    spectrumanalyzer.cpp \
+    spectrumwidget.cpp \
+    tagreader.cpp \
+    taskscheduler.cpp \
+    thumbnailloader.cpp \
+    trackmodel.cpp \
+    trackquery.cpp \
+    trackstore.cpp \
+    wavheader.cpp \
+    wavplayer.cpp
 
 HEADERS += \
+    albumgridmodel.h \
+    albumgridwindow.h \
+    coverloader.h \
+    cuesheet.h \
+    durationprober.h \
+    fuzzymatcher.h \
+    healthchecker.h \
+    journal.h \
+    memorydialog.h \
+    memorymonitor.h \
+    pathtable.h \
+    playhistory.h \
+    playlists.h \
+    prefetcher.h \
     qticallymainwindow.h \
-    settingsdialog.h
+    settingsdialog.h \
+    singleinstance.h \
+    smartplaylists.h \
+    spectrumanalyzer.h \
+    spectrumwidget.h \
+    tagreader.h \
+    taskscheduler.h \
+    thumbnailloader.h \
+    trackmodel.h \
+    trackquery.h \
+    trackstore.h \
+    wavheader.h \
+    wavplayer.h
 
 FORMS += \
+    albumgridwindow.ui \
+    memorydialog.ui \
     qticallymainwindow.ui \
     settingsdialog.ui
 
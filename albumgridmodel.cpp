@@ -0,0 +1,133 @@
+#include "albumgridmodel.h"
+#include "thumbnailloader.h"
+#include "trackstore.h"
+#include <QCollator>
+#include <algorithm>
+
+namespace {
+
+// Quelques dossiers suffisent pour trouver une pochette
+const int maxSourceFolders = 3;
+
+QString quoted(QString value)
+{
+    return '"' + value.remove('"') + '"';
+}
+
+}
+
+AlbumGridModel::AlbumGridModel(ThumbnailLoader *loader, QObject *parent)
+    : QAbstractListModel(parent)
+    , loader(loader)
+{
+    placeholder = QImage(loader->thumbnailSize(), QImage::Format_ARGB32_Premultiplied);
+    placeholder.fill(QColor(60, 60, 60));
+    connect(loader, &ThumbnailLoader::thumbnailReady, this, &AlbumGridModel::thumbnailReady);
+}
+
+void AlbumGridModel::rebuild(const TrackStore *store, Grouping grouping, const QMap<QString, QString> &customImages)
+{
+    beginResetModel();
+    groups.clear();
+    rows.clear();
+
+    for (int track : store->ids()) {
+        const QString path = store->path(track);
+        const QString folder = path.left(path.lastIndexOf('/'));
+        const QString album = store->album(track);
+
+        // Sans album connu, la piste rejoint le groupe de son dossier
+        const bool byAlbum = grouping == ByAlbum && !album.isEmpty();
+        const QString key = byAlbum ? "album:" + album : "folder:" + folder;
+        QHash<QString, int>::const_iterator it = rows.constFind(key);
+        int index;
+        if (it == rows.constEnd()) {
+            index = groups.size();
+            rows.insert(key, index);
+            Group group;
+            group.key = key;
+            group.name = byAlbum ? album : folder.mid(folder.lastIndexOf('/') + 1);
+            group.query = byAlbum ? "album:" + quoted(album) : "path:" + quoted(folder + '/');
+            groups.append(group);
+        } else {
+            index = it.value();
+        }
+
+        Group &group = groups[index];
+        ++group.trackCount;
+        const QString custom = customImages.value(store->title(track));
+        if (!custom.isEmpty() && !group.sources.contains(custom)) {
+            group.sources.prepend(custom);
+        }
+        if (!group.sources.contains(folder) && group.sources.size() < maxSourceFolders) {
+            group.sources.append(folder);
+        }
+    }
+
+    QCollator collator;
+    collator.setNumericMode(true);
+    collator.setCaseSensitivity(Qt::CaseInsensitive);
+    std::sort(groups.begin(), groups.end(), [&collator](const Group &a, const Group &b) {
+        return collator.compare(a.name, b.name) < 0;
+    });
+    for (int i = 0; i < groups.size(); ++i) {
+        rows.insert(groups.at(i).key, i);
+    }
+    endResetModel();
+}
+
+int AlbumGridModel::rowCount(const QModelIndex &parent) const
+{
+    return parent.isValid() ? 0 : groups.size();
+}
+
+QVariant AlbumGridModel::data(const QModelIndex &index, int role) const
+{
+    if (!index.isValid() || index.row() >= groups.size()) {
+        return QVariant();
+    }
+
+    const Group &group = groups.at(index.row());
+    switch (role) {
+    case Qt::DisplayRole:
+        return group.name;
+    case Qt::ToolTipRole:
+        return QString("%1 — %2 pistes").arg(group.name).arg(group.trackCount);
+    case Qt::DecorationRole: {
+        // Case affichée : la vignette est demandée si elle n'est pas prête
+        const QImage thumbnail = loader->thumbnail(group.key);
+        if (!thumbnail.isNull()) {
+            return thumbnail;
+        }
+        loader->request(group.key, group.sources);
+        return placeholder;
+    }
+    case QueryRole:
+        return group.query;
+    case KeyRole:
+        return group.key;
+    default:
+        return QVariant();
+    }
+}
+
+QString AlbumGridModel::keyAt(int row) const
+{
+    return row >= 0 && row < groups.size() ? groups.at(row).key : QString();
+}
+
+void AlbumGridModel::requestThumbnail(int row) const
+{
+    if (row >= 0 && row < groups.size() && loader->thumbnail(groups.at(row).key).isNull()) {
+        loader->request(groups.at(row).key, groups.at(row).sources);
+    }
+}
+
+void AlbumGridModel::thumbnailReady(const QString &key)
+{
+    const int row = rows.value(key, -1);
+    if (row >= 0) {
+        const QModelIndex changed = index(row);
+        emit dataChanged(changed, changed, QVector<int>() << Qt::DecorationRole);
+    }
+}
@@ -0,0 +1,60 @@
+#ifndef ALBUMGRIDMODEL_H
+#define ALBUMGRIDMODEL_H
+
+#include <QAbstractListModel>
+#include <QHash>
+#include <QImage>
+#include <QMap>
+#include <QVector>
+#include <QStringList>
+
+class TrackStore;
+class ThumbnailLoader;
+
+// Pistes regroupées par album ou par dossier, une case par groupe. La
+// pochette n'est demandée qu'au moment où la vue affiche la case.
+class AlbumGridModel : public QAbstractListModel
+{
+    Q_OBJECT
+
+public:
+    enum Grouping {
+        ByAlbum = 0,
+        ByFolder
+    };
+
+    enum Roles {
+        QueryRole = Qt::UserRole,
+        KeyRole
+    };
+
+    explicit AlbumGridModel(ThumbnailLoader *loader, QObject *parent = nullptr);
+
+    // Pochettes personnalisées : chemin de l'image par titre de piste
+    void rebuild(const TrackStore *store, Grouping grouping, const QMap<QString, QString> &customImages);
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+
+    QString keyAt(int row) const;
+    void requestThumbnail(int row) const;
+
+private slots:
+    void thumbnailReady(const QString &key);
+
+private:
+    struct Group {
+        QString name;
+        QString key;
+        QString query;
+        QStringList sources;
+        int trackCount = 0;
+    };
+
+    ThumbnailLoader *loader;
+    QVector<Group> groups;
+    QHash<QString, int> rows;
+    QImage placeholder;
+};
+
+#endif // ALBUMGRIDMODEL_H
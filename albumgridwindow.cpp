@@ -0,0 +1,100 @@
+#include "albumgridwindow.h"
+#include "ui_albumgridwindow.h"
+#include <QScrollBar>
+#include <QSet>
+
+namespace {
+
+const QSize thumbnailSize(128, 128);
+const QSize cellSize(150, 180);
+
+}
+
+AlbumGridWindow::AlbumGridWindow(const TrackStore *store, QWidget *parent)
+    : QDialog(parent)
+    , ui(new Ui::AlbumGridWindow)
+    , store(store)
+{
+    ui->setupUi(this);
+
+    loader = new ThumbnailLoader(thumbnailSize, this);
+    model = new AlbumGridModel(loader, this);
+    ui->albumView->setModel(model);
+    ui->albumView->setIconSize(thumbnailSize);
+    ui->albumView->setGridSize(cellSize);
+
+    connect(ui->groupingSelector, QOverload<int>::of(&QComboBox::currentIndexChanged), this, [this]() {
+        refresh(customImages);
+    });
+    connect(ui->albumView->verticalScrollBar(), &QScrollBar::valueChanged, this, &AlbumGridWindow::updateVisibleRange);
+    connect(ui->albumView, &QListView::activated, this, &AlbumGridWindow::activated);
+}
+
+AlbumGridWindow::~AlbumGridWindow()
+{
+    delete ui;
+}
+
+void AlbumGridWindow::refresh(const QMap<QString, QString> &images)
+{
+    customImages = images;
+    model->rebuild(store, AlbumGridModel::Grouping(ui->groupingSelector->currentIndex()), customImages);
+    updateVisibleRange();
+}
+
+qint64 AlbumGridWindow::memoryUsage() const
+{
+    return loader->memoryUsage();
+}
+
+void AlbumGridWindow::setCacheLimit(qint64 bytes)
+{
+    loader->setCacheLimit(bytes);
+}
+
+void AlbumGridWindow::updateVisibleRange()
+{
+    // Cases visibles, plus un écran au-dessus et au-dessous
+    QListView *view = ui->albumView;
+    const QRect viewport = view->viewport()->rect();
+    const int columns = qMax(1, viewport.width() / cellSize.width());
+    const int screenRows = viewport.height() / cellSize.height() + 1;
+
+    QModelIndex first = view->indexAt(viewport.topLeft() + QPoint(cellSize.width() / 2, cellSize.height() / 2));
+    if (!first.isValid()) {
+        first = view->indexAt(QPoint(1, 1));
+    }
+    const int firstRow = first.isValid() ? first.row() : 0;
+    const int begin = qMax(0, firstRow - screenRows * columns);
+    const int end = qMin(model->rowCount(), firstRow + 2 * screenRows * columns);
+
+    QSet<QString> keys;
+    for (int row = begin; row < end; ++row) {
+        keys.insert(model->keyAt(row));
+    }
+    loader->retain(keys);
+
+    // La dernière demande passe en premier : les cases visibles à la fin
+    const int visibleEnd = qMin(end, firstRow + screenRows * columns);
+    for (int row = begin; row < end; ++row) {
+        if (row < firstRow || row >= visibleEnd) {
+            model->requestThumbnail(row);
+        }
+    }
+    for (int row = visibleEnd - 1; row >= firstRow; --row) {
+        model->requestThumbnail(row);
+    }
+}
+
+void AlbumGridWindow::resizeEvent(QResizeEvent *event)
+{
+    QDialog::resizeEvent(event);
+    updateVisibleRange();
+}
+
+void AlbumGridWindow::activated(const QModelIndex &index)
+{
+    if (index.isValid()) {
+        emit groupActivated(index.data(AlbumGridModel::QueryRole).toString());
+    }
+}
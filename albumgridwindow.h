@@ -0,0 +1,48 @@
+#ifndef ALBUMGRIDWINDOW_H
+#define ALBUMGRIDWINDOW_H
+
+#include <QDialog>
+#include <QMap>
+#include "albumgridmodel.h"
+#include "thumbnailloader.h"
+
+namespace Ui {
+class AlbumGridWindow;
+}
+
+class TrackStore;
+
+// Grille des albums ou des dossiers. Seules les cases visibles et celles d'un
+// écran autour ont des vignettes en préparation ; le reste est abandonné.
+class AlbumGridWindow : public QDialog
+{
+    Q_OBJECT
+
+public:
+    explicit AlbumGridWindow(const TrackStore *store, QWidget *parent = nullptr);
+    ~AlbumGridWindow();
+
+    void refresh(const QMap<QString, QString> &customImages);
+    qint64 memoryUsage() const;
+    void setCacheLimit(qint64 bytes);
+
+protected:
+    void resizeEvent(QResizeEvent *event) override;
+
+signals:
+    // Requête de recherche qui affiche les pistes du groupe
+    void groupActivated(const QString &query);
+
+private slots:
+    void updateVisibleRange();
+    void activated(const QModelIndex &index);
+
+private:
+    Ui::AlbumGridWindow *ui;
+    const TrackStore *store;
+    ThumbnailLoader *loader;
+    AlbumGridModel *model;
+    QMap<QString, QString> customImages;
+};
+
+#endif // ALBUMGRIDWINDOW_H
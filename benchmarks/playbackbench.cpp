@@ -0,0 +1,543 @@
+#include "wavplayer.h"
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QAudioDecoder>
+#include <QAudioProbe>
+#include <QMediaPlayer>
+#include <QDirIterator>
+#include <QElapsedTimer>
+#include <QEventLoop>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QTextStream>
+#include <QTimer>
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <vector>
+
+// Allocations du thread principal : celles des threads du backend ne sont pas
+// imputées aux étapes mesurées ici
+namespace {
+thread_local qint64 allocationCount = 0;
+}
+
+void *operator new(std::size_t size)
+{
+    ++allocationCount;
+    if (void *p = std::malloc(size ? size : 1)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void *operator new[](std::size_t size)
+{
+    return operator new(size);
+}
+
+void operator delete(void *p) noexcept
+{
+    std::free(p);
+}
+
+void operator delete[](void *p) noexcept
+{
+    std::free(p);
+}
+
+void operator delete(void *p, std::size_t) noexcept
+{
+    std::free(p);
+}
+
+void operator delete[](void *p, std::size_t) noexcept
+{
+    std::free(p);
+}
+
+namespace {
+
+const int blockFrames = 4096;
+const float gain = 0.8f;
+const int clickRuns = 5;
+const int clickTimeoutMs = 5000;
+const qint64 wavRefused = -2;
+
+enum Stage {
+    Decode = 0,
+    Dsp,
+    Sink,
+    StageCount
+};
+
+const char *const stageNames[StageCount] = { "décodage", "traitement", "sortie" };
+
+struct Results {
+    qint64 samples = 0;          // échantillons par canal
+    qint64 audioMs = 0;
+    qint64 wallNs = 0;
+    qint64 stageNs[StageCount] = { 0, 0, 0 };
+    qint64 stageAllocations[StageCount] = { 0, 0, 0 };
+    std::vector<qint64> deliveryNs;  // écart entre deux tampons livrés à la sortie
+    int files = 0;
+    int wavPlayerFiles = 0;      // WAV lus par WavPlayer plutôt que par le décodeur
+    int failures = 0;
+};
+
+// Sortie factice : recopie dans un anneau comme le ferait un tampon de périphérique
+class NullSink
+{
+public:
+    NullSink() : buffer(1 << 16), position(0), checksum(0) {}
+
+    void write(const float *data, int count)
+    {
+        while (count > 0) {
+            const int chunk = qMin(count, int(buffer.size()) - position);
+            std::memcpy(buffer.data() + position, data, size_t(chunk) * sizeof(float));
+            position = (position + chunk) % int(buffer.size());
+            data += chunk;
+            count -= chunk;
+        }
+        quint32 bits;
+        std::memcpy(&bits, &buffer[size_t(position == 0 ? buffer.size() - 1 : position - 1)], sizeof(bits));
+        checksum ^= bits;
+    }
+
+    quint32 sum() const { return checksum; }
+
+private:
+    std::vector<float> buffer;
+    int position;
+    quint32 checksum;
+};
+
+// Conversion en flottants et gain avec écrêtage ; le tampon ne grandit qu'au besoin
+class Pipeline
+{
+public:
+    explicit Pipeline(Results *results) : results(results), hasLast(false) {}
+
+    void process(const char *data, int frames, int channels, int bytesPerSample, bool isFloat, bool isUnsigned)
+    {
+        QElapsedTimer timer;
+        timer.start();
+        qint64 allocations = allocationCount;
+
+        const int count = frames * channels;
+        if (int(samples.size()) < count) {
+            samples.resize(size_t(count));
+        }
+        float *out = samples.data();
+        if (isFloat && bytesPerSample == 4) {
+            std::memcpy(out, data, size_t(count) * sizeof(float));
+        } else if (bytesPerSample == 2) {
+            const qint16 *in = reinterpret_cast<const qint16 *>(data);
+            for (int i = 0; i < count; ++i) {
+                out[i] = in[i] * (1.0f / 32768.0f);
+            }
+        } else if (bytesPerSample == 4) {
+            const qint32 *in = reinterpret_cast<const qint32 *>(data);
+            for (int i = 0; i < count; ++i) {
+                out[i] = float(in[i]) * (1.0f / 2147483648.0f);
+            }
+        } else if (bytesPerSample == 3) {
+            const uchar *in = reinterpret_cast<const uchar *>(data);
+            for (int i = 0; i < count; ++i) {
+                const qint32 value = qint32(quint32(in[3 * i]) << 8 | quint32(in[3 * i + 1]) << 16 | quint32(in[3 * i + 2]) << 24);
+                out[i] = float(value) * (1.0f / 2147483648.0f);
+            }
+        } else if (bytesPerSample == 1) {
+            const uchar *in = reinterpret_cast<const uchar *>(data);
+            for (int i = 0; i < count; ++i) {
+                out[i] = (float(in[i]) - (isUnsigned ? 128.0f : 0.0f)) * (1.0f / 128.0f);
+            }
+        }
+        for (int i = 0; i < count; ++i) {
+            out[i] = qBound(-1.0f, out[i] * gain, 1.0f);
+        }
+        results->stageNs[Dsp] += timer.nsecsElapsed();
+        results->stageAllocations[Dsp] += allocationCount - allocations;
+
+        timer.restart();
+        allocations = allocationCount;
+        sink.write(out, count);
+        results->stageNs[Sink] += timer.nsecsElapsed();
+        results->stageAllocations[Sink] += allocationCount - allocations;
+
+        if (hasLast) {
+            results->deliveryNs.push_back(delivery.nsecsElapsed());
+        }
+        delivery.restart();
+        hasLast = true;
+        results->samples += frames;
+    }
+
+    void startFile()
+    {
+        hasLast = false;
+    }
+
+    quint32 checksum() const { return sink.sum(); }
+
+private:
+    Results *results;
+    std::vector<float> samples;
+    NullSink sink;
+    QElapsedTimer delivery;
+    bool hasLast;
+};
+
+}
+
+// Accès au chemin réel des WAV : projection, conversion éventuelle dans le tampon
+struct WavPlayerBench
+{
+    static qint64 read(WavPlayer &player, char *data, qint64 maxSize)
+    {
+        return player.readFrames(data, maxSize);
+    }
+
+    static const QAudioFormat &format(const WavPlayer &player)
+    {
+        return player.outputFormat;
+    }
+};
+
+namespace {
+
+// Comme playSelectedMusic : faux si WavPlayer refuse le fichier, qui passe alors par le décodeur
+bool runWav(const QString &fileName, Pipeline *pipeline, Results *results)
+{
+    WavPlayer player;
+    QElapsedTimer timer;
+    timer.start();
+    qint64 allocations = allocationCount;
+    const bool opened = player.open(fileName);
+    results->stageNs[Decode] += timer.nsecsElapsed();
+    results->stageAllocations[Decode] += allocationCount - allocations;
+    if (!opened) {
+        return false;
+    }
+
+    const QAudioFormat &format = WavPlayerBench::format(player);
+    const int frameBytes = format.bytesPerFrame();
+    QByteArray block(blockFrames * frameBytes, Qt::Uninitialized);
+    for (;;) {
+        timer.restart();
+        allocations = allocationCount;
+        const qint64 read = WavPlayerBench::read(player, block.data(), block.size());
+        results->stageNs[Decode] += timer.nsecsElapsed();
+        results->stageAllocations[Decode] += allocationCount - allocations;
+        if (read < frameBytes) {
+            break;
+        }
+        pipeline->process(block.constData(), int(read / frameBytes), format.channelCount(), format.sampleSize() / 8,
+                          format.sampleType() == QAudioFormat::Float, format.sampleType() == QAudioFormat::UnSignedInt);
+    }
+    results->audioMs += player.duration();
+    ++results->wavPlayerFiles;
+    return true;
+}
+
+bool runDecoder(const QString &fileName, Pipeline *pipeline, Results *results)
+{
+    // Le décodeur du backend multimédia, le même que celui du lecteur
+    QAudioDecoder decoder;
+    QEventLoop loop;
+    bool ok = true;
+    qint64 frames = 0;
+    int sampleRate = 0;
+    QElapsedTimer waiting;
+
+    QObject::connect(&decoder, &QAudioDecoder::bufferReady, [&]() {
+        results->stageNs[Decode] += waiting.nsecsElapsed();
+        QElapsedTimer timer;
+        timer.start();
+        const qint64 allocations = allocationCount;
+        const QAudioBuffer buffer = decoder.read();
+        results->stageNs[Decode] += timer.nsecsElapsed();
+        results->stageAllocations[Decode] += allocationCount - allocations;
+
+        const QAudioFormat format = buffer.format();
+        if (buffer.isValid() && format.channelCount() > 0) {
+            pipeline->process(buffer.constData<char>(), buffer.frameCount(), format.channelCount(), format.sampleSize() / 8,
+                              format.sampleType() == QAudioFormat::Float, format.sampleType() == QAudioFormat::UnSignedInt);
+            frames += buffer.frameCount();
+            sampleRate = format.sampleRate();
+        }
+        waiting.restart();
+    });
+    QObject::connect(&decoder, &QAudioDecoder::finished, &loop, &QEventLoop::quit);
+    QObject::connect(&decoder, QOverload<QAudioDecoder::Error>::of(&QAudioDecoder::error), [&]() {
+        ok = false;
+        loop.quit();
+    });
+
+    decoder.setSourceFilename(fileName);
+    waiting.start();
+    decoder.start();
+    loop.exec();
+
+    if (sampleRate > 0) {
+        results->audioMs += frames * 1000 / sampleRate;
+    }
+    return ok && frames > 0;
+}
+
+// WAV du lecteur : open puis play, jusqu'au premier tampon tiré par la sortie.
+// wavRefused si WavPlayer refuse le fichier, -1 sans premier tampon
+qint64 clickWavPlayer(const QString &fileName)
+{
+    WavPlayer player;
+    player.setProbing(true);
+    QEventLoop loop;
+    QElapsedTimer timer;
+    qint64 latency = -1;
+
+    const auto firstSample = [&]() {
+        if (latency < 0) {
+            latency = timer.nsecsElapsed();
+            loop.quit();
+        }
+    };
+    QObject::connect(&player, &WavPlayer::audioBufferProbed, firstSample);
+    QObject::connect(&player, &WavPlayer::positionChanged, [&](qint64 position) {
+        if (position > 0) {
+            firstSample();
+        }
+    });
+    QObject::connect(&player, &WavPlayer::mediaStatusChanged, [&](QMediaPlayer::MediaStatus status) {
+        if (status == QMediaPlayer::InvalidMedia) {
+            loop.quit();
+        }
+    });
+    QTimer::singleShot(clickTimeoutMs, &loop, &QEventLoop::quit);
+
+    timer.start();
+    if (!player.open(fileName)) {
+        return wavRefused;
+    }
+    player.play();
+    // La sortie peut tirer son premier tampon dès play
+    if (latency < 0) {
+        loop.exec();
+    }
+    player.stop();
+    return latency;
+}
+
+// Chemin de playSelectedMusic : WavPlayer pour les WAV qu'il accepte, sinon
+// setMedia puis play, jusqu'au premier tampon entendu
+QVector<qint64> measureClickToFirstSample(const QString &fileName)
+{
+    QVector<qint64> latencies;
+    const bool wav = fileName.endsWith(".wav", Qt::CaseInsensitive);
+    for (int run = 0; run < clickRuns; ++run) {
+        if (wav) {
+            const qint64 latency = clickWavPlayer(fileName);
+            if (latency != wavRefused) {
+                if (latency < 0) {
+                    break;
+                }
+                latencies.append(latency);
+                continue;
+            }
+        }
+
+        QMediaPlayer player;
+        QAudioProbe probe;
+        probe.setSource(&player);
+        QEventLoop loop;
+        QElapsedTimer timer;
+        qint64 latency = -1;
+
+        const auto firstSample = [&]() {
+            if (latency < 0) {
+                latency = timer.nsecsElapsed();
+                loop.quit();
+            }
+        };
+        QObject::connect(&probe, &QAudioProbe::audioBufferProbed, firstSample);
+        QObject::connect(&player, &QMediaPlayer::positionChanged, [&](qint64 position) {
+            if (position > 0) {
+                firstSample();
+            }
+        });
+        QObject::connect(&player, QOverload<QMediaPlayer::Error>::of(&QMediaPlayer::error), &loop, &QEventLoop::quit);
+        QTimer::singleShot(clickTimeoutMs, &loop, &QEventLoop::quit);
+
+        timer.start();
+        player.setMedia(QUrl::fromLocalFile(fileName));
+        player.setVolume(0);
+        player.play();
+        loop.exec();
+        player.stop();
+
+        if (latency < 0) {
+            break;
+        }
+        latencies.append(latency);
+    }
+    return latencies;
+}
+
+qint64 percentile(std::vector<qint64> values, double fraction)
+{
+    if (values.empty()) {
+        return 0;
+    }
+    const size_t index = qMin(values.size() - 1, size_t(fraction * (values.size() - 1) + 0.5));
+    std::nth_element(values.begin(), values.begin() + long(index), values.end());
+    return values[index];
+}
+
+QStringList collectFiles(const QStringList &arguments)
+{
+    QStringList files;
+    for (const QString &argument : arguments) {
+        const QFileInfo info(argument);
+        if (info.isDir()) {
+            QDirIterator it(argument, QStringList() << "*.mp3" << "*.wav", QDir::Files, QDirIterator::Subdirectories);
+            while (it.hasNext()) {
+                files.append(it.next());
+            }
+        } else if (info.isFile()) {
+            files.append(info.absoluteFilePath());
+        }
+    }
+    files.sort();
+    return files;
+}
+
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName("playbackbench");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Mesure la chaîne décodage → traitement → sortie sans carte son.");
+    parser.addHelpOption();
+    parser.addPositionalArgument("corpus", "Fichiers MP3/WAV ou dossiers à parcourir.");
+    QCommandLineOption runsOption("runs", "Nombre de passages sur le corpus.", "n", "1");
+    QCommandLineOption jsonOption("json", "Écrit aussi les résultats en JSON.", "fichier");
+    QCommandLineOption minRealtimeOption("min-realtime", "Échec si le facteur temps réel est inférieur.", "facteur");
+    QCommandLineOption maxTailOption("max-p99-us", "Échec si le 99e centile de livraison dépasse cette valeur.", "µs");
+    QCommandLineOption maxClickOption("max-click-ms", "Échec si le délai clic → premier échantillon dépasse cette valeur.", "ms");
+    QCommandLineOption noClickOption("no-click", "Ne mesure pas le délai clic → premier échantillon.");
+    parser.addOptions({ runsOption, jsonOption, minRealtimeOption, maxTailOption, maxClickOption, noClickOption });
+    parser.process(app);
+
+    QTextStream out(stdout);
+    const QStringList files = collectFiles(parser.positionalArguments());
+    if (files.isEmpty()) {
+        out << "Aucun fichier MP3/WAV trouvé.\n";
+        return 2;
+    }
+
+    Results results;
+    Pipeline pipeline(&results);
+    const int runs = qMax(1, parser.value(runsOption).toInt());
+    QElapsedTimer wall;
+    wall.start();
+    for (int run = 0; run < runs; ++run) {
+        for (const QString &fileName : files) {
+            pipeline.startFile();
+            const bool ok = (fileName.endsWith(".wav", Qt::CaseInsensitive) && runWav(fileName, &pipeline, &results))
+                    || runDecoder(fileName, &pipeline, &results);
+            ++results.files;
+            if (!ok) {
+                ++results.failures;
+            }
+        }
+    }
+    results.wallNs = wall.nsecsElapsed();
+
+    const double realtime = results.wallNs > 0 ? double(results.audioMs) * 1e6 / double(results.wallNs) : 0;
+    QJsonObject report;
+    report["files"] = results.files;
+    report["wavPlayerFiles"] = results.wavPlayerFiles;
+    report["failures"] = results.failures;
+    report["audioMs"] = results.audioMs;
+    report["wallMs"] = results.wallNs / 1000000;
+    report["realtimeFactor"] = realtime;
+
+    out << QString("Fichiers : %1 (%2 échecs), audio : %3 s, durée : %4 s\n")
+           .arg(results.files).arg(results.failures)
+           .arg(results.audioMs / 1000.0, 0, 'f', 1).arg(results.wallNs / 1e9, 0, 'f', 2);
+    out << QString("Facteur temps réel : %1x\n").arg(realtime, 0, 'f', 1);
+    out << QString("Lus par WavPlayer : %1\n").arg(results.wavPlayerFiles);
+
+    QJsonObject stages;
+    for (int stage = 0; stage < StageCount; ++stage) {
+        const double nsPerSample = results.samples > 0 ? double(results.stageNs[stage]) / results.samples : 0;
+        out << QString("  %1 : %2 ns/échantillon, %3 allocations\n")
+               .arg(stageNames[stage], -10).arg(nsPerSample, 0, 'f', 2).arg(results.stageAllocations[stage]);
+        QJsonObject stageObject;
+        stageObject["nsPerSample"] = nsPerSample;
+        stageObject["allocations"] = results.stageAllocations[stage];
+        stages[stageNames[stage]] = stageObject;
+    }
+    report["stages"] = stages;
+
+    const qint64 p50 = percentile(results.deliveryNs, 0.5);
+    const qint64 p99 = percentile(results.deliveryNs, 0.99);
+    const qint64 p999 = percentile(results.deliveryNs, 0.999);
+    const qint64 worst = results.deliveryNs.empty() ? 0 : *std::max_element(results.deliveryNs.begin(), results.deliveryNs.end());
+    out << QString("Livraison des tampons : p50 %1 µs, p99 %2 µs, p99.9 %3 µs, max %4 µs\n")
+           .arg(p50 / 1000).arg(p99 / 1000).arg(p999 / 1000).arg(worst / 1000);
+    QJsonObject delivery;
+    delivery["p50Us"] = p50 / 1000;
+    delivery["p99Us"] = p99 / 1000;
+    delivery["p999Us"] = p999 / 1000;
+    delivery["maxUs"] = worst / 1000;
+    report["delivery"] = delivery;
+    report["checksum"] = qint64(pipeline.checksum());
+
+    bool failed = false;
+    if (!parser.isSet(noClickOption)) {
+        const QVector<qint64> clicks = measureClickToFirstSample(files.first());
+        if (clicks.isEmpty()) {
+            out << "Clic → premier échantillon : indisponible (pas de sortie audio ?)\n";
+        } else {
+            const std::vector<qint64> sorted(clicks.constBegin(), clicks.constEnd());
+            const qint64 median = percentile(sorted, 0.5);
+            const qint64 slowest = *std::max_element(sorted.begin(), sorted.end());
+            out << QString("Clic → premier échantillon : médiane %1 ms, max %2 ms\n")
+                   .arg(median / 1e6, 0, 'f', 1).arg(slowest / 1e6, 0, 'f', 1);
+            QJsonObject click;
+            click["medianMs"] = median / 1e6;
+            click["maxMs"] = slowest / 1e6;
+            report["clickToFirstSample"] = click;
+            if (parser.isSet(maxClickOption) && median / 1e6 > parser.value(maxClickOption).toDouble()) {
+                out << "ÉCHEC : délai clic → premier échantillon trop long\n";
+                failed = true;
+            }
+        }
+    }
+
+    if (parser.isSet(minRealtimeOption) && realtime < parser.value(minRealtimeOption).toDouble()) {
+        out << "ÉCHEC : facteur temps réel trop bas\n";
+        failed = true;
+    }
+    if (parser.isSet(maxTailOption) && p99 / 1000 > parser.value(maxTailOption).toLongLong()) {
+        out << "ÉCHEC : latence de livraison trop élevée\n";
+        failed = true;
+    }
+
+    if (parser.isSet(jsonOption)) {
+        QFile json(parser.value(jsonOption));
+        if (json.open(QIODevice::WriteOnly)) {
+            json.write(QJsonDocument(report).toJson());
+        }
+    }
+
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,23 @@
+# Banc d'essai de la chaîne de lecture, sans carte son :
+#   qmake benchmarks/playbackbench.pro && make
+#   ./playbackbench --runs 3 ~/Musique
+# Les WAV passent par WavPlayer comme dans le lecteur, ce qui suppose une sortie
+# audio qui accepte leur format ; sinon ils passent par le décodeur
+QT       += core
+QT       += multimedia
+QT       -= gui
+
+CONFIG += c++11 console
+CONFIG -= app_bundle
+
+TARGET = playbackbench
+INCLUDEPATH += ..
+
+SOURCES += \
+    playbackbench.cpp \
+    ../wavheader.cpp \
+    ../wavplayer.cpp
+
+HEADERS += \
+    ../wavheader.h \
+    ../wavplayer.h
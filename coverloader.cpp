@@ -0,0 +1,50 @@
+#include "coverloader.h"
+#include <QImageReader>
+#include <QBuffer>
+
+namespace {
+
+QImage decodeFrom(QImageReader &reader, const QSize &maxSize)
+{
+    reader.setAutoTransform(true);
+
+    // Les décodeurs JPEG réduisent pendant la décompression
+    const QSize size = reader.size();
+    if (size.isValid() && (size.width() > maxSize.width() || size.height() > maxSize.height())) {
+        reader.setScaledSize(size.scaled(maxSize, Qt::KeepAspectRatio));
+    }
+
+    QImage image = reader.read();
+    if (!image.isNull() && (image.width() > maxSize.width() || image.height() > maxSize.height())) {
+        image = image.scaled(maxSize, Qt::KeepAspectRatio, Qt::SmoothTransformation);
+    }
+    return image;
+}
+
+}
+
+QSize CoverLoader::coverSize()
+{
+    // Légèrement plus que le cadre de la pochette (250 x 250)
+    return QSize(256, 256);
+}
+
+QSize CoverLoader::previewSize()
+{
+    return QSize(48, 48);
+}
+
+QImage CoverLoader::decode(const QString &imagePath, const QSize &maxSize)
+{
+    QImageReader reader(imagePath);
+    return decodeFrom(reader, maxSize);
+}
+
+QImage CoverLoader::decodeData(const QByteArray &data, const QSize &maxSize)
+{
+    QBuffer buffer;
+    buffer.setData(data);
+    buffer.open(QIODevice::ReadOnly);
+    QImageReader reader(&buffer);
+    return decodeFrom(reader, maxSize);
+}
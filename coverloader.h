@@ -0,0 +1,21 @@
+#ifndef COVERLOADER_H
+#define COVERLOADER_H
+
+#include <QImage>
+#include <QSize>
+#include <QString>
+
+// Décodage des pochettes à taille réduite : QImageReader ne produit que
+// les pixels nécessaires, l'image d'origine n'est jamais chargée en entier.
+// Sans état, utilisable depuis n'importe quel thread.
+class CoverLoader
+{
+public:
+    static QSize coverSize();
+    static QSize previewSize();
+
+    static QImage decode(const QString &imagePath, const QSize &maxSize);
+    static QImage decodeData(const QByteArray &data, const QSize &maxSize);
+};
+
+#endif // COVERLOADER_H
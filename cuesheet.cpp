@@ -0,0 +1,236 @@
+#include "cuesheet.h"
+#include <QFile>
+#include <QFileInfo>
+#include <QDir>
+#include <QTextCodec>
+#include <QStringList>
+
+namespace {
+
+// Une feuille CUE tient en quelques kilo-octets ; au-delà ce n'en est pas une
+const qint64 maxCueSize = 1024 * 1024;
+
+QString decode(const QByteArray &data)
+{
+    // UTF-8 le plus souvent, sinon l'encodage local des anciens logiciels d'extraction
+    QTextCodec::ConverterState state;
+    QString text = QTextCodec::codecForName("UTF-8")->toUnicode(data.constData(), data.size(), &state);
+    if (state.invalidChars > 0) {
+        text = QString::fromLocal8Bit(data);
+    }
+    if (text.startsWith(QChar(0xFEFF))) {
+        text.remove(0, 1);
+    }
+    return text;
+}
+
+// Mots séparés par des blancs, les guillemets regroupent
+QStringList tokenize(const QString &line)
+{
+    QStringList tokens;
+    QString current;
+    bool quoted = false;
+    bool inToken = false;
+    for (const QChar c : line) {
+        if (c == '"') {
+            quoted = !quoted;
+            inToken = true;
+        } else if (!quoted && c.isSpace()) {
+            if (inToken) {
+                tokens.append(current);
+                current.clear();
+                inToken = false;
+            }
+        } else {
+            current += c;
+            inToken = true;
+        }
+    }
+    if (inToken) {
+        tokens.append(current);
+    }
+    return tokens;
+}
+
+// MM:SS:FF en trames CD, -1 si la position est illisible
+qint64 parseTime(const QString &text)
+{
+    const QStringList parts = text.split(':');
+    if (parts.size() != 3) {
+        return -1;
+    }
+    bool minutesOk = false;
+    bool secondsOk = false;
+    bool framesOk = false;
+    const qint64 minutes = parts.at(0).toLongLong(&minutesOk);
+    const qint64 seconds = parts.at(1).toLongLong(&secondsOk);
+    const qint64 frames = parts.at(2).toLongLong(&framesOk);
+    if (!minutesOk || !secondsOk || !framesOk || minutes < 0 || seconds < 0 || seconds >= 60
+            || frames < 0 || frames >= CueSheet::FramesPerSecond) {
+        return -1;
+    }
+    return (minutes * 60 + seconds) * CueSheet::FramesPerSecond + frames;
+}
+
+QString resolveFile(const QDir &directory, const QString &name)
+{
+    const QFileInfo info(directory, name);
+    if (info.exists()) {
+        return info.absoluteFilePath();
+    }
+
+    // Feuille écrite pour l'original, fichier converti depuis : même nom, autre extension
+    for (const char *suffix : { ".wav", ".mp3" }) {
+        const QFileInfo converted(directory, info.completeBaseName() + suffix);
+        if (converted.exists()) {
+            return converted.absoluteFilePath();
+        }
+    }
+    return info.absoluteFilePath();
+}
+
+}
+
+
+bool CueSheet::isValid() const
+{
+    return !tracks.isEmpty();
+}
+
+CueSheet CueSheet::parse(const QString &cuePath)
+{
+    CueSheet sheet;
+    QFile file(cuePath);
+    if (!file.open(QIODevice::ReadOnly) || file.size() > maxCueSize) {
+        return sheet;
+    }
+
+    const QDir directory = QFileInfo(cuePath).absoluteDir();
+    const QStringList lines = decode(file.readAll()).split('\n');
+    QString currentFile;
+    QVector<Track> parsed;
+    int current = -1;
+
+    for (const QString &line : lines) {
+        const QStringList tokens = tokenize(line);
+        if (tokens.size() < 2) {
+            continue;
+        }
+        const QString keyword = tokens.at(0).toUpper();
+
+        if (keyword == "FILE") {
+            currentFile = resolveFile(directory, tokens.at(1));
+        } else if (keyword == "TRACK") {
+            // Les pistes de données d'un CD mixte ne se lisent pas
+            current = -1;
+            if (tokens.size() < 3 || tokens.at(2).toUpper() == "AUDIO") {
+                Track track;
+                track.number = tokens.at(1).toInt();
+                track.file = currentFile;
+                track.start = -1;
+                parsed.append(track);
+                current = parsed.size() - 1;
+            }
+        } else if (keyword == "TITLE") {
+            if (current >= 0) {
+                parsed[current].title = tokens.at(1);
+            } else if (parsed.isEmpty()) {
+                sheet.title = tokens.at(1);
+            }
+        } else if (keyword == "PERFORMER") {
+            if (current >= 0) {
+                parsed[current].performer = tokens.at(1);
+            } else if (parsed.isEmpty()) {
+                sheet.performer = tokens.at(1);
+            }
+        } else if (keyword == "INDEX" && current >= 0 && tokens.size() >= 3 && tokens.at(1).toInt() == 1) {
+            // L'INDEX 00 (silence d'avant-piste) reste à la fin de la piste précédente
+            parsed[current].start = parseTime(tokens.at(2));
+            parsed[current].file = currentFile;
+        }
+    }
+
+    for (const Track &track : parsed) {
+        if (track.number > 0 && track.start >= 0 && !track.file.isEmpty()) {
+            sheet.tracks.append(track);
+        }
+    }
+
+    // Pistes contiguës : la fin de l'une est le début de la suivante dans le même fichier
+    for (int i = 0; i < sheet.tracks.size(); ++i) {
+        Track &track = sheet.tracks[i];
+        if (track.performer.isEmpty()) {
+            track.performer = sheet.performer;
+        }
+        if (track.title.isEmpty()) {
+            track.title = QString("Piste %1").arg(track.number, 2, 10, QChar('0'));
+        }
+        if (i + 1 < sheet.tracks.size() && sheet.tracks.at(i + 1).file == track.file
+                && sheet.tracks.at(i + 1).start > track.start) {
+            track.end = sheet.tracks.at(i + 1).start;
+        }
+    }
+    return sheet;
+}
+
+QString CueSheet::findFor(const QString &audioPath)
+{
+    // Noms habituels seulement, "album.cue" puis "album.wav.cue" : l'ajout d'un
+    // dossier entier ne relit pas le dossier pour chacun de ses fichiers
+    const QFileInfo audio(audioPath);
+    const QDir directory = audio.absoluteDir();
+    const QString target = audio.absoluteFilePath();
+    const QStringList candidates = {
+        directory.filePath(audio.completeBaseName() + ".cue"),
+        directory.filePath(audio.fileName() + ".cue")
+    };
+    for (const QString &candidate : candidates) {
+        if (!QFileInfo::exists(candidate)) {
+            continue;
+        }
+        const CueSheet sheet = parse(candidate);
+        for (const Track &track : sheet.tracks) {
+            if (track.file == target) {
+                return candidate;
+            }
+        }
+    }
+    return QString();
+}
+
+QString CueSheet::virtualPath(const QString &cuePath, int number)
+{
+    return cuePath + '#' + QString::number(number);
+}
+
+bool CueSheet::isVirtualPath(const QString &path)
+{
+    const int hash = path.lastIndexOf('#');
+    if (hash < 4 || hash + 1 >= path.size()
+            || path.midRef(hash - 4, 4).compare(QLatin1String(".cue"), Qt::CaseInsensitive) != 0) {
+        return false;
+    }
+    bool ok = false;
+    path.midRef(hash + 1).toInt(&ok);
+    return ok;
+}
+
+QString CueSheet::cuePathOf(const QString &virtualPath)
+{
+    return virtualPath.left(virtualPath.lastIndexOf('#'));
+}
+
+int CueSheet::trackNumberOf(const QString &virtualPath)
+{
+    return virtualPath.mid(virtualPath.lastIndexOf('#') + 1).toInt();
+}
+
+qint64 CueSheet::framesToMs(qint64 frames)
+{
+    return frames * 1000 / FramesPerSecond;
+}
+
+qint64 CueSheet::msToFrames(qint64 ms)
+{
+    return ms * FramesPerSecond / 1000;
+}
@@ -0,0 +1,44 @@
+#ifndef CUESHEET_H
+#define CUESHEET_H
+
+#include <QString>
+#include <QVector>
+
+// Feuille CUE : un fichier audio découpé en pistes par des index MM:SS:FF.
+// Chaque piste devient une piste virtuelle de chemin "feuille.cue#N", ce qui
+// garde une identité stable pour le journal, l'historique et les listes.
+class CueSheet
+{
+public:
+    // Les positions sont en trames CD (1/75 s), exactes en échantillons à 44,1 et 48 kHz
+    enum { FramesPerSecond = 75 };
+
+    struct Track {
+        int number = 0;
+        QString title;
+        QString performer;
+        QString file;       // chemin absolu du fichier audio
+        qint64 start = 0;   // INDEX 01
+        qint64 end = -1;    // début de la piste suivante du même fichier, -1 jusqu'à la fin
+    };
+
+    QString title;
+    QString performer;
+    QVector<Track> tracks;
+
+    bool isValid() const;
+
+    static CueSheet parse(const QString &cuePath);
+    // Feuille voisine qui découpe ce fichier audio, vide s'il n'y en a pas
+    static QString findFor(const QString &audioPath);
+
+    static QString virtualPath(const QString &cuePath, int number);
+    static bool isVirtualPath(const QString &path);
+    static QString cuePathOf(const QString &virtualPath);
+    static int trackNumberOf(const QString &virtualPath);
+
+    static qint64 framesToMs(qint64 frames);
+    static qint64 msToFrames(qint64 ms);
+};
+
+#endif // CUESHEET_H
@@ -0,0 +1,329 @@
+#include "durationprober.h"
+#include "wavheader.h"
+#include <QFile>
+#include <QFileInfo>
+#include <QDateTime>
+#include <QDataStream>
+#include <QSaveFile>
+#include <QtEndian>
+#include <cstring>
+
+namespace {
+
+const int probeBatchSize = 64;
+const quint32 cacheMagic = 0x51444331;
+const int frameScanBufferSize = 256 * 1024;
+
+// Débits en kbit/s : [MPEG1 | MPEG2 et 2.5][couche 1 à 3][indice]
+const int bitrates[2][3][16] = {
+    { { 0, 32, 64, 96, 128, 160, 192, 224, 256, 288, 320, 352, 384, 416, 448, 0 },
+      { 0, 32, 48, 56, 64, 80, 96, 112, 128, 160, 192, 224, 256, 320, 384, 0 },
+      { 0, 32, 40, 48, 56, 64, 80, 96, 112, 128, 160, 192, 224, 256, 320, 0 } },
+    { { 0, 32, 48, 56, 64, 80, 96, 112, 128, 144, 160, 176, 192, 224, 256, 0 },
+      { 0, 8, 16, 24, 32, 40, 48, 56, 64, 80, 96, 112, 128, 144, 160, 0 },
+      { 0, 8, 16, 24, 32, 40, 48, 56, 64, 80, 96, 112, 128, 144, 160, 0 } }
+};
+
+// Fréquences : [MPEG1, MPEG2, MPEG2.5][indice]
+const int sampleRates[3][3] = {
+    { 44100, 48000, 32000 },
+    { 22050, 24000, 16000 },
+    { 11025, 12000, 8000 }
+};
+
+struct Mp3Frame {
+    int version = 0;      // 0 = MPEG1, 1 = MPEG2, 2 = MPEG2.5
+    int layer = 0;
+    int sampleRate = 0;
+    int samples = 0;      // échantillons par trame
+    int length = 0;       // octets
+    bool mono = false;
+};
+
+bool parseFrameHeader(const uchar *p, Mp3Frame *frame)
+{
+    if (p[0] != 0xFF || (p[1] & 0xE0) != 0xE0) {
+        return false;
+    }
+
+    const int versionBits = (p[1] >> 3) & 0x03;
+    const int layerBits = (p[1] >> 1) & 0x03;
+    const int bitrateIndex = (p[2] >> 4) & 0x0F;
+    const int rateIndex = (p[2] >> 2) & 0x03;
+    const int padding = (p[2] >> 1) & 0x01;
+    if (versionBits == 1 || layerBits == 0 || bitrateIndex == 0 || bitrateIndex == 15 || rateIndex == 3) {
+        return false;
+    }
+
+    frame->version = versionBits == 3 ? 0 : (versionBits == 2 ? 1 : 2);
+    frame->layer = 4 - layerBits;
+    frame->sampleRate = sampleRates[frame->version][rateIndex];
+    frame->mono = ((p[3] >> 6) & 0x03) == 3;
+    const int bitrate = bitrates[frame->version == 0 ? 0 : 1][frame->layer - 1][bitrateIndex] * 1000;
+
+    if (frame->layer == 1) {
+        frame->samples = 384;
+        frame->length = (12 * bitrate / frame->sampleRate + padding) * 4;
+    } else if (frame->layer == 2 || frame->version == 0) {
+        frame->samples = 1152;
+        frame->length = 144 * bitrate / frame->sampleRate + padding;
+    } else {
+        frame->samples = 576;
+        frame->length = 72 * bitrate / frame->sampleRate + padding;
+    }
+    return frame->length > 4;
+}
+
+qint64 id3v2Size(QFile &file)
+{
+    const QByteArray header = file.read(10);
+    if (header.size() < 10 || !header.startsWith("ID3")) {
+        return 0;
+    }
+    const uchar *p = reinterpret_cast<const uchar *>(header.constData());
+    qint64 size = 10 + ((p[6] & 0x7F) << 21 | (p[7] & 0x7F) << 14 | (p[8] & 0x7F) << 7 | (p[9] & 0x7F));
+    if (p[5] & 0x10) {
+        size += 10;
+    }
+    return size;
+}
+
+qint64 probeMp3(QFile &file)
+{
+    if (!file.seek(0)) {
+        return 0;
+    }
+    const qint64 start = id3v2Size(file);
+    if (!file.seek(start)) {
+        return 0;
+    }
+
+    // Première trame valide, confirmée par la suivante quand elle est lisible
+    const QByteArray head = file.read(64 * 1024);
+    const uchar *headData = reinterpret_cast<const uchar *>(head.constData());
+    Mp3Frame first;
+    int offset = -1;
+    for (int i = 0; i + 4 <= head.size(); ++i) {
+        if (parseFrameHeader(headData + i, &first)) {
+            Mp3Frame next;
+            if (i + first.length + 4 > head.size() || parseFrameHeader(headData + i + first.length, &next)) {
+                offset = i;
+                break;
+            }
+        }
+    }
+    if (offset < 0) {
+        return 0;
+    }
+
+    const uchar *frame = headData + offset;
+    const int available = head.size() - offset;
+
+    // En-tête Xing/Info après les informations annexes
+    const int sideInfo = first.version == 0 ? (first.mono ? 17 : 32) : (first.mono ? 9 : 17);
+    const int xing = 4 + sideInfo;
+    if (available >= xing + 12
+            && (std::memcmp(frame + xing, "Xing", 4) == 0 || std::memcmp(frame + xing, "Info", 4) == 0)) {
+        const quint32 flags = qFromBigEndian<quint32>(frame + xing + 4);
+        if (flags & 0x1) {
+            int pos = xing + 8;
+            qint64 samples = qint64(qFromBigEndian<quint32>(frame + pos)) * first.samples;
+            pos += 4;
+            if (flags & 0x2) {
+                pos += 4;
+            }
+            if (flags & 0x4) {
+                pos += 100;
+            }
+            if (flags & 0x8) {
+                pos += 4;
+            }
+
+            // Étiquette LAME : délai et remplissage ajoutés par l'encodeur
+            if (available >= pos + 24) {
+                const uchar *lame = frame + pos;
+                const int delay = (lame[21] << 4) | (lame[22] >> 4);
+                const int padding = ((lame[22] & 0x0F) << 8) | lame[23];
+                if (delay + padding < samples) {
+                    samples -= delay + padding;
+                }
+            }
+            return samples * 1000 / first.sampleRate;
+        }
+    }
+
+    // En-tête VBRI (Fraunhofer) : toujours 32 octets après l'en-tête de trame
+    const int vbri = 4 + 32;
+    if (available >= vbri + 18 && std::memcmp(frame + vbri, "VBRI", 4) == 0) {
+        const qint64 frames = qFromBigEndian<quint32>(frame + vbri + 14);
+        return frames * first.samples * 1000 / first.sampleRate;
+    }
+
+    // Sans en-tête : on compte les trames jusqu'à la fin du flux
+    qint64 end = file.size();
+    if (end >= 128 && file.seek(end - 128) && file.read(3) == "TAG") {
+        end -= 128;
+    }
+
+    qint64 samples = 0;
+    qint64 pos = start + offset;
+    QByteArray buffer;
+    qint64 bufferStart = 0;
+    while (pos + 4 <= end) {
+        if (pos < bufferStart || pos + 4 > bufferStart + buffer.size()) {
+            if (!file.seek(pos)) {
+                break;
+            }
+            buffer = file.read(frameScanBufferSize);
+            bufferStart = pos;
+            if (buffer.size() < 4) {
+                break;
+            }
+        }
+
+        Mp3Frame current;
+        const uchar *data = reinterpret_cast<const uchar *>(buffer.constData()) + (pos - bufferStart);
+        if (!parseFrameHeader(data, &current)) {
+            break;
+        }
+        samples += current.samples;
+        pos += current.length;
+    }
+    return samples * 1000 / first.sampleRate;
+}
+
+}
+
+
+DurationProber::DurationProber(const QString &cacheFileName, QObject *parent)
+    : QObject(parent)
+    , cacheFileName(cacheFileName)
+    , cacheDirty(false)
+{
+    qRegisterMetaType<QVector<int> >("QVector<int>");
+    qRegisterMetaType<QVector<qint64> >("QVector<qint64>");
+    loadCache();
+}
+
+DurationProber::~DurationProber()
+{
+    tasks.cancel();
+    tasks.wait();
+    saveCache();
+}
+
+void DurationProber::probe(const QVector<int> &tracks, const QStringList &paths)
+{
+    for (int begin = 0; begin < tracks.size(); begin += probeBatchSize) {
+        const QVector<int> batchTracks = tracks.mid(begin, probeBatchSize);
+        const QStringList batchPaths = paths.mid(begin, probeBatchSize);
+        // Suite de l'ajout de fichiers : après l'interactif, avant l'analyse
+        TaskScheduler::instance()->run(TaskScheduler::Io, TaskScheduler::Normal, tasks, [this, batchTracks, batchPaths]() {
+            QVector<qint64> durations;
+            durations.reserve(batchPaths.size());
+            for (const QString &path : batchPaths) {
+                durations.append(cachedDuration(path));
+            }
+            emit durationsReady(batchTracks, durations);
+        });
+    }
+}
+
+qint64 DurationProber::probeFile(const QString &filePath)
+{
+    QFile file(filePath);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return 0;
+    }
+
+    const WavHeader wav = WavHeader::parse(&file);
+    if (wav.isValid()) {
+        return wav.durationMs();
+    }
+    return probeMp3(file);
+}
+
+qint64 DurationProber::memoryUsage()
+{
+    QMutexLocker locker(&cacheMutex);
+    qint64 bytes = qint64(cache.capacity()) * qint64(sizeof(void *));
+    for (QHash<QString, CacheEntry>::const_iterator it = cache.constBegin(); it != cache.constEnd(); ++it) {
+        // Nœud, entrée et clé (souvent partagée avec le TrackStore, comptée quand même)
+        bytes += 32 + qint64(sizeof(CacheEntry)) + (qint64(it.key().size()) + 1) * 2;
+    }
+    return bytes;
+}
+
+qint64 DurationProber::cachedDuration(const QString &filePath)
+{
+    const QFileInfo info(filePath);
+    if (!info.exists()) {
+        return 0;
+    }
+    const qint64 size = info.size();
+    const qint64 modified = info.lastModified().toMSecsSinceEpoch();
+
+    {
+        QMutexLocker locker(&cacheMutex);
+        QHash<QString, CacheEntry>::const_iterator it = cache.constFind(filePath);
+        if (it != cache.constEnd() && it->size == size && it->modified == modified) {
+            return it->duration;
+        }
+    }
+
+    const qint64 duration = probeFile(filePath);
+
+    QMutexLocker locker(&cacheMutex);
+    CacheEntry &entry = cache[filePath];
+    entry.size = size;
+    entry.modified = modified;
+    entry.duration = duration;
+    cacheDirty = true;
+    return duration;
+}
+
+void DurationProber::loadCache()
+{
+    QFile file(cacheFileName);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return;
+    }
+
+    QDataStream in(&file);
+    quint32 magic = 0;
+    quint32 count = 0;
+    in >> magic >> count;
+    if (magic != cacheMagic) {
+        return;
+    }
+
+    for (quint32 i = 0; i < count && in.status() == QDataStream::Ok; ++i) {
+        QString path;
+        CacheEntry entry;
+        in >> path >> entry.size >> entry.modified >> entry.duration;
+        if (in.status() == QDataStream::Ok) {
+            cache.insert(path, entry);
+        }
+    }
+}
+
+void DurationProber::saveCache()
+{
+    if (!cacheDirty) {
+        return;
+    }
+
+    QSaveFile file(cacheFileName);
+    if (!file.open(QIODevice::WriteOnly)) {
+        return;
+    }
+
+    QDataStream out(&file);
+    out << cacheMagic << quint32(cache.size());
+    for (QHash<QString, CacheEntry>::const_iterator it = cache.constBegin(); it != cache.constEnd(); ++it) {
+        out << it.key() << it->size << it->modified << it->duration;
+    }
+    if (file.commit()) {
+        cacheDirty = false;
+    }
+}
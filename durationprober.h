@@ -0,0 +1,50 @@
+#ifndef DURATIONPROBER_H
+#define DURATIONPROBER_H
+
+#include <QObject>
+#include <QMutex>
+#include <QHash>
+#include <QVector>
+#include <QStringList>
+#include "taskscheduler.h"
+
+// Calcule la durée exacte des fichiers sans les décoder : en-tête WAV,
+// en-têtes Xing/Info/VBRI des MP3, sinon comptage des trames.
+// Les résultats sont gardés par identité de fichier (taille + date de modification).
+class DurationProber : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit DurationProber(const QString &cacheFileName, QObject *parent = nullptr);
+    ~DurationProber();
+
+    void probe(const QVector<int> &tracks, const QStringList &paths);
+
+    static qint64 probeFile(const QString &filePath);
+
+    // Octets occupés par le cache des durées
+    qint64 memoryUsage();
+
+signals:
+    void durationsReady(const QVector<int> &tracks, const QVector<qint64> &durations);
+
+private:
+    struct CacheEntry {
+        qint64 size = 0;
+        qint64 modified = 0;
+        qint64 duration = 0;
+    };
+
+    qint64 cachedDuration(const QString &filePath);
+    void loadCache();
+    void saveCache();
+
+    TaskScheduler::Group tasks;
+    QMutex cacheMutex;
+    QHash<QString, CacheEntry> cache;
+    QString cacheFileName;
+    bool cacheDirty;
+};
+
+#endif // DURATIONPROBER_H
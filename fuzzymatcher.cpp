@@ -0,0 +1,240 @@
+#include "fuzzymatcher.h"
+#include "trackstore.h"
+#include <QtConcurrent>
+#include <QThread>
+#include <algorithm>
+#include <cstring>
+#include <queue>
+#include <vector>
+
+namespace {
+
+// Au-delà, seuls les 64 premiers caractères du motif comptent
+const int maxPatternLength = 64;
+const int parallelChunkSize = 8192;
+
+// Bonus de pertinence, ajoutés au score de distance
+const int errorWeight = 1000;
+const int exactBonus = 500;
+const int prefixBonus = 300;
+const int wordBonus = 200;
+const int artistPenalty = 50;
+const int albumPenalty = 100;
+
+QVector<ushort> makeFoldTable()
+{
+    // Minuscules sans accents pour le latin étendu
+    QVector<ushort> table(0x250);
+    for (int c = 0; c < table.size(); ++c) {
+        QChar ch(c);
+        const QString decomposition = ch.decomposition();
+        if (!decomposition.isEmpty() && ch.decompositionTag() == QChar::Canonical) {
+            ch = decomposition.at(0);
+        }
+        table[c] = ch.toCaseFolded().unicode();
+    }
+    return table;
+}
+
+struct Match {
+    int score;
+    int order;
+    int id;
+
+    // Le « plus grand » est le moins pertinent
+    bool operator>(const Match &other) const
+    {
+        return score != other.score ? score < other.score : order > other.order;
+    }
+};
+
+// Ordre du plus pertinent au moins pertinent : en tête du tas, le moins
+// pertinent des retenus, le premier à céder sa place
+struct MoreRelevant {
+    bool operator()(const Match &a, const Match &b) const
+    {
+        return b > a;
+    }
+};
+
+struct Chunk {
+    int first;
+    int last;
+    std::vector<Match> *matches;
+};
+
+}
+
+FuzzyMatcher::FuzzyMatcher(const QString &text)
+    : length(0)
+    , errors(0)
+{
+    std::memset(asciiMasks, 0, sizeof(asciiMasks));
+
+    for (const QChar ch : text.simplified()) {
+        if (pattern.size() == maxPatternLength) {
+            break;
+        }
+        pattern.append(QChar(fold(ch.unicode())));
+    }
+    length = pattern.size();
+
+    for (int i = 0; i < length; ++i) {
+        const ushort c = pattern.at(i).unicode();
+        if (c < 256) {
+            asciiMasks[c] |= quint64(1) << i;
+        } else {
+            otherMasks[c] |= quint64(1) << i;
+        }
+    }
+
+    // Une faute tolérée tous les trois caractères environ
+    errors = length <= 2 ? 0 : (length <= 5 ? 1 : (length <= 9 ? 2 : 3));
+}
+
+bool FuzzyMatcher::isEmpty() const
+{
+    return length == 0;
+}
+
+int FuzzyMatcher::maxErrors() const
+{
+    return errors;
+}
+
+ushort FuzzyMatcher::fold(ushort c)
+{
+    static const QVector<ushort> table = makeFoldTable();
+    if (c < table.size()) {
+        return table.at(c);
+    }
+    return QChar(c).toCaseFolded().unicode();
+}
+
+quint64 FuzzyMatcher::equalMask(ushort c) const
+{
+    return c < 256 ? asciiMasks[c] : otherMasks.value(c);
+}
+
+int FuzzyMatcher::score(const QString &text) const
+{
+    if (length == 0 || text.isEmpty()) {
+        return -1;
+    }
+
+    // Myers (1999) en recherche : le motif peut commencer n'importe où
+    const quint64 high = quint64(1) << (length - 1);
+    quint64 pv = length == 64 ? ~quint64(0) : (high << 1) - 1;
+    quint64 mv = 0;
+    int distance = length;
+    int best = length;
+    int bestEnd = -1;
+
+    const ushort *data = reinterpret_cast<const ushort *>(text.constData());
+    const int size = text.size();
+    for (int i = 0; i < size; ++i) {
+        const quint64 eq = equalMask(fold(data[i]));
+        const quint64 xv = eq | mv;
+        const quint64 xh = (((eq & pv) + pv) ^ pv) | eq;
+        quint64 ph = mv | ~(xh | pv);
+        quint64 mh = pv & xh;
+        if (ph & high) {
+            ++distance;
+        } else if (mh & high) {
+            --distance;
+        }
+        ph <<= 1;
+        mh <<= 1;
+        pv = mh | ~(xv | ph);
+        mv = ph & xv;
+
+        if (distance < best) {
+            best = distance;
+            bestEnd = i;
+            if (best == 0) {
+                break;
+            }
+        }
+    }
+
+    if (best > errors) {
+        return -1;
+    }
+
+    int result = (errors - best + 1) * errorWeight;
+    if (best == 0) {
+        result += exactBonus;
+    }
+    // Début approximatif de la correspondance, exact quand il n'y a pas de faute
+    const int start = qMax(0, bestEnd - length + 1);
+    if (start == 0) {
+        result += prefixBonus;
+    } else if (!text.at(start - 1).isLetterOrNumber()) {
+        result += wordBonus;
+    }
+    // À pertinence égale, les textes courts d'abord
+    return result - qMin(size, 200);
+}
+
+QVector<int> FuzzyMatcher::rank(const TrackStore *store, const QVector<int> &candidates, int limit) const
+{
+    QVector<int> result;
+    if (length == 0 || limit <= 0) {
+        return result;
+    }
+
+    // Chaque morceau garde ses meilleurs résultats dans un tas borné
+    const int chunkCount = qBound(1, candidates.size() / parallelChunkSize, qMax(1, QThread::idealThreadCount()) * 4);
+    std::vector<std::vector<Match> > chunkMatches(size_t(chunkCount));
+    QVector<Chunk> chunks;
+    for (int i = 0; i < chunkCount; ++i) {
+        Chunk chunk;
+        chunk.first = int(qint64(candidates.size()) * i / chunkCount);
+        chunk.last = int(qint64(candidates.size()) * (i + 1) / chunkCount);
+        chunk.matches = &chunkMatches[size_t(i)];
+        chunks.append(chunk);
+    }
+
+    const int *ids = candidates.constData();
+    QtConcurrent::blockingMap(chunks, [this, store, ids, limit](const Chunk &chunk) {
+        std::priority_queue<Match, std::vector<Match>, MoreRelevant> best;
+        for (int i = chunk.first; i < chunk.last; ++i) {
+            const int id = ids[i];
+            int value = score(store->title(id));
+            value = qMax(value, score(store->artist(id)) - artistPenalty);
+            value = qMax(value, score(store->album(id)) - albumPenalty);
+            if (value < 0) {
+                continue;
+            }
+
+            Match match;
+            match.score = value;
+            match.order = i;
+            match.id = id;
+            if (int(best.size()) < limit) {
+                best.push(match);
+            } else if (MoreRelevant()(match, best.top())) {
+                best.pop();
+                best.push(match);
+            }
+        }
+        chunk.matches->reserve(best.size());
+        while (!best.empty()) {
+            chunk.matches->push_back(best.top());
+            best.pop();
+        }
+    });
+
+    std::vector<Match> merged;
+    for (const std::vector<Match> &matches : chunkMatches) {
+        merged.insert(merged.end(), matches.begin(), matches.end());
+    }
+    const size_t kept = qMin(merged.size(), size_t(limit));
+    std::partial_sort(merged.begin(), merged.begin() + kept, merged.end(), MoreRelevant());
+
+    result.reserve(int(kept));
+    for (size_t i = 0; i < kept; ++i) {
+        result.append(merged[i].id);
+    }
+    return result;
+}
@@ -0,0 +1,42 @@
+#ifndef FUZZYMATCHER_H
+#define FUZZYMATCHER_H
+
+#include <QString>
+#include <QVector>
+#include <QHash>
+
+class TrackStore;
+
+// Recherche approchée tolérante aux fautes de frappe. Le motif est compilé
+// une fois en masques de bits ; la distance d'édition est calculée par
+// l'algorithme bit-parallèle de Myers, un mot machine par colonne du motif.
+class FuzzyMatcher
+{
+public:
+    enum { DefaultLimit = 1000 };
+
+    explicit FuzzyMatcher(const QString &pattern = QString());
+
+    bool isEmpty() const;
+    int maxErrors() const;
+
+    // Score de pertinence, -1 si le texte ne correspond pas
+    int score(const QString &text) const;
+
+    // Les meilleures pistes parmi les candidats, par score décroissant ;
+    // à score égal l'ordre des candidats est conservé.
+    QVector<int> rank(const TrackStore *store, const QVector<int> &candidates, int limit = DefaultLimit) const;
+
+    static ushort fold(ushort c);
+
+private:
+    quint64 equalMask(ushort c) const;
+
+    QString pattern;
+    int length;
+    int errors;
+    quint64 asciiMasks[256];
+    QHash<ushort, quint64> otherMasks;
+};
+
+#endif // FUZZYMATCHER_H
@@ -0,0 +1,591 @@
+#include "healthchecker.h"
+#include <QtConcurrent>
+#include <QFile>
+#include <QFileInfo>
+#include <QDirIterator>
+#include <QDataStream>
+#include <QSaveFile>
+#include <QCryptographicHash>
+#include <QElapsedTimer>
+#include <QSet>
+#include <QThread>
+#include <QtEndian>
+#include <memory>
+
+namespace {
+
+const quint32 cacheMagic = 0x51484331;
+// Un dossier qui n'avance plus pendant ce délai rend tout son point de montage injoignable
+const int statTimeoutMs = 2000;
+const int statThreads = 16;
+const int maxStatThreads = 64;
+const int pollIntervalMs = 50;
+const qint64 hashBytes = 64 * 1024;
+// Empreintes calculées par passage : l'index se complète au fil des vérifications
+const int hashBudgetMs = 2000;
+const int hashBatchSize = 64;
+
+enum DirectoryStatus {
+    Pending = 0,
+    Running,
+    Done,
+    Abandoned
+};
+
+struct FileState {
+    bool exists = false;
+    qint64 size = -1;
+    qint64 modified = 0;
+};
+
+struct Directory {
+    QString path;
+    QString mount;
+    QVector<int> indexes;
+};
+
+// Partagé avec les tâches : une tâche bloquée sur un montage mort peut
+// survivre à la vérification sans écrire dans une mémoire libérée
+struct CheckState {
+    QStringList paths;
+    QVector<Directory> directories;
+    QVector<FileState> files;
+    std::unique_ptr<std::atomic<int>[]> status;
+    // Dernier progrès d'un dossier en cours : son démarrage, puis chaque fichier consulté
+    std::unique_ptr<std::atomic<qint64>[]> lastProgress;
+    std::atomic<int> filesDone;
+    QElapsedTimer clock;
+    QMutex deadMutex;
+    QSet<QString> deadMounts;
+
+    bool isDead(const QString &mount)
+    {
+        QMutexLocker locker(&deadMutex);
+        return deadMounts.contains(mount);
+    }
+};
+
+}
+
+// Travail bloquant confié à statPool. Sans progrès pendant statTimeoutMs, il est
+// abandonné : il finit alors seul, et ses résultats ne sont plus lus
+struct HealthChecker::Job {
+    QElapsedTimer clock;
+    std::atomic<qint64> lastProgress;
+    std::atomic<bool> started;
+    std::atomic<bool> done;
+    std::atomic<bool> abandoned;
+
+    // Résultats, lus seulement une fois done posé
+    quint64 hash = 0;
+    QHash<qint64, QStringList> found;
+
+    Job()
+        : lastProgress(0)
+        , started(false)
+        , done(false)
+        , abandoned(false)
+    {
+        clock.start();
+    }
+
+    bool begin()
+    {
+        if (abandoned) {
+            return false;
+        }
+        progressed();
+        started = true;
+        return true;
+    }
+
+    void progressed()
+    {
+        lastProgress = clock.elapsed();
+    }
+};
+
+HealthChecker::HealthChecker(const QString &cacheFileName, QObject *parent)
+    : QObject(parent)
+    , cacheFileName(cacheFileName)
+    , statPool(new QThreadPool)
+    , running(false)
+    , stopping(false)
+{
+    qRegisterMetaType<HealthChecker::Result>("HealthChecker::Result");
+    statPool->setMaxThreadCount(statThreads);
+}
+
+HealthChecker::~HealthChecker()
+{
+    // La vérification en cours abandonne ce qu'elle attend sur statPool au
+    // prochain tour de guet : l'attente ne dépend d'aucun système de fichiers
+    stopping = true;
+    tasks.cancel();
+    tasks.wait();
+
+    // Un stat() bloqué sur un montage réseau mort ne rend jamais la main :
+    // on laisse alors ses threads à la fin du processus plutôt que de geler la fermeture
+    statPool->clear();
+    if (statPool->waitForDone(1000)) {
+        delete statPool;
+    }
+}
+
+bool HealthChecker::isRunning() const
+{
+    return running;
+}
+
+void HealthChecker::start(const QVector<int> &tracks, const QStringList &paths, const QStringList &watchRoots)
+{
+    if (running.exchange(true)) {
+        return;
+    }
+    // Analyse : file de plus basse priorité. Les stat() restent sur leur réserve
+    // dédiée, qui supporte les threads bloqués sans en priver les autres travaux
+    TaskScheduler::instance()->run(TaskScheduler::Io, TaskScheduler::Idle, tasks, [this, tracks, paths, watchRoots]() {
+        const Result result = run(tracks, paths, watchRoots);
+        running = false;
+        emit finished(result);
+    });
+}
+
+void HealthChecker::pathChanged(const QString &oldPath, const QString &newPath)
+{
+    QMutexLocker locker(&cacheMutex);
+    if (fingerprints.contains(oldPath)) {
+        fingerprints.insert(newPath, fingerprints.take(oldPath));
+    }
+}
+
+HealthChecker::Result HealthChecker::run(const QVector<int> &tracks, const QStringList &paths, const QStringList &watchRoots)
+{
+    QElapsedTimer timer;
+    timer.start();
+    Result result;
+    result.checked = paths.size();
+
+    {
+        QMutexLocker locker(&cacheMutex);
+        if (fingerprints.isEmpty()) {
+            loadCache();
+        }
+    }
+
+    // Points de montage lus sans toucher aux systèmes de fichiers eux-mêmes
+    mountPoints.clear();
+#ifdef Q_OS_LINUX
+    QFile mounts("/proc/self/mounts");
+    if (mounts.open(QIODevice::ReadOnly)) {
+        const QList<QByteArray> lines = mounts.readAll().split('\n');
+        for (const QByteArray &line : lines) {
+            const QList<QByteArray> fields = line.split(' ');
+            if (fields.size() > 1) {
+                mountPoints.append(QString::fromLocal8Bit(fields.at(1)).replace("\\040", " "));
+            }
+        }
+    }
+#endif
+
+    // Un lot par dossier : le dossier est consulté d'abord, ses fichiers ensuite
+    std::shared_ptr<CheckState> state = std::make_shared<CheckState>();
+    state->paths = paths;
+    state->files.resize(paths.size());
+    QHash<QString, int> directoryIndexes;
+    for (int i = 0; i < paths.size(); ++i) {
+        const QString directory = paths.at(i).left(paths.at(i).lastIndexOf('/'));
+        QHash<QString, int>::const_iterator it = directoryIndexes.constFind(directory);
+        int index;
+        if (it == directoryIndexes.constEnd()) {
+            index = state->directories.size();
+            directoryIndexes.insert(directory, index);
+            Directory entry;
+            entry.path = directory;
+            entry.mount = mountPointOf(directory);
+            state->directories.append(entry);
+        } else {
+            index = it.value();
+        }
+        state->directories[index].indexes.append(i);
+    }
+
+    const int directoryCount = state->directories.size();
+    state->status.reset(new std::atomic<int>[size_t(directoryCount)]);
+    state->lastProgress.reset(new std::atomic<qint64>[size_t(directoryCount)]);
+    for (int d = 0; d < directoryCount; ++d) {
+        state->status[d] = Pending;
+        state->lastProgress[d] = 0;
+    }
+    state->filesDone = 0;
+    state->clock.start();
+
+    for (int d = 0; d < directoryCount; ++d) {
+        QtConcurrent::run(statPool, [state, d]() {
+            const Directory &directory = state->directories.at(d);
+            // Horodaté avant de passer en cours : le guet ne voit jamais un démarrage à 0
+            state->lastProgress[d] = state->clock.elapsed();
+            int expected = Pending;
+            if (state->isDead(directory.mount) || !state->status[d].compare_exchange_strong(expected, Running)) {
+                return;
+            }
+
+            // Un gros dossier sain sur un disque lent avance fichier par fichier :
+            // seul un stat() qui ne rend pas la main le fait abandonner
+            const bool reachable = QFileInfo(directory.path).isDir();
+            state->lastProgress[d] = state->clock.elapsed();
+            for (int index : directory.indexes) {
+                if (state->status[d] != Running) {
+                    return;
+                }
+                FileState &file = state->files[index];
+                if (reachable) {
+                    const QFileInfo info(state->paths.at(index));
+                    file.exists = info.isFile();
+                    file.size = info.size();
+                    file.modified = info.lastModified().toMSecsSinceEpoch();
+                    state->lastProgress[d] = state->clock.elapsed();
+                }
+                ++state->filesDone;
+            }
+            expected = Running;
+            state->status[d].compare_exchange_strong(expected, Done);
+        });
+    }
+
+    forever {
+        int pending = 0;
+        const qint64 now = state->clock.elapsed();
+        for (int d = 0; d < directoryCount; ++d) {
+            int current = state->status[d];
+            const QString &mount = state->directories.at(d).mount;
+            if (current == Pending && (stopping || state->isDead(mount))) {
+                state->status[d].compare_exchange_strong(current, Abandoned);
+            } else if (current == Running && (stopping || now - state->lastProgress[d] > statTimeoutMs)) {
+                if (state->status[d].compare_exchange_strong(current, Abandoned) && !stopping) {
+                    QMutexLocker locker(&state->deadMutex);
+                    state->deadMounts.insert(mount);
+                    // Le thread bloqué est remplacé pour que les autres dossiers avancent
+                    statPool->setMaxThreadCount(qMin(statPool->maxThreadCount() + 1, maxStatThreads));
+                }
+            }
+            current = state->status[d];
+            if (current == Pending || current == Running) {
+                ++pending;
+            }
+        }
+        emit progress(state->filesDone, paths.size());
+        if (pending == 0) {
+            break;
+        }
+        QThread::msleep(pollIntervalMs);
+    }
+
+    // Bilan : les empreintes connues sont gardées, celles des fichiers modifiés invalidées
+    QHash<QString, Fingerprint> known;
+    {
+        QMutexLocker locker(&cacheMutex);
+        known = fingerprints;
+    }
+    QHash<QString, Fingerprint> updated;
+    QStringList toHash;
+    QSet<QString> libraryPaths;
+    QVector<int> missing;
+    for (int d = 0; d < directoryCount; ++d) {
+        const Directory &directory = state->directories.at(d);
+        const bool done = state->status[d] == Done;
+        for (int index : directory.indexes) {
+            const QString &path = paths.at(index);
+            libraryPaths.insert(path);
+            Fingerprint fingerprint = known.value(path);
+            if (!done) {
+                result.unreachable.append(tracks.at(index));
+            } else if (!state->files.at(index).exists) {
+                missing.append(index);
+            } else {
+                const FileState &file = state->files.at(index);
+                if (fingerprint.size != file.size || fingerprint.modified != file.modified) {
+                    fingerprint.size = file.size;
+                    fingerprint.modified = file.modified;
+                    fingerprint.hash = 0;
+                }
+                if (fingerprint.hash == 0) {
+                    toHash.append(path);
+                }
+            }
+            updated.insert(path, fingerprint);
+        }
+    }
+
+    // Empreintes partielles en parallèle, dans la limite du budget de temps
+    QVector<QPair<QString, qint64> > hashRequests;
+    for (const QString &path : toHash) {
+        hashRequests.append(qMakePair(path, updated.value(path).size));
+    }
+    QHash<QString, quint64> hashes;
+    hashFiles(hashRequests, hashBudgetMs, &hashes);
+    for (QHash<QString, quint64>::const_iterator it = hashes.constBegin(); it != hashes.constEnd(); ++it) {
+        updated[it.key()].hash = it.value();
+    }
+
+    // Fichiers disparus : recherchés par taille dans les dossiers surveillés
+    QSet<qint64> missingSizes;
+    for (int index : missing) {
+        const qint64 size = updated.value(paths.at(index)).size;
+        if (size > 0) {
+            missingSizes.insert(size);
+        }
+    }
+
+    if (!missingSizes.isEmpty() && !stopping) {
+        // Un parcours par dossier surveillé ; celui qui cesse d'avancer rend son montage injoignable
+        QVector<std::shared_ptr<Job> > walks;
+        QStringList walkedRoots;
+        for (const QString &root : watchRoots) {
+            if (!state->isDead(mountPointOf(root))) {
+                walks.append(startWalk(root, libraryPaths, missingSizes));
+                walkedRoots.append(root);
+            }
+        }
+        awaitJobs(walks);
+
+        QHash<qint64, QStringList> candidates;
+        QSet<QString> seen;
+        for (int w = 0; w < walks.size(); ++w) {
+            if (!walks.at(w)->done) {
+                QMutexLocker locker(&state->deadMutex);
+                state->deadMounts.insert(mountPointOf(walkedRoots.at(w)));
+                continue;
+            }
+            const QHash<qint64, QStringList> &found = walks.at(w)->found;
+            for (QHash<qint64, QStringList>::const_iterator it = found.constBegin(); it != found.constEnd(); ++it) {
+                for (const QString &path : it.value()) {
+                    // Dossiers surveillés imbriqués : un fichier n'est candidat qu'une fois
+                    if (!seen.contains(path)) {
+                        seen.insert(path);
+                        candidates[it.key()].append(path);
+                    }
+                }
+            }
+        }
+
+        // Candidats comparés par empreinte, lus eux aussi sur statPool
+        QVector<QPair<QString, qint64> > candidateRequests;
+        QSet<QString> requested;
+        for (int index : missing) {
+            const Fingerprint fingerprint = updated.value(paths.at(index));
+            if (fingerprint.hash == 0) {
+                continue;
+            }
+            for (const QString &candidate : candidates.value(fingerprint.size)) {
+                if (!requested.contains(candidate)) {
+                    requested.insert(candidate);
+                    candidateRequests.append(qMakePair(candidate, fingerprint.size));
+                }
+            }
+        }
+        QHash<QString, quint64> candidateHashes;
+        hashFiles(candidateRequests, -1, &candidateHashes);
+
+        QSet<QString> claimed;
+        QVector<int> stillMissing;
+        for (int index : missing) {
+            const QString &oldPath = paths.at(index);
+            const Fingerprint fingerprint = updated.value(oldPath);
+            QStringList matches;
+            for (const QString &candidate : candidates.value(fingerprint.size)) {
+                if (claimed.contains(candidate)) {
+                    continue;
+                }
+                if (fingerprint.hash != 0) {
+                    // Empreinte illisible ou abandonnée : 0, jamais égale
+                    if (candidateHashes.value(candidate) == fingerprint.hash) {
+                        matches.append(candidate);
+                    }
+                } else if (QFileInfo(candidate).fileName() == QFileInfo(oldPath).fileName()) {
+                    // Sans empreinte, seul un déplacement sous le même nom est accepté
+                    matches.append(candidate);
+                }
+            }
+
+            if (matches.size() == 1) {
+                claimed.insert(matches.first());
+                result.relinked.append(qMakePair(tracks.at(index), matches.first()));
+                updated.insert(matches.first(), updated.take(oldPath));
+            } else {
+                stillMissing.append(index);
+            }
+        }
+        missing = stillMissing;
+    }
+    for (int index : missing) {
+        result.missing.append(tracks.at(index));
+    }
+
+    {
+        QMutexLocker locker(&cacheMutex);
+        fingerprints = updated;
+        saveCache();
+    }
+
+    result.elapsedMs = timer.elapsed();
+    return result;
+}
+
+std::shared_ptr<HealthChecker::Job> HealthChecker::startWalk(const QString &root, const QSet<QString> &libraryPaths,
+                                                             const QSet<qint64> &sizes)
+{
+    // La tâche ne touche pas au vérificateur : elle peut lui survivre sur un montage mort
+    std::shared_ptr<Job> job = std::make_shared<Job>();
+    QtConcurrent::run(statPool, [job, root, libraryPaths, sizes]() {
+        if (!job->begin()) {
+            return;
+        }
+        QDirIterator it(root, QStringList() << "*.mp3" << "*.wav", QDir::Files, QDirIterator::Subdirectories);
+        while (it.hasNext() && !job->abandoned) {
+            const QString path = it.next();
+            job->progressed();
+            if (libraryPaths.contains(path)) {
+                continue;
+            }
+            const qint64 size = it.fileInfo().size();
+            if (sizes.contains(size)) {
+                job->found[size].append(path);
+            }
+        }
+        if (!job->abandoned) {
+            job->done = true;
+        }
+    });
+    return job;
+}
+
+void HealthChecker::hashFiles(const QVector<QPair<QString, qint64> > &files, int budgetMs, QHash<QString, quint64> *hashes)
+{
+    // Par lots, arrêtés une fois le budget écoulé (-1 : sans limite)
+    QElapsedTimer timer;
+    timer.start();
+    for (int begin = 0; begin < files.size() && (budgetMs < 0 || timer.elapsed() < budgetMs) && !stopping;
+         begin += hashBatchSize) {
+        const QVector<QPair<QString, qint64> > batch = files.mid(begin, hashBatchSize);
+        QVector<std::shared_ptr<Job> > jobs;
+        for (const QPair<QString, qint64> &file : batch) {
+            std::shared_ptr<Job> job = std::make_shared<Job>();
+            const QString path = file.first;
+            const qint64 size = file.second;
+            QtConcurrent::run(statPool, [job, path, size]() {
+                if (job->begin()) {
+                    job->hash = partialHash(path, size);
+                    job->done = true;
+                }
+            });
+            jobs.append(job);
+        }
+        awaitJobs(jobs);
+        for (int i = 0; i < batch.size(); ++i) {
+            if (jobs.at(i)->done) {
+                hashes->insert(batch.at(i).first, jobs.at(i)->hash);
+            }
+        }
+    }
+}
+
+void HealthChecker::awaitJobs(const QVector<std::shared_ptr<Job> > &jobs)
+{
+    // Même guet que pour les stat() : un travail lancé qui n'avance plus est
+    // abandonné et son thread remplacé ; à l'arrêt, tout est abandonné
+    forever {
+        int pending = 0;
+        for (const std::shared_ptr<Job> &job : jobs) {
+            if (job->done || job->abandoned) {
+                continue;
+            }
+            const bool stalled = job->started && job->clock.elapsed() - job->lastProgress > statTimeoutMs;
+            if (stopping || stalled) {
+                job->abandoned = true;
+                if (stalled && !stopping) {
+                    statPool->setMaxThreadCount(qMin(statPool->maxThreadCount() + 1, maxStatThreads));
+                }
+            } else {
+                ++pending;
+            }
+        }
+        if (pending == 0) {
+            return;
+        }
+        QThread::msleep(pollIntervalMs);
+    }
+}
+
+quint64 HealthChecker::partialHash(const QString &path, qint64 size)
+{
+    // Début et fin du fichier, plus la taille : suffisant pour reconnaître un fichier déplacé
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return 0;
+    }
+    QCryptographicHash hash(QCryptographicHash::Md5);
+    hash.addData(file.read(hashBytes));
+    if (size > 2 * hashBytes && file.seek(size - hashBytes)) {
+        hash.addData(file.read(hashBytes));
+    }
+    hash.addData(reinterpret_cast<const char *>(&size), sizeof(size));
+    const QByteArray digest = hash.result();
+    return qFromLittleEndian<quint64>(reinterpret_cast<const uchar *>(digest.constData())) | 1;
+}
+
+QString HealthChecker::mountPointOf(const QString &path) const
+{
+    QString best;
+    for (const QString &mount : mountPoints) {
+        if (mount.size() > best.size()
+                && (path == mount || path.startsWith(mount.endsWith('/') ? mount : mount + '/'))) {
+            best = mount;
+        }
+    }
+    if (!best.isEmpty()) {
+        return best;
+    }
+    // Sans table des montages : les deux premiers niveaux du chemin
+    return path.section('/', 0, 2);
+}
+
+void HealthChecker::loadCache()
+{
+    QFile file(cacheFileName);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return;
+    }
+
+    QDataStream in(&file);
+    quint32 magic = 0;
+    quint32 count = 0;
+    in >> magic >> count;
+    if (magic != cacheMagic) {
+        return;
+    }
+
+    for (quint32 i = 0; i < count && in.status() == QDataStream::Ok; ++i) {
+        QString path;
+        Fingerprint fingerprint;
+        in >> path >> fingerprint.size >> fingerprint.modified >> fingerprint.hash;
+        if (in.status() == QDataStream::Ok) {
+            fingerprints.insert(path, fingerprint);
+        }
+    }
+}
+
+void HealthChecker::saveCache()
+{
+    QSaveFile file(cacheFileName);
+    if (!file.open(QIODevice::WriteOnly)) {
+        return;
+    }
+
+    QDataStream out(&file);
+    out << cacheMagic << quint32(fingerprints.size());
+    for (QHash<QString, Fingerprint>::const_iterator it = fingerprints.constBegin(); it != fingerprints.constEnd(); ++it) {
+        out << it.key() << it->size << it->modified << it->hash;
+    }
+    file.commit();
+}
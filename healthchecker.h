@@ -0,0 +1,78 @@
+#ifndef HEALTHCHECKER_H
+#define HEALTHCHECKER_H
+
+#include <QObject>
+#include <QThreadPool>
+#include <QMutex>
+#include <QHash>
+#include <QVector>
+#include <QPair>
+#include <QSet>
+#include <QStringList>
+#include <atomic>
+#include <memory>
+#include "taskscheduler.h"
+
+// Vérification de la bibliothèque en arrière-plan : chaque chemin est
+// consulté en parallèle, un point de montage qui ne répond plus est abandonné
+// après un délai. Les fichiers disparus sont recherchés dans les dossiers
+// surveillés par taille puis par empreinte partielle, et reliés s'ils sont uniques.
+class HealthChecker : public QObject
+{
+    Q_OBJECT
+
+public:
+    struct Result {
+        int checked = 0;
+        QVector<int> missing;
+        QVector<int> unreachable;
+        QVector<QPair<int, QString> > relinked;
+        qint64 elapsedMs = 0;
+    };
+
+    explicit HealthChecker(const QString &cacheFileName, QObject *parent = nullptr);
+    ~HealthChecker();
+
+    bool isRunning() const;
+    void start(const QVector<int> &tracks, const QStringList &paths, const QStringList &watchRoots);
+
+    // Le chemin d'une piste a changé hors de la vérification
+    void pathChanged(const QString &oldPath, const QString &newPath);
+
+signals:
+    void progress(int done, int total);
+    void finished(const HealthChecker::Result &result);
+
+private:
+    struct Fingerprint {
+        qint64 size = -1;
+        qint64 modified = 0;
+        quint64 hash = 0;   // 0 = pas encore calculée
+    };
+
+    struct Job;
+
+    Result run(const QVector<int> &tracks, const QStringList &paths, const QStringList &watchRoots);
+    // Parcours et lectures sur statPool : rien de ce qui peut bloquer ne tourne sur l'ordonnanceur
+    std::shared_ptr<Job> startWalk(const QString &root, const QSet<QString> &libraryPaths, const QSet<qint64> &sizes);
+    void hashFiles(const QVector<QPair<QString, qint64> > &files, int budgetMs, QHash<QString, quint64> *hashes);
+    void awaitJobs(const QVector<std::shared_ptr<Job> > &jobs);
+    static quint64 partialHash(const QString &path, qint64 size);
+    QString mountPointOf(const QString &path) const;
+    void loadCache();
+    void saveCache();
+
+    QString cacheFileName;
+    TaskScheduler::Group tasks;
+    QThreadPool *statPool;
+    std::atomic<bool> running;
+    std::atomic<bool> stopping;
+
+    QMutex cacheMutex;
+    QHash<QString, Fingerprint> fingerprints;
+    QStringList mountPoints;
+};
+
+Q_DECLARE_METATYPE(HealthChecker::Result)
+
+#endif // HEALTHCHECKER_H
@@ -0,0 +1,497 @@
+#include "journal.h"
+#include <QDataStream>
+#include <QDir>
+#include <QSaveFile>
+#include <QBuffer>
+#include <QDebug>
+
+namespace {
+
+const QByteArray snapshotMagic("QTS1");
+const QByteArray journalMagic("QTJ1");
+
+// Seuils de compactage du journal dans l'instantané
+const int compactRecordThreshold = 4096;
+const qint64 compactSizeThreshold = 4 * 1024 * 1024;
+const int compactIntervalMs = 5 * 60 * 1000;
+
+// Chaque enregistrement est précédé de sa taille et de son CRC32
+const int frameHeaderSize = 8;
+
+QVector<quint32> makeCrcTable()
+{
+    QVector<quint32> table(256);
+    for (quint32 i = 0; i < 256; ++i) {
+        quint32 c = i;
+        for (int k = 0; k < 8; ++k) {
+            c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+        }
+        table[int(i)] = c;
+    }
+    return table;
+}
+
+quint32 crc32(const QByteArray &data)
+{
+    static const QVector<quint32> table = makeCrcTable();
+    quint32 crc = 0xFFFFFFFFu;
+    const uchar *bytes = reinterpret_cast<const uchar *>(data.constData());
+    for (int i = 0; i < data.size(); ++i) {
+        crc = table[int((crc ^ bytes[i]) & 0xFF)] ^ (crc >> 8);
+    }
+    return crc ^ 0xFFFFFFFFu;
+}
+
+QByteArray fileHeader(const QByteArray &magic, quint32 generation)
+{
+    QByteArray header;
+    QDataStream out(&header, QIODevice::WriteOnly);
+    out.writeRawData(magic.constData(), magic.size());
+    out << generation;
+    return header;
+}
+
+QByteArray encodeRecord(const Journal::Record &record)
+{
+    QByteArray payload;
+    QDataStream out(&payload, QIODevice::WriteOnly);
+    out << quint8(record.type) << record.path.toUtf8() << record.text.toUtf8() << record.data << record.flag
+        << record.value;
+
+    QByteArray frame;
+    QDataStream header(&frame, QIODevice::WriteOnly);
+    header << quint32(payload.size()) << crc32(payload);
+    frame.append(payload);
+    return frame;
+}
+
+bool decodeRecord(const QByteArray &payload, Journal::Record *record)
+{
+    QDataStream in(payload);
+    quint8 type = 0;
+    QByteArray path;
+    QByteArray text;
+    QByteArray data;
+    bool flag = false;
+    qint64 value = 0;
+    in >> type >> path >> text >> data >> flag;
+    if (!in.atEnd()) {
+        in >> value;
+    }
+
+    if (in.status() != QDataStream::Ok || type < Journal::AddTrack || type > Journal::RelinkTrack) {
+        return false;
+    }
+
+    record->type = Journal::RecordType(type);
+    record->path = QString::fromUtf8(path);
+    record->text = QString::fromUtf8(text);
+    record->data = data;
+    record->flag = flag;
+    record->value = value;
+    return true;
+}
+
+}
+
+
+Journal::Record Journal::addTrack(const QString &path, const QString &name, qint64 dateAdded)
+{
+    Record record;
+    record.type = AddTrack;
+    record.path = path;
+    record.text = name;
+    record.value = dateAdded;
+    return record;
+}
+
+Journal::Record Journal::renameTrack(const QString &path, const QString &name)
+{
+    Record record;
+    record.type = RenameTrack;
+    record.path = path;
+    record.text = name;
+    return record;
+}
+
+Journal::Record Journal::setArtwork(const QString &path, const QImage &image)
+{
+    Record record;
+    record.type = SetArtwork;
+    record.path = path;
+    record.image = image;
+    return record;
+}
+
+Journal::Record Journal::setArtworkFile(const QString &path, const QString &imagePath)
+{
+    Record record;
+    record.type = SetArtwork;
+    record.path = path;
+    record.text = imagePath;
+    return record;
+}
+
+Journal::Record Journal::removeTrack(const QString &path)
+{
+    Record record;
+    record.type = RemoveTrack;
+    record.path = path;
+    return record;
+}
+
+Journal::Record Journal::setSetting(const QString &key, bool value)
+{
+    Record record;
+    record.type = SetSetting;
+    record.path = key;
+    record.flag = value;
+    return record;
+}
+
+Journal::Record Journal::clearLibrary()
+{
+    Record record;
+    record.type = ClearLibrary;
+    return record;
+}
+
+Journal::Record Journal::setSmartPlaylist(const QString &name, const QString &rule)
+{
+    Record record;
+    record.type = SetSmartPlaylist;
+    record.path = name;
+    record.text = rule;
+    return record;
+}
+
+Journal::Record Journal::removeSmartPlaylist(const QString &name)
+{
+    Record record;
+    record.type = RemoveSmartPlaylist;
+    record.path = name;
+    return record;
+}
+
+Journal::Record Journal::relinkTrack(const QString &path, const QString &newPath)
+{
+    Record record;
+    record.type = RelinkTrack;
+    record.path = path;
+    record.text = newPath;
+    return record;
+}
+
+
+Journal::Journal(const QString &directory, QObject *parent)
+    : QObject(parent)
+{
+    qRegisterMetaType<Journal::Record>("Journal::Record");
+
+    // La relecture se fait avant le démarrage du thread d'écriture
+    writer = new JournalWriter(directory);
+    replayed = writer->replay();
+
+    writer->moveToThread(&writerThread);
+    connect(&writerThread, &QThread::started, writer, &JournalWriter::start);
+    connect(&writerThread, &QThread::finished, writer, &QObject::deleteLater);
+    connect(this, &Journal::recordQueued, writer, &JournalWriter::write);
+    connect(this, &Journal::compactRequested, writer, &JournalWriter::compact);
+
+    writerThread.setObjectName("JournalWriter");
+    writerThread.start(QThread::LowPriority);
+}
+
+Journal::~Journal()
+{
+    QMetaObject::invokeMethod(writer, "stop", Qt::BlockingQueuedConnection);
+    writerThread.quit();
+    writerThread.wait();
+}
+
+QVector<Journal::Record> Journal::takeReplayedRecords()
+{
+    QVector<Record> records;
+    records.swap(replayed);
+    return records;
+}
+
+void Journal::append(const Record &record)
+{
+    emit recordQueued(record);
+}
+
+void Journal::compact()
+{
+    emit compactRequested();
+}
+
+
+JournalWriter::JournalWriter(const QString &directory)
+    : compactTimer(nullptr)
+    , generation(0)
+    , nextOrder(1)
+    , recordsSinceSnapshot(0)
+    , journalReplayed(false)
+{
+    QDir().mkpath(directory);
+    snapshotFileName = QDir(directory).filePath("library.snapshot");
+    journalFileName = QDir(directory).filePath("library.journal");
+}
+
+QVector<Journal::Record> JournalWriter::replay()
+{
+    QVector<Journal::Record> records;
+    quint32 snapshotGeneration = 0;
+    qint64 validSize = 0;
+    readFile(snapshotFileName, snapshotMagic, &snapshotGeneration, &records, &validSize);
+    generation = snapshotGeneration;
+
+    // Un journal d'une autre génération a déjà été intégré à l'instantané
+    // (arrêt brutal pendant un compactage) : on l'ignore.
+    QVector<Journal::Record> journalRecords;
+    quint32 journalGeneration = 0;
+    journalReplayed = readFile(journalFileName, journalMagic, &journalGeneration, &journalRecords, &validSize)
+            && journalGeneration == generation;
+
+    if (journalReplayed) {
+        // Un enregistrement tronqué en fin de journal est coupé
+        QFile::resize(journalFileName, validSize);
+        records += journalRecords;
+        recordsSinceSnapshot = journalRecords.size();
+    }
+
+    for (const Journal::Record &record : records) {
+        apply(record);
+    }
+
+    return records;
+}
+
+void JournalWriter::start()
+{
+    compactTimer = new QTimer(this);
+    compactTimer->setInterval(compactIntervalMs);
+    connect(compactTimer, &QTimer::timeout, this, &JournalWriter::compact);
+    compactTimer->start();
+
+    if (!openJournal(!journalReplayed)) {
+        qWarning() << "Impossible d'ouvrir le journal :" << journalFileName;
+    }
+}
+
+void JournalWriter::write(const Journal::Record &record)
+{
+    Journal::Record encoded = record;
+    if (!encoded.image.isNull()) {
+        QBuffer buffer(&encoded.data);
+        buffer.open(QIODevice::WriteOnly);
+        encoded.image.save(&buffer, "PNG");
+        encoded.image = QImage();
+    }
+
+    apply(encoded);
+
+    if (!journalFile.isOpen()) {
+        return;
+    }
+
+    journalFile.write(encodeRecord(encoded));
+    journalFile.flush();
+    ++recordsSinceSnapshot;
+
+    if (recordsSinceSnapshot >= compactRecordThreshold || journalFile.size() >= compactSizeThreshold) {
+        compact();
+    }
+}
+
+void JournalWriter::compact()
+{
+    if (recordsSinceSnapshot == 0) {
+        return;
+    }
+
+    // L'instantané est écrit à côté puis renommé : il est complet ou absent
+    const quint32 nextGeneration = generation + 1;
+    QSaveFile snapshot(snapshotFileName);
+    if (!snapshot.open(QIODevice::WriteOnly)) {
+        qWarning() << "Impossible d'écrire l'instantané :" << snapshotFileName;
+        return;
+    }
+
+    snapshot.write(fileHeader(snapshotMagic, nextGeneration));
+    for (QMap<qint64, PathKey>::const_iterator it = order.constBegin(); it != order.constEnd(); ++it) {
+        const Entry entry = entries.value(it.value());
+        const QString path = paths.filePath(it->first, it->second);
+        snapshot.write(encodeRecord(Journal::addTrack(path, entry.name, entry.dateAdded)));
+        if (!entry.artwork.isEmpty() || !entry.artworkFile.isEmpty()) {
+            Journal::Record artwork;
+            artwork.type = Journal::SetArtwork;
+            artwork.path = path;
+            artwork.text = entry.artworkFile;
+            artwork.data = entry.artwork;
+            snapshot.write(encodeRecord(artwork));
+        }
+    }
+    for (QHash<QString, bool>::const_iterator it = settings.constBegin(); it != settings.constEnd(); ++it) {
+        snapshot.write(encodeRecord(Journal::setSetting(it.key(), it.value())));
+    }
+    for (QMap<QString, QString>::const_iterator it = smartPlaylists.constBegin(); it != smartPlaylists.constEnd(); ++it) {
+        snapshot.write(encodeRecord(Journal::setSmartPlaylist(it.key(), it.value())));
+    }
+
+    if (!snapshot.commit()) {
+        qWarning() << "Impossible d'écrire l'instantané :" << snapshotFileName;
+        return;
+    }
+
+    generation = nextGeneration;
+    journalFile.close();
+    openJournal(true);
+    recordsSinceSnapshot = 0;
+}
+
+void JournalWriter::stop()
+{
+    if (compactTimer) {
+        compactTimer->stop();
+    }
+    if (journalFile.isOpen()) {
+        journalFile.flush();
+        journalFile.close();
+    }
+}
+
+void JournalWriter::apply(const Journal::Record &record)
+{
+    switch (record.type) {
+    case Journal::AddTrack: {
+        const PathKey key = keyFor(record.path, true);
+        Entry &entry = entries[key];
+        if (entry.order == 0) {
+            entry.order = nextOrder++;
+            entry.dateAdded = record.value;
+            order.insert(entry.order, key);
+        }
+        entry.name = record.text;
+        break;
+    }
+    case Journal::RenameTrack: {
+        QHash<PathKey, Entry>::iterator it = entries.find(keyFor(record.path, false));
+        if (it != entries.end()) {
+            it->name = record.text;
+        }
+        break;
+    }
+    case Journal::SetArtwork: {
+        QHash<PathKey, Entry>::iterator it = entries.find(keyFor(record.path, false));
+        if (it != entries.end()) {
+            it->artwork = record.data;
+            it->artworkFile = record.text;
+        }
+        break;
+    }
+    case Journal::RemoveTrack: {
+        QHash<PathKey, Entry>::iterator it = entries.find(keyFor(record.path, false));
+        if (it != entries.end()) {
+            order.remove(it->order);
+            entries.erase(it);
+        }
+        break;
+    }
+    case Journal::SetSetting:
+        settings.insert(record.path, record.flag);
+        break;
+    case Journal::ClearLibrary:
+        order.clear();
+        entries.clear();
+        paths.clear();
+        smartPlaylists.clear();
+        break;
+    case Journal::SetSmartPlaylist:
+        smartPlaylists.insert(record.path, record.text);
+        break;
+    case Journal::RemoveSmartPlaylist:
+        smartPlaylists.remove(record.path);
+        break;
+    case Journal::RelinkTrack: {
+        // La piste garde sa place dans l'ordre d'ajout
+        QHash<PathKey, Entry>::iterator it = entries.find(keyFor(record.path, false));
+        const PathKey newKey = keyFor(record.text, true);
+        if (it != entries.end() && !entries.contains(newKey)) {
+            const Entry entry = it.value();
+            entries.erase(it);
+            entries.insert(newKey, entry);
+            order.insert(entry.order, newKey);
+        }
+        break;
+    }
+    }
+}
+
+JournalWriter::PathKey JournalWriter::keyFor(const QString &path, bool create)
+{
+    QString directoryPath;
+    QString fileName;
+    PathTable::split(path, &directoryPath, &fileName);
+    return PathKey(create ? paths.insert(directoryPath) : paths.find(directoryPath), fileName);
+}
+
+bool JournalWriter::readFile(const QString &fileName, const QByteArray &magic, quint32 *fileGeneration,
+                             QVector<Journal::Record> *records, qint64 *validSize)
+{
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+    const QByteArray content = file.readAll();
+    file.close();
+
+    const int headerSize = magic.size() + int(sizeof(quint32));
+    if (content.size() < headerSize || !content.startsWith(magic)) {
+        return false;
+    }
+
+    QDataStream in(content);
+    in.skipRawData(magic.size());
+    in >> *fileGeneration;
+
+    // On s'arrête au premier enregistrement incomplet ou corrompu
+    qint64 offset = headerSize;
+    while (offset + frameHeaderSize <= content.size()) {
+        quint32 length = 0;
+        quint32 checksum = 0;
+        in >> length >> checksum;
+        if (offset + frameHeaderSize + qint64(length) > content.size()) {
+            break;
+        }
+
+        const QByteArray payload = content.mid(int(offset) + frameHeaderSize, int(length));
+        Journal::Record record;
+        if (crc32(payload) != checksum || !decodeRecord(payload, &record)) {
+            break;
+        }
+
+        in.skipRawData(int(length));
+        records->append(record);
+        offset += frameHeaderSize + qint64(length);
+    }
+
+    *validSize = offset;
+    return true;
+}
+
+bool JournalWriter::openJournal(bool truncate)
+{
+    journalFile.setFileName(journalFileName);
+    if (truncate) {
+        if (!journalFile.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+            return false;
+        }
+        journalFile.write(fileHeader(journalMagic, generation));
+        journalFile.flush();
+        journalReplayed = true;
+        return true;
+    }
+    return journalFile.open(QIODevice::WriteOnly | QIODevice::Append);
+}
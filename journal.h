@@ -0,0 +1,133 @@
+#ifndef JOURNAL_H
+#define JOURNAL_H
+
+#include <QObject>
+#include <QThread>
+#include <QFile>
+#include <QHash>
+#include <QMap>
+#include <QVector>
+#include <QByteArray>
+#include <QString>
+#include <QTimer>
+#include <QImage>
+#include <QPair>
+#include "pathtable.h"
+
+class JournalWriter;
+
+// Sauvegarde automatique : chaque modification de la bibliothèque est
+// ajoutée à la fin d'un journal par un thread d'écriture, puis le journal
+// est périodiquement compacté dans un instantané.
+class Journal : public QObject
+{
+    Q_OBJECT
+
+public:
+    enum RecordType : quint8 {
+        AddTrack = 1,
+        RenameTrack = 2,
+        SetArtwork = 3,
+        RemoveTrack = 4,
+        SetSetting = 5,
+        ClearLibrary = 6,
+        SetSmartPlaylist = 7,
+        RemoveSmartPlaylist = 8,
+        RelinkTrack = 9
+    };
+
+    struct Record {
+        RecordType type = AddTrack;
+        QString path;       // identifiant de la piste (ou nom du réglage, de la liste)
+        QString text;       // nom affiché, fichier de la pochette, règle de la liste ou nouveau chemin
+        QByteArray data;    // image encodée en PNG (anciennes sauvegardes)
+        QImage image;       // image à encoder par le thread d'écriture
+        bool flag = false;  // valeur du réglage
+        qint64 value = 0;   // date d'ajout
+    };
+
+    static Record addTrack(const QString &path, const QString &name, qint64 dateAdded);
+    static Record renameTrack(const QString &path, const QString &name);
+    static Record setArtwork(const QString &path, const QImage &image);
+    static Record setArtworkFile(const QString &path, const QString &imagePath);
+    static Record removeTrack(const QString &path);
+    static Record setSetting(const QString &key, bool value);
+    static Record clearLibrary();
+    static Record setSmartPlaylist(const QString &name, const QString &rule);
+    static Record removeSmartPlaylist(const QString &name);
+    static Record relinkTrack(const QString &path, const QString &newPath);
+
+    explicit Journal(const QString &directory, QObject *parent = nullptr);
+    ~Journal();
+
+    // Enregistrements relus au démarrage (instantané puis journal).
+    QVector<Record> takeReplayedRecords();
+
+    void append(const Record &record);
+    void compact();
+
+signals:
+    void recordQueued(const Journal::Record &record);
+    void compactRequested();
+
+private:
+    QThread writerThread;
+    JournalWriter *writer;
+    QVector<Record> replayed;
+};
+
+Q_DECLARE_METATYPE(Journal::Record)
+
+// Vit dans le thread d'écriture. Garde une copie compacte de l'état de la
+// bibliothèque pour pouvoir écrire l'instantané sans solliciter l'interface.
+class JournalWriter : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit JournalWriter(const QString &directory);
+
+    QVector<Journal::Record> replay();
+
+public slots:
+    void start();
+    void write(const Journal::Record &record);
+    void compact();
+    void stop();
+
+private:
+    struct Entry {
+        qint64 order = 0;
+        qint64 dateAdded = 0;
+        QString name;
+        QByteArray artwork;
+        QString artworkFile;
+    };
+
+    typedef QPair<int, QString> PathKey;
+
+    void apply(const Journal::Record &record);
+    // Clé (dossier, nom) d'un chemin ; dossier -1 s'il est inconnu et que create est faux
+    PathKey keyFor(const QString &path, bool create);
+    bool readFile(const QString &fileName, const QByteArray &magic, quint32 *generation,
+                  QVector<Journal::Record> *records, qint64 *validSize);
+    bool openJournal(bool truncate);
+
+    QString snapshotFileName;
+    QString journalFileName;
+    QFile journalFile;
+    QTimer *compactTimer;
+    quint32 generation;
+    qint64 nextOrder;
+    int recordsSinceSnapshot;
+    bool journalReplayed;
+
+    // Chemins gardés en arbre de dossiers, reconstruits à l'écriture de l'instantané
+    PathTable paths;
+    QMap<qint64, PathKey> order;
+    QHash<PathKey, Entry> entries;
+    QHash<QString, bool> settings;
+    QMap<QString, QString> smartPlaylists;
+};
+
+#endif // JOURNAL_H
@@ -1,4 +1,5 @@
 #include "qticallymainwindow.h"
+#include "singleinstance.h"
 
 #include <QApplication>
 
@@ -6,7 +7,22 @@ int main(int argc, char *argv[])
 {
 
     QApplication a(argc, argv);
+
+    // Une instance tourne déjà : elle reçoit les fichiers et les commandes
+    const QStringList arguments = SingleInstance::normalizedArguments(a.arguments().mid(1));
+    SingleInstance instance;
+    if (instance.forward(arguments)) {
+        return 0;
+    }
+    if (!instance.listen() && instance.forward(arguments)) {
+        return 0;
+    }
+
     QticallyMainWindow w;
+    QObject::connect(&instance, &SingleInstance::argumentsReceived, &w, &QticallyMainWindow::openArguments);
     w.show();
+    if (!arguments.isEmpty()) {
+        w.openArguments(arguments);
+    }
     return a.exec();
 }
@@ -0,0 +1,138 @@
+#include "memorydialog.h"
+#include "ui_memorydialog.h"
+#include <QFileDialog>
+#include <QMessageBox>
+#include <QJsonDocument>
+#include <QHeaderView>
+#include <QFile>
+#include <QDateTime>
+
+namespace {
+
+enum Columns {
+    NameColumn = 0,
+    CurrentColumn,
+    PeakColumn,
+    BudgetColumn,
+    ColumnCount
+};
+
+const qint64 megabyte = 1024 * 1024;
+
+}
+
+MemoryDialog::MemoryDialog(MemoryMonitor *monitor, QWidget *parent)
+    : QDialog(parent)
+    , ui(new Ui::MemoryDialog)
+    , monitor(monitor)
+{
+    ui->setupUi(this);
+
+    QTableWidget *table = ui->memoryTable;
+    table->setColumnCount(ColumnCount);
+    table->setRowCount(MemoryMonitor::SubsystemCount);
+    table->setHorizontalHeaderLabels(QStringList() << "Sous-système" << "Actuel" << "Pic" << "Budget");
+    table->verticalHeader()->hide();
+    table->horizontalHeader()->setSectionResizeMode(NameColumn, QHeaderView::Stretch);
+
+    // Budget en Mo, 0 = illimité
+    for (int row = 0; row < MemoryMonitor::SubsystemCount; ++row) {
+        const MemoryMonitor::Subsystem subsystem = MemoryMonitor::Subsystem(row);
+        table->setItem(row, NameColumn, new QTableWidgetItem(MemoryMonitor::subsystemName(subsystem)));
+        table->setItem(row, CurrentColumn, new QTableWidgetItem);
+        table->setItem(row, PeakColumn, new QTableWidgetItem);
+
+        QSpinBox *budget = new QSpinBox(table);
+        budget->setRange(0, 64 * 1024);
+        budget->setSuffix(" Mo");
+        budget->setSpecialValueText("Illimité");
+        budget->setValue(int(monitor->budget(subsystem) / megabyte));
+        connect(budget, &QSpinBox::editingFinished, this, [this, row]() {
+            budgetEdited(row);
+        });
+        table->setCellWidget(row, BudgetColumn, budget);
+        budgetEditors.append(budget);
+    }
+
+    // Relevé une fois par seconde, seulement quand le panneau est visible
+    refreshTimer = new QTimer(this);
+    refreshTimer->setInterval(1000);
+    connect(refreshTimer, &QTimer::timeout, monitor, &MemoryMonitor::refresh);
+    connect(monitor, &MemoryMonitor::updated, this, &MemoryDialog::updateTable);
+
+    connect(ui->exportButton, &QPushButton::clicked, this, &MemoryDialog::exportJson);
+}
+
+MemoryDialog::~MemoryDialog()
+{
+    delete ui;
+}
+
+QString MemoryDialog::formatBytes(qint64 bytes)
+{
+    if (bytes >= megabyte) {
+        return QString::number(double(bytes) / megabyte, 'f', 1) + " Mo";
+    }
+    if (bytes >= 1024) {
+        return QString::number(double(bytes) / 1024, 'f', 1) + " Ko";
+    }
+    return QString::number(bytes) + " o";
+}
+
+void MemoryDialog::showEvent(QShowEvent *event)
+{
+    QDialog::showEvent(event);
+    monitor->refresh();
+    refreshTimer->start();
+}
+
+void MemoryDialog::hideEvent(QHideEvent *event)
+{
+    refreshTimer->stop();
+    QDialog::hideEvent(event);
+}
+
+void MemoryDialog::updateTable()
+{
+    for (int row = 0; row < MemoryMonitor::SubsystemCount; ++row) {
+        const MemoryMonitor::Subsystem subsystem = MemoryMonitor::Subsystem(row);
+        QTableWidgetItem *current = ui->memoryTable->item(row, CurrentColumn);
+        current->setText(formatBytes(monitor->bytes(subsystem)));
+        current->setForeground(monitor->overBudget(subsystem) ? QBrush(Qt::red) : QBrush());
+        ui->memoryTable->item(row, PeakColumn)->setText(formatBytes(monitor->peakBytes(subsystem)));
+    }
+
+    QString resident = "Mémoire résidente du processus : " + formatBytes(monitor->residentBytes());
+    if (monitor->peakResidentBytes() > 0) {
+        resident += " (pic " + formatBytes(monitor->peakResidentBytes()) + ")";
+    }
+    ui->residentLabel->setText(resident);
+}
+
+void MemoryDialog::budgetEdited(int row)
+{
+    const MemoryMonitor::Subsystem subsystem = MemoryMonitor::Subsystem(row);
+    const qint64 budget = qint64(budgetEditors.at(row)->value()) * megabyte;
+    if (budget != monitor->budget(subsystem)) {
+        monitor->setBudget(subsystem, budget);
+        monitor->refresh();
+    }
+}
+
+void MemoryDialog::exportJson()
+{
+    QString defaultFileName = "memoire_" + QDateTime::currentDateTime().toString("yyyy-MM-dd_hh-mm-ss") + ".json";
+    QString fileName = QFileDialog::getSaveFileName(this, "Exporter", defaultFileName, "Fichiers JSON (*.json)");
+    if (fileName.isEmpty()) {
+        return;
+    }
+
+    monitor->refresh();
+    QFile file(fileName);
+    if (file.open(QIODevice::WriteOnly)) {
+        file.write(QJsonDocument(monitor->toJson()).toJson());
+        file.close();
+    } else {
+        QMessageBox::warning(this, "Erreur", "Impossible d'enregistrer le relevé mémoire.");
+    }
+}
@@ -0,0 +1,42 @@
+#ifndef MEMORYDIALOG_H
+#define MEMORYDIALOG_H
+
+#include <QDialog>
+#include <QTimer>
+#include <QVector>
+#include <QSpinBox>
+#include "memorymonitor.h"
+
+namespace Ui {
+class MemoryDialog;
+}
+
+// Panneau mémoire : consommation courante et pic de chaque sous-système,
+// budgets modifiables et export JSON.
+class MemoryDialog : public QDialog
+{
+    Q_OBJECT
+
+public:
+    explicit MemoryDialog(MemoryMonitor *monitor, QWidget *parent = nullptr);
+    ~MemoryDialog();
+
+    static QString formatBytes(qint64 bytes);
+
+protected:
+    void showEvent(QShowEvent *event) override;
+    void hideEvent(QHideEvent *event) override;
+
+private slots:
+    void updateTable();
+    void budgetEdited(int row);
+    void exportJson();
+
+private:
+    Ui::MemoryDialog *ui;
+    MemoryMonitor *monitor;
+    QTimer *refreshTimer;
+    QVector<QSpinBox *> budgetEditors;
+};
+
+#endif // MEMORYDIALOG_H
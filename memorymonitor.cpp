@@ -0,0 +1,158 @@
+#include "memorymonitor.h"
+#include <QSettings>
+#include <QFile>
+#include <QJsonArray>
+#include <QDateTime>
+
+#ifdef Q_OS_LINUX
+#include <unistd.h>
+#endif
+
+namespace {
+
+const char *const subsystemKeys[MemoryMonitor::SubsystemCount] = {
+    "trackStore",
+    "strings",
+    "artwork",
+    "search",
+    "audioBuffers"
+};
+
+// Budgets par défaut : seuls les caches qui peuvent se reconstruire en ont un
+const qint64 defaultBudgets[MemoryMonitor::SubsystemCount] = {
+    0,
+    0,
+    64 * 1024 * 1024,
+    256 * 1024 * 1024,
+    0
+};
+
+#ifdef Q_OS_LINUX
+qint64 statusField(const QByteArray &field)
+{
+    QFile status("/proc/self/status");
+    if (!status.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        return 0;
+    }
+    const QList<QByteArray> lines = status.readAll().split('\n');
+    for (const QByteArray &line : lines) {
+        if (line.startsWith(field)) {
+            return line.mid(field.size()).trimmed().split(' ').value(0).toLongLong() * 1024;
+        }
+    }
+    return 0;
+}
+#endif
+
+}
+
+MemoryMonitor::MemoryMonitor(QObject *parent)
+    : QObject(parent)
+    , current(SubsystemCount, 0)
+    , peaks(SubsystemCount, 0)
+    , budgets(SubsystemCount, 0)
+{
+    QSettings settings;
+    for (int i = 0; i < SubsystemCount; ++i) {
+        budgets[i] = settings.value(QString("memory/budget/") + subsystemKeys[i], defaultBudgets[i]).toLongLong();
+    }
+}
+
+QString MemoryMonitor::subsystemName(Subsystem subsystem)
+{
+    switch (subsystem) {
+    case TrackStore:
+        return tr("Table des pistes");
+    case Strings:
+        return tr("Chaînes");
+    case Artwork:
+        return tr("Pochettes");
+    case Search:
+        return tr("Tri et recherche");
+    case AudioBuffers:
+        return tr("Tampons audio");
+    default:
+        return QString();
+    }
+}
+
+void MemoryMonitor::report(Subsystem subsystem, qint64 bytes)
+{
+    current[subsystem] = bytes;
+    peaks[subsystem] = qMax(peaks[subsystem], bytes);
+}
+
+qint64 MemoryMonitor::bytes(Subsystem subsystem) const
+{
+    return current.at(subsystem);
+}
+
+qint64 MemoryMonitor::peakBytes(Subsystem subsystem) const
+{
+    return peaks.at(subsystem);
+}
+
+qint64 MemoryMonitor::budget(Subsystem subsystem) const
+{
+    return budgets.at(subsystem);
+}
+
+void MemoryMonitor::setBudget(Subsystem subsystem, qint64 bytes)
+{
+    budgets[subsystem] = qMax<qint64>(0, bytes);
+    QSettings settings;
+    settings.setValue(QString("memory/budget/") + subsystemKeys[subsystem], budgets[subsystem]);
+    emit budgetChanged(subsystem, budgets[subsystem]);
+}
+
+bool MemoryMonitor::overBudget(Subsystem subsystem) const
+{
+    return budgets.at(subsystem) > 0 && current.at(subsystem) > budgets.at(subsystem);
+}
+
+qint64 MemoryMonitor::residentBytes() const
+{
+#ifdef Q_OS_LINUX
+    QFile statm("/proc/self/statm");
+    if (statm.open(QIODevice::ReadOnly)) {
+        const QList<QByteArray> fields = statm.readAll().split(' ');
+        return fields.value(1).toLongLong() * sysconf(_SC_PAGESIZE);
+    }
+#endif
+    return 0;
+}
+
+qint64 MemoryMonitor::peakResidentBytes() const
+{
+#ifdef Q_OS_LINUX
+    return statusField("VmHWM:");
+#else
+    return 0;
+#endif
+}
+
+QJsonObject MemoryMonitor::toJson() const
+{
+    QJsonArray subsystems;
+    for (int i = 0; i < SubsystemCount; ++i) {
+        QJsonObject subsystem;
+        subsystem["name"] = QString(subsystemKeys[i]);
+        subsystem["bytes"] = double(current.at(i));
+        subsystem["peakBytes"] = double(peaks.at(i));
+        subsystem["budgetBytes"] = double(budgets.at(i));
+        subsystems.append(subsystem);
+    }
+
+    QJsonObject report;
+    report["timestamp"] = QDateTime::currentDateTime().toString(Qt::ISODate);
+    report["residentBytes"] = double(residentBytes());
+    report["peakResidentBytes"] = double(peakResidentBytes());
+    report["subsystems"] = subsystems;
+    return report;
+}
+
+void MemoryMonitor::refresh()
+{
+    emit sampleRequested();
+    emit updated();
+}
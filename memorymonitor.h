@@ -0,0 +1,56 @@
+#ifndef MEMORYMONITOR_H
+#define MEMORYMONITOR_H
+
+#include <QObject>
+#include <QJsonObject>
+#include <QVector>
+
+// Comptabilité mémoire par sous-système, avec pics et budgets.
+// Les valeurs sont fournies par leurs propriétaires lors d'un relevé.
+class MemoryMonitor : public QObject
+{
+    Q_OBJECT
+
+public:
+    enum Subsystem {
+        TrackStore = 0,
+        Strings,
+        Artwork,
+        Search,
+        AudioBuffers,
+        SubsystemCount
+    };
+
+    explicit MemoryMonitor(QObject *parent = nullptr);
+
+    static QString subsystemName(Subsystem subsystem);
+
+    void report(Subsystem subsystem, qint64 bytes);
+    qint64 bytes(Subsystem subsystem) const;
+    qint64 peakBytes(Subsystem subsystem) const;
+
+    // Budget en octets, 0 = illimité. Conservé dans les réglages.
+    qint64 budget(Subsystem subsystem) const;
+    void setBudget(Subsystem subsystem, qint64 bytes);
+    bool overBudget(Subsystem subsystem) const;
+
+    qint64 residentBytes() const;
+    qint64 peakResidentBytes() const;
+
+    QJsonObject toJson() const;
+
+public slots:
+    void refresh();
+
+signals:
+    void sampleRequested();
+    void budgetChanged(MemoryMonitor::Subsystem subsystem, qint64 bytes);
+    void updated();
+
+private:
+    QVector<qint64> current;
+    QVector<qint64> peaks;
+    QVector<qint64> budgets;
+};
+
+#endif // MEMORYMONITOR_H
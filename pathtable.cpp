@@ -0,0 +1,200 @@
+#include "pathtable.h"
+#include <QVarLengthArray>
+
+namespace {
+
+// Profondeur habituelle d'un chemin : au-delà, le tableau passe sur le tas
+const int typicalDepth = 32;
+
+// Nœud de QHash : pointeur suivant, hachage, clé et valeur
+const qint64 hashNodeBytes = 32;
+
+qint64 stringBytes(const QString &text)
+{
+    return text.isNull() ? 0 : qint64(sizeof(QArrayData)) + (qint64(text.capacity()) + 1) * 2;
+}
+
+}
+
+
+PathTable::PathTable()
+{
+    clear();
+}
+
+int PathTable::insert(const QString &directoryPath)
+{
+    int directory = 0;
+    for (const QString &segment : segmentsOf(directoryPath)) {
+        const QPair<int, QString> key(directory, segment);
+        QHash<QPair<int, QString>, int>::const_iterator it = childIds.constFind(key);
+        if (it != childIds.constEnd()) {
+            directory = it.value();
+            continue;
+        }
+
+        Node node;
+        node.parent = directory;
+        node.name = segment;
+        const int id = nodes.size();
+        nodes.append(node);
+        nodes[directory].children.append(id);
+        childIds.insert(key, id);
+        directory = id;
+    }
+    return directory;
+}
+
+int PathTable::find(const QString &directoryPath) const
+{
+    int directory = 0;
+    for (const QString &segment : segmentsOf(directoryPath)) {
+        directory = childIds.value(qMakePair(directory, segment), -1);
+        if (directory < 0) {
+            return -1;
+        }
+    }
+    return directory;
+}
+
+int PathTable::count() const
+{
+    return nodes.size();
+}
+
+QString PathTable::path(int directory) const
+{
+    if (directory <= 0 || directory >= nodes.size()) {
+        return QString();
+    }
+    const QString result = filePath(directory, QString());
+    // Seul le dossier racine d'Unix donne un chemin vide
+    return result.size() > 1 ? result.left(result.size() - 1) : QString("/");
+}
+
+QString PathTable::filePath(int directory, const QString &fileName) const
+{
+    if (directory <= 0 || directory >= nodes.size()) {
+        return fileName;
+    }
+
+    QVarLengthArray<int, typicalDepth> chain;
+    for (int node = directory; node > 0; node = nodes.at(node).parent) {
+        chain.append(node);
+    }
+
+    QString result;
+    result.reserve(pathLength(directory) + 1 + fileName.size());
+    for (int i = chain.size() - 1; i >= 0; --i) {
+        if (i < chain.size() - 1) {
+            result += '/';
+        }
+        result += nodes.at(chain.at(i)).name;
+    }
+    result += '/';
+    result += fileName;
+    return result;
+}
+
+int PathTable::pathLength(int directory) const
+{
+    int length = -1;
+    for (int node = directory; node > 0 && node < nodes.size(); node = nodes.at(node).parent) {
+        length += nodes.at(node).name.size() + 1;
+    }
+    return qMax(0, length);
+}
+
+QVector<int> PathTable::subtree(int directory) const
+{
+    QVector<int> result;
+    if (directory < 0 || directory >= nodes.size()) {
+        return result;
+    }
+    result.append(directory);
+    for (int i = 0; i < result.size(); ++i) {
+        result += nodes.at(result.at(i)).children;
+    }
+    return result;
+}
+
+bool PathTable::move(int directory, const QString &newPath)
+{
+    if (directory <= 0 || directory >= nodes.size()) {
+        return false;
+    }
+
+    QString parentPath;
+    QString name;
+    split(newPath, &parentPath, &name);
+    if (name.isEmpty()) {
+        return false;
+    }
+    // La racine d'Unix finit déjà par '/' : "//" ne reconnaîtrait aucun descendant
+    const QString oldPath = path(directory);
+    const QString oldPrefix = oldPath.endsWith('/') ? oldPath : oldPath + '/';
+    if (parentPath == oldPath || parentPath.startsWith(oldPrefix)) {
+        return false;
+    }
+    // Destination cherchée avant d'être créée : un refus ne laisse pas de dossier vide
+    const int existingParent = find(parentPath);
+    if (existingParent >= 0 && childIds.contains(qMakePair(existingParent, name))) {
+        return false;
+    }
+
+    const int parent = existingParent >= 0 ? existingParent : insert(parentPath);
+    Node &node = nodes[directory];
+    childIds.remove(qMakePair(node.parent, node.name));
+    nodes[node.parent].children.removeOne(directory);
+    node.parent = parent;
+    node.name = name;
+    nodes[parent].children.append(directory);
+    childIds.insert(qMakePair(parent, name), directory);
+    return true;
+}
+
+void PathTable::clear()
+{
+    nodes.clear();
+    childIds.clear();
+    nodes.append(Node());
+}
+
+qint64 PathTable::memoryUsage() const
+{
+    // Les clés de childIds partagent les noms des nœuds
+    qint64 bytes = qint64(nodes.capacity()) * qint64(sizeof(Node))
+            + qint64(childIds.capacity()) * qint64(sizeof(void *)) + qint64(childIds.size()) * hashNodeBytes;
+    for (const Node &node : nodes) {
+        bytes += stringBytes(node.name) + qint64(node.children.capacity()) * qint64(sizeof(int));
+    }
+    return bytes;
+}
+
+void PathTable::split(const QString &filePath, QString *directoryPath, QString *fileName)
+{
+    const int slash = filePath.lastIndexOf('/');
+    if (slash < 0) {
+        directoryPath->clear();
+        *fileName = filePath;
+        return;
+    }
+    *directoryPath = slash == 0 ? QString("/") : filePath.left(slash);
+    *fileName = filePath.mid(slash + 1);
+}
+
+QStringList PathTable::segmentsOf(const QString &directoryPath)
+{
+    QString trimmed = directoryPath;
+    while (trimmed.size() > 1 && trimmed.endsWith('/')) {
+        trimmed.chop(1);
+    }
+    if (trimmed.isEmpty()) {
+        return QStringList();
+    }
+    // Racine d'Unix : un seul segment vide, comme le début de "/home"
+    if (trimmed == "/") {
+        return QStringList() << QString("");
+    }
+    return trimmed.split('/');
+}
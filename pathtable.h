@@ -0,0 +1,55 @@
+#ifndef PATHTABLE_H
+#define PATHTABLE_H
+
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include <QHash>
+#include <QPair>
+
+// Arbre des dossiers de la bibliothèque : chaque dossier n'est gardé qu'une
+// fois, comme (dossier parent, nom). Une piste ne garde que son dossier et
+// son nom de fichier ; le chemin complet n'est reconstruit qu'à la demande.
+// Les identifiants de dossier ne sont jamais réutilisés, 0 est la racine.
+class PathTable
+{
+public:
+    PathTable();
+
+    // Dossier d'un chemin, créé au besoin
+    int insert(const QString &directoryPath);
+    // -1 si le dossier n'est pas connu
+    int find(const QString &directoryPath) const;
+    int count() const;
+
+    QString path(int directory) const;
+    QString filePath(int directory, const QString &fileName) const;
+    // Longueur de path(), sans le construire
+    int pathLength(int directory) const;
+
+    // Le dossier et tous ses sous-dossiers
+    QVector<int> subtree(int directory) const;
+    // Renomme ou déplace un dossier, son sous-arbre suit. Faux si la
+    // destination est déjà un dossier connu ou se trouve dans le sous-arbre
+    bool move(int directory, const QString &newPath);
+
+    void clear();
+    qint64 memoryUsage() const;
+
+    // Chemin de fichier séparé en dossier et nom
+    static void split(const QString &filePath, QString *directoryPath, QString *fileName);
+
+private:
+    struct Node {
+        int parent = -1;
+        QString name;
+        QVector<int> children;
+    };
+
+    static QStringList segmentsOf(const QString &directoryPath);
+
+    QVector<Node> nodes;
+    QHash<QPair<int, QString>, int> childIds;
+};
+
+#endif // PATHTABLE_H
@@ -0,0 +1,362 @@
+#include "playhistory.h"
+#include <QFile>
+#include <QDateTime>
+#include <QDebug>
+#include <algorithm>
+
+namespace {
+
+const QByteArray historyMagic("QPH1");
+const quint8 defineTag = 1;
+const quint8 relinkTag = 5;
+const int flushIntervalMs = 5000;
+const qint64 dayMs = 24 * 3600 * 1000;
+const int rollingWindowDays = 30;
+// Position enregistrée au dixième de seconde
+const int positionUnitMs = 100;
+
+void writeVarint(QByteArray &out, quint64 value)
+{
+    while (value >= 0x80) {
+        out.append(char((value & 0x7F) | 0x80));
+        value >>= 7;
+    }
+    out.append(char(value));
+}
+
+bool readVarint(const QByteArray &in, int *pos, quint64 *value)
+{
+    quint64 result = 0;
+    for (int shift = 0; shift < 64 && *pos < in.size(); shift += 7) {
+        const quint8 byte = quint8(in.at((*pos)++));
+        result |= quint64(byte & 0x7F) << shift;
+        if (!(byte & 0x80)) {
+            *value = result;
+            return true;
+        }
+    }
+    return false;
+}
+
+// Delta signé (horloge reculée) replié en entier positif
+quint64 zigzag(qint64 value)
+{
+    return (quint64(value) << 1) ^ quint64(value >> 63);
+}
+
+qint64 unzigzag(quint64 value)
+{
+    return qint64(value >> 1) ^ -qint64(value & 1);
+}
+
+void appendToFile(const QString &fileName, const QByteArray &data)
+{
+    QFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Append)) {
+        qWarning() << "Impossible d'écrire l'historique :" << fileName;
+        return;
+    }
+    file.write(data);
+}
+
+}
+
+PlayHistory::PlayHistory(const QString &fileName, QObject *parent)
+    : QObject(parent)
+    , fileName(fileName)
+    , lastTimestamp(0)
+    , events(0)
+    , writing(false)
+{
+    load();
+
+    flushTimer = new QTimer(this);
+    flushTimer->setSingleShot(true);
+    flushTimer->setInterval(flushIntervalMs);
+    connect(flushTimer, &QTimer::timeout, this, &PlayHistory::flush);
+}
+
+PlayHistory::~PlayHistory()
+{
+    flush();
+    tasks.wait();
+}
+
+int PlayHistory::windowDays()
+{
+    return rollingWindowDays;
+}
+
+void PlayHistory::record(EventType type, const QString &path, qint64 position)
+{
+    if (path.isEmpty()) {
+        return;
+    }
+
+    const qint64 now = QDateTime::currentMSecsSinceEpoch();
+    const int key = keyFor(path);
+    pending.append(char(type));
+    writeVarint(pending, quint64(key));
+    writeVarint(pending, zigzag(now - lastTimestamp));
+    writeVarint(pending, quint64(qMax<qint64>(0, position) / positionUnitMs));
+    lastTimestamp = now;
+
+    apply(type, key, now);
+    expireWindow(now);
+
+    if (!flushTimer->isActive()) {
+        flushTimer->start();
+    }
+}
+
+void PlayHistory::relink(const QString &oldPath, const QString &newPath)
+{
+    const int key = keys.value(oldPath, -1);
+    if (key < 0 || keys.contains(newPath)) {
+        return;
+    }
+    keys.remove(oldPath);
+    keys.insert(newPath, key);
+    paths[key] = newPath;
+
+    const QByteArray utf8 = newPath.toUtf8();
+    pending.append(char(relinkTag));
+    writeVarint(pending, quint64(key));
+    writeVarint(pending, quint64(utf8.size()));
+    pending.append(utf8);
+    if (!flushTimer->isActive()) {
+        flushTimer->start();
+    }
+}
+
+PlayHistory::Stats PlayHistory::stats(const QString &path) const
+{
+    const int key = keys.value(path, -1);
+    return key >= 0 ? totals.at(key) : Stats();
+}
+
+int PlayHistory::eventCount() const
+{
+    return events;
+}
+
+QStringList PlayHistory::mostPlayed(int count, bool recentOnly) const
+{
+    QVector<int> candidates;
+    for (int key = 0; key < totals.size(); ++key) {
+        if ((recentOnly ? totals.at(key).recentPlays : totals.at(key).plays) > 0) {
+            candidates.append(key);
+        }
+    }
+
+    const int kept = qMin(count, candidates.size());
+    std::partial_sort(candidates.begin(), candidates.begin() + kept, candidates.end(), [this, recentOnly](int a, int b) {
+        const int playsA = recentOnly ? totals.at(a).recentPlays : totals.at(a).plays;
+        const int playsB = recentOnly ? totals.at(b).recentPlays : totals.at(b).plays;
+        return playsA != playsB ? playsA > playsB : totals.at(a).lastPlayed > totals.at(b).lastPlayed;
+    });
+
+    QStringList result;
+    for (int i = 0; i < kept; ++i) {
+        result.append(paths.at(candidates.at(i)));
+    }
+    return result;
+}
+
+QStringList PlayHistory::recentlyPlayed(int count) const
+{
+    QVector<int> candidates;
+    for (int key = 0; key < totals.size(); ++key) {
+        if (totals.at(key).lastPlayed > 0) {
+            candidates.append(key);
+        }
+    }
+
+    const int kept = qMin(count, candidates.size());
+    std::partial_sort(candidates.begin(), candidates.begin() + kept, candidates.end(), [this](int a, int b) {
+        return totals.at(a).lastPlayed > totals.at(b).lastPlayed;
+    });
+
+    QStringList result;
+    for (int i = 0; i < kept; ++i) {
+        result.append(paths.at(candidates.at(i)));
+    }
+    return result;
+}
+
+QStringList PlayHistory::skippedOften(int count) const
+{
+    // Proportion de sauts, les pistes lancées une seule fois ne comptent pas
+    QVector<int> candidates;
+    for (int key = 0; key < totals.size(); ++key) {
+        if (totals.at(key).skips > 0 && totals.at(key).plays >= 2) {
+            candidates.append(key);
+        }
+    }
+
+    const int kept = qMin(count, candidates.size());
+    std::partial_sort(candidates.begin(), candidates.begin() + kept, candidates.end(), [this](int a, int b) {
+        const qint64 left = qint64(totals.at(a).skips) * totals.at(b).plays;
+        const qint64 right = qint64(totals.at(b).skips) * totals.at(a).plays;
+        return left != right ? left > right : totals.at(a).skips > totals.at(b).skips;
+    });
+
+    QStringList result;
+    for (int i = 0; i < kept; ++i) {
+        result.append(paths.at(candidates.at(i)));
+    }
+    return result;
+}
+
+void PlayHistory::flush()
+{
+    flushTimer->stop();
+    if (pending.isEmpty()) {
+        return;
+    }
+
+    QMutexLocker locker(&writeMutex);
+    unwritten.append(pending);
+    pending.clear();
+    // Un écrivain déjà lancé reprendra ces données à la suite : les ajouts restent dans l'ordre
+    if (!writing) {
+        writing = true;
+        TaskScheduler::instance()->run(TaskScheduler::Io, TaskScheduler::Normal, tasks, [this]() {
+            writeUnwritten();
+        });
+    }
+}
+
+void PlayHistory::writeUnwritten()
+{
+    forever {
+        QByteArray data;
+        {
+            QMutexLocker locker(&writeMutex);
+            if (unwritten.isEmpty()) {
+                writing = false;
+                return;
+            }
+            data.swap(unwritten);
+        }
+        appendToFile(fileName, data);
+    }
+}
+
+int PlayHistory::keyFor(const QString &path)
+{
+    QHash<QString, int>::const_iterator it = keys.constFind(path);
+    if (it != keys.constEnd()) {
+        return it.value();
+    }
+
+    // Premier passage de ce fichier : sa clé est définie dans le journal
+    const int key = paths.size();
+    paths.append(path);
+    keys.insert(path, key);
+    totals.append(Stats());
+
+    const QByteArray utf8 = path.toUtf8();
+    pending.append(char(defineTag));
+    writeVarint(pending, quint64(key));
+    writeVarint(pending, quint64(utf8.size()));
+    pending.append(utf8);
+    return key;
+}
+
+void PlayHistory::apply(EventType type, int key, qint64 timestamp)
+{
+    Stats &stats = totals[key];
+    switch (type) {
+    case Started:
+        ++stats.plays;
+        stats.lastPlayed = qMax(stats.lastPlayed, timestamp);
+        ++stats.recentPlays;
+        window[timestamp / dayMs].append(key);
+        break;
+    case Finished:
+        ++stats.finishes;
+        break;
+    case Skipped:
+        ++stats.skips;
+        break;
+    }
+    ++events;
+}
+
+void PlayHistory::expireWindow(qint64 now)
+{
+    const qint64 firstDay = now / dayMs - rollingWindowDays;
+    while (!window.isEmpty() && window.firstKey() < firstDay) {
+        for (int key : window.first()) {
+            --totals[key].recentPlays;
+        }
+        window.erase(window.begin());
+    }
+}
+
+void PlayHistory::load()
+{
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly)) {
+        pending = historyMagic;
+        return;
+    }
+    const QByteArray content = file.readAll();
+    file.close();
+
+    if (!content.startsWith(historyMagic)) {
+        if (!content.isEmpty()) {
+            qWarning() << "Historique illisible, il est recommencé :" << fileName;
+        }
+        QFile::remove(fileName);
+        pending = historyMagic;
+        return;
+    }
+
+    // On s'arrête au premier enregistrement incomplet (arrêt pendant une écriture)
+    int pos = historyMagic.size();
+    int valid = pos;
+    while (pos < content.size()) {
+        const quint8 tag = quint8(content.at(pos++));
+        quint64 key = 0;
+        if (!readVarint(content, &pos, &key)) {
+            break;
+        }
+
+        if (tag == defineTag || tag == relinkTag) {
+            // Définition : clé suivante ; déplacement : clé existante
+            quint64 size = 0;
+            const bool validKey = tag == defineTag ? key == quint64(paths.size()) : key < quint64(paths.size());
+            if (!validKey || !readVarint(content, &pos, &size) || pos + qint64(size) > content.size()) {
+                break;
+            }
+            const QString path = QString::fromUtf8(content.constData() + pos, int(size));
+            pos += int(size);
+            if (tag == defineTag) {
+                paths.append(path);
+                totals.append(Stats());
+            } else {
+                keys.remove(paths.at(int(key)));
+                paths[int(key)] = path;
+            }
+            keys.insert(path, int(key));
+        } else if (tag >= Started && tag <= Skipped) {
+            quint64 delta = 0;
+            quint64 position = 0;
+            if (!readVarint(content, &pos, &delta) || !readVarint(content, &pos, &position) || key >= quint64(paths.size())) {
+                break;
+            }
+            lastTimestamp += unzigzag(delta);
+            apply(EventType(tag), int(key), lastTimestamp);
+        } else {
+            break;
+        }
+        valid = pos;
+    }
+
+    if (valid < content.size()) {
+        QFile::resize(fileName, valid);
+    }
+    expireWindow(QDateTime::currentMSecsSinceEpoch());
+}
@@ -0,0 +1,78 @@
+#ifndef PLAYHISTORY_H
+#define PLAYHISTORY_H
+
+#include <QObject>
+#include <QHash>
+#include <QMap>
+#include <QVector>
+#include <QStringList>
+#include <QMutex>
+#include <QTimer>
+#include "taskscheduler.h"
+
+// Historique d'écoute : chaque lecture, fin de piste ou saut est ajouté à un
+// journal binaire compact (entiers de taille variable, horodatage en delta).
+// Les totaux par piste sont tenus à jour en mémoire pour répondre aux
+// statistiques sans relire le journal.
+class PlayHistory : public QObject
+{
+    Q_OBJECT
+
+public:
+    enum EventType : quint8 {
+        Started = 2,
+        Finished = 3,
+        Skipped = 4
+    };
+
+    struct Stats {
+        int plays = 0;
+        int finishes = 0;
+        int skips = 0;
+        int recentPlays = 0;    // sur la fenêtre glissante
+        qint64 lastPlayed = 0;
+    };
+
+    explicit PlayHistory(const QString &fileName, QObject *parent = nullptr);
+    ~PlayHistory();
+
+    static int windowDays();
+
+    void record(EventType type, const QString &path, qint64 position);
+    // Fichier déplacé : son historique le suit
+    void relink(const QString &oldPath, const QString &newPath);
+    Stats stats(const QString &path) const;
+    int eventCount() const;
+
+    QStringList mostPlayed(int count, bool recentOnly = false) const;
+    QStringList recentlyPlayed(int count) const;
+    QStringList skippedOften(int count) const;
+
+public slots:
+    void flush();
+
+private:
+    int keyFor(const QString &path);
+    void apply(EventType type, int key, qint64 timestamp);
+    void expireWindow(qint64 now);
+    void load();
+    void writeUnwritten();
+
+    QString fileName;
+    QStringList paths;
+    QHash<QString, int> keys;
+    QVector<Stats> totals;
+    QMap<qint64, QVector<int> > window;
+    QByteArray pending;
+    qint64 lastTimestamp;
+    int events;
+    QTimer *flushTimer;
+
+    // Données passées au thread d'écriture, un seul écrivain à la fois
+    QMutex writeMutex;
+    QByteArray unwritten;
+    bool writing;
+    TaskScheduler::Group tasks;
+};
+
+#endif // PLAYHISTORY_H
@@ -0,0 +1,242 @@
+#include "playlists.h"
+#include "trackstore.h"
+#include <QFile>
+#include <QSaveFile>
+#include <QDataStream>
+#include <QHash>
+#include <QSet>
+#include <QStringList>
+
+namespace {
+
+const quint32 playlistsMagic = 0x51504C31;
+
+void writeVarint(QByteArray &out, quint32 value)
+{
+    while (value >= 0x80) {
+        out.append(char((value & 0x7F) | 0x80));
+        value >>= 7;
+    }
+    out.append(char(value));
+}
+
+bool readVarint(const QByteArray &in, int *pos, quint32 *value)
+{
+    quint32 result = 0;
+    for (int shift = 0; shift < 35 && *pos < in.size(); shift += 7) {
+        const quint8 byte = quint8(in.at((*pos)++));
+        result |= quint32(byte & 0x7F) << shift;
+        if (!(byte & 0x80)) {
+            *value = result;
+            return true;
+        }
+    }
+    return false;
+}
+
+}
+
+int Playlists::count() const
+{
+    return playlists.size();
+}
+
+int Playlists::indexOf(const QString &name) const
+{
+    for (int i = 0; i < playlists.size(); ++i) {
+        if (playlists.at(i).name == name) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+QString Playlists::name(int index) const
+{
+    return playlists.value(index).name;
+}
+
+QVector<int> Playlists::tracks(int index) const
+{
+    return playlists.value(index).tracks;
+}
+
+int Playlists::create(const QString &name, const QVector<int> &tracks)
+{
+    Playlist playlist;
+    playlist.name = name;
+    playlist.tracks = tracks;
+    playlists.append(playlist);
+    return playlists.size() - 1;
+}
+
+int Playlists::duplicate(int index, const QString &name)
+{
+    if (index < 0 || index >= playlists.size()) {
+        return -1;
+    }
+    // Le vecteur n'est copié qu'à la première modification de l'une des deux listes
+    return create(name, playlists.at(index).tracks);
+}
+
+void Playlists::rename(int index, const QString &name)
+{
+    if (index >= 0 && index < playlists.size()) {
+        playlists[index].name = name;
+    }
+}
+
+void Playlists::remove(int index)
+{
+    if (index >= 0 && index < playlists.size()) {
+        playlists.remove(index);
+    }
+}
+
+void Playlists::clear()
+{
+    playlists.clear();
+}
+
+void Playlists::append(int index, const QVector<int> &tracks)
+{
+    if (index >= 0 && index < playlists.size()) {
+        playlists[index].tracks += tracks;
+    }
+}
+
+void Playlists::removeAt(int index, int position)
+{
+    if (index >= 0 && index < playlists.size() && position >= 0 && position < playlists.at(index).tracks.size()) {
+        playlists[index].tracks.remove(position);
+    }
+}
+
+void Playlists::move(int index, int from, int to)
+{
+    if (index < 0 || index >= playlists.size()) {
+        return;
+    }
+    QVector<int> &tracks = playlists[index].tracks;
+    if (from >= 0 && from < tracks.size() && to >= 0 && to < tracks.size() && from != to) {
+        tracks.move(from, to);
+    }
+}
+
+void Playlists::removeTrack(int trackId)
+{
+    for (Playlist &playlist : playlists) {
+        if (playlist.tracks.contains(trackId)) {
+            playlist.tracks.removeAll(trackId);
+        }
+    }
+}
+
+void Playlists::removeTracks(const QVector<int> &trackIds)
+{
+    const QSet<int> removed = QSet<int>(trackIds.constBegin(), trackIds.constEnd());
+    for (Playlist &playlist : playlists) {
+        QVector<int> kept;
+        kept.reserve(playlist.tracks.size());
+        for (int id : playlist.tracks) {
+            if (!removed.contains(id)) {
+                kept.append(id);
+            }
+        }
+        playlist.tracks.swap(kept);
+    }
+}
+
+bool Playlists::save(const QString &fileName, const TrackStore *store) const
+{
+    // Chaque chemin n'est écrit qu'une fois, quel que soit le nombre de listes
+    QStringList paths;
+    QHash<int, quint32> pathIndexes;
+    QByteArray body;
+    for (const Playlist &playlist : playlists) {
+        QByteArray entries;
+        quint32 count = 0;
+        for (int id : playlist.tracks) {
+            if (!store->contains(id)) {
+                continue;
+            }
+            QHash<int, quint32>::const_iterator it = pathIndexes.constFind(id);
+            if (it == pathIndexes.constEnd()) {
+                it = pathIndexes.insert(id, quint32(paths.size()));
+                paths.append(store->path(id));
+            }
+            writeVarint(entries, it.value());
+            ++count;
+        }
+
+        const QByteArray name = playlist.name.toUtf8();
+        writeVarint(body, quint32(name.size()));
+        body.append(name);
+        writeVarint(body, count);
+        body.append(entries);
+    }
+
+    QSaveFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly)) {
+        return false;
+    }
+    QDataStream out(&file);
+    out << playlistsMagic << paths << quint32(playlists.size()) << body;
+    return file.commit();
+}
+
+bool Playlists::load(const QString &fileName, const TrackStore *store)
+{
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+
+    QDataStream in(&file);
+    quint32 magic = 0;
+    QStringList paths;
+    quint32 playlistCount = 0;
+    QByteArray body;
+    in >> magic >> paths >> playlistCount >> body;
+    if (magic != playlistsMagic || in.status() != QDataStream::Ok) {
+        return false;
+    }
+
+    // Les chemins absents de la bibliothèque sont ignorés
+    QVector<int> ids;
+    ids.reserve(paths.size());
+    for (const QString &path : paths) {
+        ids.append(store->idForPath(path));
+    }
+
+    QVector<Playlist> loaded;
+    int pos = 0;
+    for (quint32 i = 0; i < playlistCount; ++i) {
+        quint32 nameSize = 0;
+        quint32 count = 0;
+        if (!readVarint(body, &pos, &nameSize) || pos + int(nameSize) > body.size()) {
+            return false;
+        }
+        Playlist playlist;
+        playlist.name = QString::fromUtf8(body.constData() + pos, int(nameSize));
+        pos += int(nameSize);
+        if (!readVarint(body, &pos, &count)) {
+            return false;
+        }
+        playlist.tracks.reserve(int(qMin<quint32>(count, quint32(body.size()))));
+        for (quint32 j = 0; j < count; ++j) {
+            quint32 index = 0;
+            if (!readVarint(body, &pos, &index)) {
+                return false;
+            }
+            const int id = ids.value(int(index), -1);
+            if (id >= 0) {
+                playlist.tracks.append(id);
+            }
+        }
+        loaded.append(playlist);
+    }
+
+    playlists = loaded;
+    return true;
+}
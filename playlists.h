@@ -0,0 +1,47 @@
+#ifndef PLAYLISTS_H
+#define PLAYLISTS_H
+
+#include <QString>
+#include <QVector>
+
+class TrackStore;
+
+// Listes de lecture nommées. Une liste n'est qu'un vecteur d'identifiants
+// du TrackStore partagé ; les vecteurs sont partagés implicitement, si bien que
+// dupliquer ou afficher une liste ne copie rien tant qu'elle n'est pas modifiée.
+class Playlists
+{
+public:
+    int count() const;
+    int indexOf(const QString &name) const;
+    QString name(int index) const;
+    QVector<int> tracks(int index) const;
+
+    int create(const QString &name, const QVector<int> &tracks = QVector<int>());
+    int duplicate(int index, const QString &name);
+    void rename(int index, const QString &name);
+    void remove(int index);
+    void clear();
+
+    void append(int index, const QVector<int> &tracks);
+    void removeAt(int index, int position);
+    void move(int index, int from, int to);
+    // Piste supprimée de la bibliothèque : retirée de toutes les listes
+    void removeTrack(int trackId);
+    void removeTracks(const QVector<int> &trackIds);
+
+    // Format compact : table des chemins utilisés, puis pour chaque liste
+    // les indices dans cette table en entiers de taille variable.
+    bool save(const QString &fileName, const TrackStore *store) const;
+    bool load(const QString &fileName, const TrackStore *store);
+
+private:
+    struct Playlist {
+        QString name;
+        QVector<int> tracks;
+    };
+
+    QVector<Playlist> playlists;
+};
+
+#endif // PLAYLISTS_H
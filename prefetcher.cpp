@@ -0,0 +1,144 @@
+#include "prefetcher.h"
+#include <QFile>
+#include <QDateTime>
+#include <QMutexLocker>
+
+#ifdef Q_OS_LINUX
+#include <fcntl.h>
+#endif
+
+namespace {
+
+// En-tête et premières secondes : quelques secondes de WAV, bien plus en MP3
+const qint64 warmBytes = 1024 * 1024;
+const int readChunkSize = 128 * 1024;
+// Au-delà, le cache du système a pu évincer les pages
+const qint64 warmLifetimeMs = 10 * 60 * 1000;
+const int maxWarmEntries = 32;
+
+}
+
+Prefetcher::Prefetcher(QObject *parent)
+    : QObject(parent)
+    , measuring(false)
+    , measuringHit(false)
+{
+}
+
+Prefetcher::~Prefetcher()
+{
+    tasks.cancel();
+    tasks.wait();
+}
+
+void Prefetcher::prefetch(const QStringList &paths)
+{
+    tasks.cancel();
+
+    const qint64 now = QDateTime::currentMSecsSinceEpoch();
+    QStringList pending;
+    {
+        QMutexLocker locker(&mutex);
+        wanted = paths;
+        for (const QString &path : paths) {
+            if (!path.isEmpty() && !isWarm(path, now) && !pending.contains(path)) {
+                pending.append(path);
+            }
+        }
+    }
+
+    for (const QString &path : pending) {
+        // La piste suivante attend peut-être déjà : file interactive
+        TaskScheduler::instance()->run(TaskScheduler::Io, TaskScheduler::Interactive, tasks, [this, path]() {
+            warm(path);
+        });
+    }
+}
+
+bool Prefetcher::notePlayback(const QString &path)
+{
+    QMutexLocker locker(&mutex);
+    const bool hit = isWarm(path, QDateTime::currentMSecsSinceEpoch());
+    if (hit) {
+        ++counters.hits;
+    } else {
+        ++counters.misses;
+    }
+    measuring = true;
+    measuringHit = hit;
+    latencyTimer.start();
+    return hit;
+}
+
+void Prefetcher::audioStarted()
+{
+    QMutexLocker locker(&mutex);
+    if (!measuring) {
+        return;
+    }
+    measuring = false;
+    if (measuringHit) {
+        counters.hitLatencyMs += latencyTimer.elapsed();
+        ++counters.hitSamples;
+    } else {
+        counters.missLatencyMs += latencyTimer.elapsed();
+        ++counters.missSamples;
+    }
+}
+
+Prefetcher::Stats Prefetcher::stats() const
+{
+    QMutexLocker locker(&mutex);
+    return counters;
+}
+
+void Prefetcher::warm(const QString &path)
+{
+    {
+        // Candidat devenu inutile pendant l'attente
+        QMutexLocker locker(&mutex);
+        if (!wanted.contains(path) || isWarm(path, QDateTime::currentMSecsSinceEpoch())) {
+            return;
+        }
+    }
+
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return;
+    }
+
+#ifdef Q_OS_LINUX
+    // Lecture anticipée demandée d'un bloc, puis consommée pour les systèmes
+    // de fichiers (NFS notamment) qui ignorent le conseil
+    posix_fadvise(file.handle(), 0, warmBytes, POSIX_FADV_WILLNEED);
+#endif
+
+    QByteArray buffer(readChunkSize, Qt::Uninitialized);
+    qint64 total = 0;
+    while (total < warmBytes) {
+        const qint64 read = file.read(buffer.data(), qMin<qint64>(readChunkSize, warmBytes - total));
+        if (read <= 0) {
+            break;
+        }
+        total += read;
+    }
+
+    QMutexLocker locker(&mutex);
+    counters.bytesWarmed += total;
+    warmed.insert(path, QDateTime::currentMSecsSinceEpoch());
+    while (warmed.size() > maxWarmEntries) {
+        QHash<QString, qint64>::iterator oldest = warmed.begin();
+        for (QHash<QString, qint64>::iterator it = warmed.begin(); it != warmed.end(); ++it) {
+            if (it.value() < oldest.value()) {
+                oldest = it;
+            }
+        }
+        warmed.erase(oldest);
+    }
+}
+
+bool Prefetcher::isWarm(const QString &path, qint64 now) const
+{
+    QHash<QString, qint64>::const_iterator it = warmed.constFind(path);
+    return it != warmed.constEnd() && now - it.value() < warmLifetimeMs;
+}
@@ -0,0 +1,55 @@
+#ifndef PREFETCHER_H
+#define PREFETCHER_H
+
+#include <QObject>
+#include <QMutex>
+#include <QHash>
+#include <QStringList>
+#include <QElapsedTimer>
+#include "taskscheduler.h"
+
+// Préchargement des pistes probables : l'en-tête et les premières secondes
+// sont amenés dans le cache du système sur des threads d'entrée-sortie,
+// pour que le lecteur démarre sans attendre le disque ou le réseau.
+class Prefetcher : public QObject
+{
+    Q_OBJECT
+
+public:
+    struct Stats {
+        int hits = 0;
+        int misses = 0;
+        qint64 hitLatencyMs = 0;     // cumul, divisé par hitSamples
+        int hitSamples = 0;
+        qint64 missLatencyMs = 0;
+        int missSamples = 0;
+        qint64 bytesWarmed = 0;
+    };
+
+    explicit Prefetcher(QObject *parent = nullptr);
+    ~Prefetcher();
+
+    // Candidats par ordre de probabilité ; les demandes précédentes non commencées sont abandonnées
+    void prefetch(const QStringList &paths);
+    // Début d'une lecture : compte un succès si le fichier était prêt
+    bool notePlayback(const QString &path);
+    // Premier échantillon entendu : fin de la mesure de latence
+    void audioStarted();
+
+    Stats stats() const;
+
+private:
+    void warm(const QString &path);
+    bool isWarm(const QString &path, qint64 now) const;
+
+    TaskScheduler::Group tasks;
+    mutable QMutex mutex;
+    QHash<QString, qint64> warmed;
+    QStringList wanted;
+    Stats counters;
+    QElapsedTimer latencyTimer;
+    bool measuring;
+    bool measuringHit;
+};
+
+#endif // PREFETCHER_H
@@ -1,6 +1,9 @@
 #include "qticallymainwindow.h"
 #include "ui_qticallymainwindow.h"
 #include "settingsdialog.h"
+#include "coverloader.h"
+#include "memorydialog.h"
+#include "singleinstance.h"
 #include <QMediaPlayer>
 #include <QFileDialog>
 #include <QTime>
@@ -13,13 +16,85 @@
 #include <QMessageBox>
 #include <QBuffer>
 #include <QSystemTrayIcon>
+#include <QStandardPaths>
+#include <QHeaderView>
+#include <QTimer>
+#include <QDir>
+#include <QSet>
+#include <QElapsedTimer>
+#include <QInputDialog>
+#include <QSettings>
+#include <QStyle>
+#include <limits>
+#include <algorithm>
+
+#ifdef Q_OS_UNIX
+#include <sys/resource.h>
+#endif
+
+namespace {
+
+// Nœud de QMap : pointeurs, couleur, clé et valeur
+const qint64 mapNodeBytes = 48;
+
+// Pistes CUE : la fin de piste est guettée plus souvent que l'affichage ne l'exige
+const int segmentNotifyInterval = 40;
+const int defaultNotifyInterval = 1000;
+// Position déjà au début de la piste suivante à ce délai près : on enchaîne sans déplacement
+const qint64 segmentSeekTolerance = 500;
+// Boucle A-B la plus courte : le lecteur multimédia la guette à segmentNotifyInterval près
+const qint64 minLoopMs = 250;
+
+// Arrière-plan : rien à afficher, position demandée rarement et long tampon de sortie
+const int backgroundNotifyInterval = 10000;
+const int backgroundSegmentNotifyInterval = 200;
+const int foregroundBufferMs = 500;
+const int backgroundBufferMs = 2000;
+// Sauts rapides : une seule notification, pour la piste où l'on s'arrête
+const int notificationDelayMs = 1500;
+
+// Étiquettes lues par lots : assez gros pour amortir l'ordonnancement,
+// assez petits pour que la liste se remplisse au fil de la lecture
+const int tagBatchSize = 64;
+
+// Temps processeur du processus et mises en sommeil volontaires, soit à peu près ses réveils
+void processUsage(qint64 *cpuMs, qint64 *wakeups)
+{
+    *cpuMs = 0;
+    *wakeups = 0;
+#ifdef Q_OS_UNIX
+    rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) == 0) {
+        *cpuMs = qint64(usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) * 1000
+                + qint64(usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1000;
+        *wakeups = usage.ru_nvcsw;
+    }
+#endif
+}
+
+qint64 pixmapBytes(const QPixmap &pixmap)
+{
+    return pixmap.isNull() ? 0 : qint64(pixmap.width()) * pixmap.height() * pixmap.depth() / 8;
+}
+
+QString loopTime(qint64 ms)
+{
+    return QTime(0, 0).addMSecs(int(ms)).toString("mm:ss.zzz");
+}
+
+}
 
 
 QticallyMainWindow::QticallyMainWindow(QWidget *parent)
     : QMainWindow(parent)
     , ui(new Ui::QticallyMainWindow)
+    , currentSmartPlaylist(-1)
+    , currentPlaylist(-1)
     , prevIndex(-1)
     , isPlaying(false)
+    , journal(nullptr)
+    , restoringJournal(false)
+    , probedDuration(0)
 {
     ui->setupUi(this);
 
@@ -35,16 +110,128 @@ QticallyMainWindow::QticallyMainWindow(QWidget *parent)
 
 
     player = new QMediaPlayer(this);
-    musicList = ui->listWidget;
+    // WAV PCM lus directement depuis le fichier projeté, le reste par le lecteur multimédia
+    wavPlayer = new WavPlayer(this);
+    directWav = false;
+
+    // Bibliothèque : table des pistes par colonnes, triable par en-tête
+    trackStore = new TrackStore;
+    trackModel = new TrackModel(trackStore, this);
+    musicList = ui->musicList;
+    musicList->setModel(trackModel);
+    musicList->header()->setSortIndicator(-1, Qt::AscendingOrder);
+    musicList->setSortingEnabled(true);
+    musicList->setColumnWidth(TrackStore::Title, 170);
+    musicList->setColumnWidth(TrackStore::Artist, 120);
+    musicList->setColumnWidth(TrackStore::Album, 120);
+    musicList->setColumnWidth(TrackStore::Duration, 60);
+    musicList->setColumnWidth(TrackStore::Path, 250);
+    musicList->setColumnWidth(TrackStore::DateAdded, 120);
+    musicList->setColumnWidth(TrackStore::PlayCount, 60);
+
+    // Listes intelligentes : appartenance tenue à jour au fil des modifications
+    smartPlaylists = new SmartPlaylists(trackStore);
+    playlistSelector = ui->playlistSelector;
+    connect(playlistSelector, QOverload<int>::of(&QComboBox::currentIndexChanged), this, &QticallyMainWindow::selectPlaylist);
+    ui->menuListes->addAction("Nouvelle liste…", this, &QticallyMainWindow::newPlaylist);
+    ui->menuListes->addAction("Nouvelle liste intelligente…", this, &QticallyMainWindow::newSmartPlaylist);
+    ui->menuListes->addAction("Dupliquer la liste…", this, &QticallyMainWindow::duplicatePlaylist);
+    ui->menuListes->addAction("Renommer la liste…", this, &QticallyMainWindow::renamePlaylist);
+    ui->menuListes->addAction("Modifier la règle…", this, &QticallyMainWindow::editSmartPlaylist);
+    ui->menuListes->addAction("Supprimer la liste", this, &QticallyMainWindow::removePlaylist);
+    ui->menuListes->addSeparator();
+    ui->menuListes->addAction("Albums et dossiers…", this, &QticallyMainWindow::showAlbumGrid);
+    ui->menuListes->addAction("Statistiques d'écoute…", this, &QticallyMainWindow::showListeningStats);
+    albumGridWindow = nullptr;
+
+    qRegisterMetaType<QVector<TagReader::Tags> >("QVector<TagReader::Tags>");
+    tagBatchesPending = 0;
+
+    // Durées calculées en arrière-plan, regroupées avant mise à jour de la liste
+    QString dataDirectory = QStandardPaths::writableLocation(QStandardPaths::AppDataLocation);
+    QDir().mkpath(dataDirectory);
+    durationProber = new DurationProber(QDir(dataDirectory).filePath("durations.cache"), this);
+    connect(durationProber, &DurationProber::durationsReady, this, &QticallyMainWindow::durationsReady);
+    durationFlushTimer = new QTimer(this);
+    durationFlushTimer->setSingleShot(true);
+    durationFlushTimer->setInterval(250);
+    connect(durationFlushTimer, &QTimer::timeout, this, &QticallyMainWindow::flushProbedDurations);
+
+    // Historique d'écoute : lu avant le journal pour retrouver les compteurs
+    playHistory = new PlayHistory(QDir(dataDirectory).filePath("history.log"), this);
+    playingTrack = -1;
+    segmentStartMs = 0;
+    segmentEndMs = -1;
+    pendingSeek = -1;
+    loopStartMs = -1;
+    loopEndMs = -1;
+
+    // Vérification des fichiers en arrière-plan, avec recherche des fichiers déplacés
+    healthChecker = new HealthChecker(QDir(dataDirectory).filePath("health.cache"), this);
+    connect(healthChecker, &HealthChecker::progress, this, &QticallyMainWindow::healthProgress);
+    connect(healthChecker, &HealthChecker::finished, this, &QticallyMainWindow::healthCheckFinished);
+
+    // Préchargement des pistes suivantes probables
+    prefetcher = new Prefetcher(this);
+    nextShuffleTrack = -1;
+
+    // Listes de lecture : enregistrées à part, regroupées pendant deux secondes
+    playlistsFileName = QDir(dataDirectory).filePath("playlists.dat");
+    playlistSaveTimer = new QTimer(this);
+    playlistSaveTimer->setSingleShot(true);
+    playlistSaveTimer->setInterval(2000);
+    connect(playlistSaveTimer, &QTimer::timeout, this, &QticallyMainWindow::savePlaylists);
+
+    // Pochettes personnalisées : seul le fichier d'origine est gardé,
+    // l'image réduite est décodée en arrière-plan au moment de l'afficher
+
+    libraryStatusLabel = new QLabel(this);
+    ui->statusbar->addPermanentWidget(libraryStatusLabel);
+
+    // Comptabilité mémoire : relevé périodique, les caches réduits au-delà des budgets
+    memoryMonitor = new MemoryMonitor(this);
+    connect(memoryMonitor, &MemoryMonitor::sampleRequested, this, &QticallyMainWindow::sampleMemory);
+    memoryTimer = new QTimer(this);
+    memoryTimer->setInterval(30 * 1000);
+    connect(memoryTimer, &QTimer::timeout, memoryMonitor, &MemoryMonitor::refresh);
+    memoryTimer->start();
+    enforceMemoryBudgets();
+
+    // Mode économe quand la fenêtre est réduite ou cachée dans la zone de notification
+    backgroundMode = false;
+    coverPending = false;
+    backgroundCpuMs = 0;
+    backgroundWakeups = 0;
+    positionEvents = 0;
+    notificationTimer = new QTimer(this);
+    notificationTimer->setSingleShot(true);
+    notificationTimer->setInterval(notificationDelayMs);
+    connect(notificationTimer, &QTimer::timeout, this, &QticallyMainWindow::showPendingNotification);
 
     connect(ui->pushButton_add_music, &QPushButton::clicked, this, &QticallyMainWindow::addMusic);
-    connect(musicList, &QListWidget::itemClicked, this, &QticallyMainWindow::playSelectedMusic);
+    connect(musicList, &QTreeView::clicked, this, &QticallyMainWindow::playSelectedMusic);
 
     connect(ui->pushButton_play, &QPushButton::clicked, this, &QticallyMainWindow::playMusic);
     connect(ui->pushButton_pnext, &QPushButton::clicked, this, &QticallyMainWindow::nextMusic);
     connect(ui->pushButton_previous, &QPushButton::clicked, this, &QticallyMainWindow::previousMusic);
 
     connect(player, &QMediaPlayer::mediaStatusChanged, this, &QticallyMainWindow::handleMediaStatusChanged);
+    connect(wavPlayer, &WavPlayer::mediaStatusChanged, this, &QticallyMainWindow::handleMediaStatusChanged);
+    const auto audioStarted = [this](qint64 position) {
+        if (position > 0) {
+            prefetcher->audioStarted();
+        }
+    };
+    connect(player, &QMediaPlayer::positionChanged, this, audioStarted);
+    connect(wavPlayer, &WavPlayer::positionChanged, this, audioStarted);
+    connect(player, &QMediaPlayer::positionChanged, this, &QticallyMainWindow::checkSegmentEnd);
+    connect(wavPlayer, &WavPlayer::positionChanged, this, &QticallyMainWindow::checkSegmentEnd);
+    connect(wavPlayer, &WavPlayer::looped, this, [this]() {
+        // Un passage travaillé en boucle A-B ne compte pas comme une écoute
+        if (loopEndMs < 0) {
+            recordRepeat();
+        }
+    });
 
 
     musicSlider = ui->slider;
@@ -54,10 +241,14 @@ QticallyMainWindow::QticallyMainWindow(QWidget *parent)
 
     connect(player, &QMediaPlayer::positionChanged, this, &QticallyMainWindow::updateSliderPosition);
     connect(player, &QMediaPlayer::durationChanged, this, &QticallyMainWindow::updateSliderPosition);
+    connect(wavPlayer, &WavPlayer::positionChanged, this, &QticallyMainWindow::updateSliderPosition);
+    connect(wavPlayer, &WavPlayer::durationChanged, this, &QticallyMainWindow::updateSliderPosition);
     connect(musicSlider, &QSlider::sliderMoved, this, [=](int position) {
-        player->setPosition(position);
+        seekTrack(position);
     });
     connect(musicSlider, &QSlider::sliderPressed, this, &QticallyMainWindow::sliderPressed);
+    musicSlider->setContextMenuPolicy(Qt::CustomContextMenu);
+    connect(musicSlider, &QSlider::customContextMenuRequested, this, &QticallyMainWindow::showSliderMenu);
 
     timeElapsedLabel = ui->timeElapsedLabel;
     totalTimeLabel = ui->totalTimeLabel;
@@ -82,13 +273,37 @@ QticallyMainWindow::QticallyMainWindow(QWidget *parent)
     contextMenu = new QMenu(this);
     contextMenu->addAction("Lire", this, &QticallyMainWindow::playSelectedMusic);
     contextMenu->addAction("Supprimer", this, &QticallyMainWindow::deleteSelectedMusic);
+    contextMenu->addSeparator();
+    contextMenu->addAction("Ajouter à une liste…", this, &QticallyMainWindow::addToPlaylist);
+    contextMenu->addAction("Retirer de la liste", this, &QticallyMainWindow::removeFromPlaylist);
+    contextMenu->addAction("Monter", this, &QticallyMainWindow::moveTrackUp);
+    contextMenu->addAction("Descendre", this, &QticallyMainWindow::moveTrackDown);
 
-    musicList->installEventFilter(this);
+    musicList->viewport()->installEventFilter(this);
 
     ui->menuParametres->addAction("Sauvegarder", this, &QticallyMainWindow::save);
     ui->menuParametres->addAction("Ouvrir", this, &QticallyMainWindow::open);
+    ui->menuParametres->addAction("Mémoire", this, &QticallyMainWindow::showMemoryDialog);
+    ui->menuParametres->addAction("Préchargement", this, &QticallyMainWindow::showPrefetchStats);
+    ui->menuParametres->addAction("Tâches de fond", this, &QticallyMainWindow::showSchedulerStats);
+    ui->menuParametres->addAction("Vérifier la bibliothèque", this, &QticallyMainWindow::checkLibraryHealth);
+    ui->menuParametres->addAction("Ajouter un dossier surveillé…", this, &QticallyMainWindow::addWatchRoot);
+    ui->menuParametres->addAction("Retirer un dossier…", this, &QticallyMainWindow::removeFolder);
+    ui->menuParametres->addAction("Relier un dossier déplacé…", this, &QticallyMainWindow::relinkFolder);
+
+    // Visualiseur en bas de la pochette, facultatif
+    spectrumAnalyzer = new SpectrumAnalyzer(player, wavPlayer, this);
+    spectrumWidget = new SpectrumWidget(spectrumAnalyzer, musicImageLabel->parentWidget());
+    const QRect cover = musicImageLabel->geometry();
+    spectrumWidget->setGeometry(cover.left(), cover.bottom() - 69, cover.width(), 70);
+    spectrumWidget->hide();
+    QAction *visualizerAction = ui->menuParametres->addAction("Visualiseur");
+    visualizerAction->setCheckable(true);
+    connect(visualizerAction, &QAction::toggled, this, &QticallyMainWindow::setVisualizerEnabled);
+    visualizerAction->setChecked(QSettings().value("visualizer/enabled", false).toBool());
 
     searchBar = ui->searchBar;
+    searchBar->setPlaceholderText("Rechercher… ex. artist:daft duration>5:00 -remix");
     connect(searchBar, &QLineEdit::textChanged, this, &QticallyMainWindow::filterMusicList);
 
 
@@ -102,24 +317,64 @@ QticallyMainWindow::QticallyMainWindow(QWidget *parent)
     connect(trayIcon, &QSystemTrayIcon::activated, this, &QticallyMainWindow::iconActivated);
 
 
+    // Sauvegarde automatique : relecture de l'instantané et du journal
+
+    journal = new Journal(dataDirectory, this);
+    restoreFromJournal();
+
+    // Première vérification une fois l'interface affichée
+    QTimer::singleShot(3000, this, &QticallyMainWindow::checkLibraryHealth);
+
 }
 
 QticallyMainWindow::~QticallyMainWindow()
 {
+    tagTasks.cancel();
+    tagTasks.wait();
+    coverTasks.cancel();
+    coverTasks.wait();
+
+    if (playlistSaveTimer->isActive()) {
+        savePlaylists();
+    }
 
+    // Le visualiseur se détache de l'analyseur avant que celui-ci ne disparaisse
+    delete spectrumWidget;
     delete ui;
+    delete smartPlaylists;
+    delete trackStore;
 }
 
 
 void QticallyMainWindow::handleMediaStatusChanged(QMediaPlayer::MediaStatus status)
 {
+    // Début d'une piste CUE demandé avant que le fichier ne soit chargé
+    if (pendingSeek >= 0 && (status == QMediaPlayer::LoadedMedia || status == QMediaPlayer::BufferedMedia)) {
+        if (qAbs(playerPosition() - pendingSeek) > segmentSeekTolerance) {
+            setPlayerPosition(pendingSeek);
+        }
+        pendingSeek = -1;
+    }
+
     if (status == QMediaPlayer::EndOfMedia) {
+        // Boucle ou piste répétée : le fichier ouvert repart, sans être rechargé
+        if (loopEndMs >= 0 && playingTrack >= 0) {
+            pendingSeek = loopStartMs;
+            setPlayerPosition(loopStartMs);
+            playerPlay();
+            return;
+        }
+        if (repeatsTrack() && playingTrack >= 0) {
+            restartTrack();
+            return;
+        }
+
         isPlaying = false;
         ui->pushButton_play->setIcon(QIcon(":/images/images/play.png"));
+        endPlayback(PlayHistory::Finished);
         if (repeatEnabled) {
-            if (shuffleEnabled) {
-                int nextIndex = QRandomGenerator::global()->bounded(musicList->count());
-                musicList->setCurrentRow(nextIndex);
+            if (shuffleEnabled && trackModel->rowCount() > 0) {
+                setCurrentRow(takeShuffleRow());
             }
             playSelectedMusic();
         } else {
@@ -133,6 +388,14 @@ void QticallyMainWindow::iconActivated(QSystemTrayIcon::ActivationReason reason)
     switch (reason) {
     case QSystemTrayIcon::Trigger:
     case QSystemTrayIcon::DoubleClick:
+        // Un clic cache la fenêtre dans la zone de notification ou l'en ressort
+        if (isVisible() && !isMinimized()) {
+            hide();
+        } else {
+            showNormal();
+            raise();
+            activateWindow();
+        }
         break;
     default:
         ;
@@ -145,14 +408,29 @@ void QticallyMainWindow::showSettingsDialog()
     if (dialog.exec() == QDialog::Accepted) {
         QString newMusicName = dialog.getMusicName();
         QPixmap newImage = dialog.getImage();
-        updateMusicImage(newMusicName, newImage);
-        selectedMusicImage = newImage;
 
-        updateMusicName(selectedMusicName, newMusicName);
+        QString imagePath = dialog.getImagePath();
+
+        const int track = currentTrack();
+        if (track < 0) {
+            return;
+        }
+        QString filePath = trackStore->path(track);
+        if (newMusicName != selectedMusicName) {
+            journalRecord(Journal::renameTrack(filePath, newMusicName));
+        }
+        if (!imagePath.isEmpty()) {
+            journalRecord(Journal::setArtworkFile(filePath, imagePath));
+        }
+
+        updateMusicName(track, selectedMusicName, newMusicName);
         selectedMusicName = newMusicName;
 
-        musicList->currentItem()->setText(newMusicName);
-        musicNameLabel->setText(newMusicName);
+        if (!imagePath.isEmpty()) {
+            customMusicImagePaths.insert(newMusicName, imagePath);
+        }
+        updateMusicImage(newMusicName, newImage);
+        selectedMusicImage = newImage;
     }
 }
 
@@ -162,55 +440,125 @@ void QticallyMainWindow::showSettingsDialog()
 void QticallyMainWindow::toggleRepeat()
 {
     repeatEnabled = !repeatEnabled;
+    journalRecord(Journal::setSetting("repeatEnabled", repeatEnabled));
+    applyLoop();
 }
 
 void QticallyMainWindow::toggleShuffle()
 {
     shuffleEnabled = !shuffleEnabled;
+    journalRecord(Journal::setSetting("shuffleEnabled", shuffleEnabled));
+    applyLoop();
 }
 
 
 void QticallyMainWindow::addMusic()
 {
-    QString fileName = QFileDialog::getOpenFileName(this, tr("Open Music"), "", tr("Music Files (*.mp3 *.wav)"));
+    QString fileName = QFileDialog::getOpenFileName(this, tr("Open Music"), "", tr("Music Files (*.mp3 *.wav *.cue)"));
     if (!fileName.isEmpty())
     {
-        QFileInfo fileInfo(fileName);
-        QString musicName = fileInfo.completeBaseName();
-        QListWidgetItem* item = new QListWidgetItem(musicName);
-        item->setData(Qt::UserRole, fileName);
-        musicList->addItem(item);
-        musicMap.insert(fileName, fileName);
-        QPixmap defaultImage(":/images/images/OIP.jpeg");
-        musicImageMap.insert(fileName, defaultImage);
+        QVector<int> newTracks;
+        const QVector<int> tracks = ingestFile(QFileInfo(fileName), QDateTime::currentMSecsSinceEpoch(), &newTracks);
+        // Feuille CUE illisible ou sans piste : rien n'a été ajouté
+        if (tracks.isEmpty()) {
+            ui->statusbar->showMessage("Feuille CUE illisible : " + fileName, 5000);
+            return;
+        }
+        libraryTracksAdded(newTracks);
+        analyzeTracks(newTracks);
 
         musicImageLabel->setPixmap(defaultImage);
 
-        selectedMusicName = musicName;
+        selectedMusicName = trackStore->title(tracks.first());
         selectedMusicImage = defaultImage;
 
-        qDebug() << "Music added: " << musicName;
+        qDebug() << "Music added: " << selectedMusicName;
     }
 }
 
 
 void QticallyMainWindow::playSelectedMusic()
 {
-    if (musicList->currentItem())
+    const int track = currentTrack();
+    if (track >= 0)
     {
-        QString musicName = musicList->currentItem()->text();
-        QString filePath = musicList->currentItem()->data(Qt::UserRole).toString();
-        player->setMedia(QUrl::fromLocalFile(filePath));
-        player->play();
+        QString musicName = trackStore->title(track);
+        QString filePath = trackStore->path(track);
+        const QString mediaPath = trackStore->mediaPath(track);
+
+        // Signalé par la vérification : mieux vaut le dire que ne rien jouer
+        if (unreachableTracks.contains(track)) {
+            ui->statusbar->showMessage("Emplacement injoignable : " + filePath, 5000);
+            return;
+        }
+        if (missingTracks.contains(track)) {
+            if (!QFileInfo::exists(mediaPath)) {
+                ui->statusbar->showMessage("Fichier introuvable : " + filePath, 5000);
+                return;
+            }
+            missingTracks.remove(track);
+        }
+
+        endPlayback(PlayHistory::Skipped);
+        prefetcher->notePlayback(mediaPath);
+        // Les points A-B appartiennent à la piste quittée
+        loopStartMs = -1;
+        loopEndMs = -1;
+        wavPlayer->clearLoop();
+
+        const bool segmented = trackStore->hasSegment(track);
+        const TrackStore::Segment segment = trackStore->segment(track);
+        segmentStartMs = segmented ? CueSheet::framesToMs(segment.start) : 0;
+        segmentEndMs = segmented && segment.end >= 0 ? CueSheet::framesToMs(segment.end) : -1;
+        applyNotifyInterval();
+
+        // Piste CUE du fichier déjà ouvert : un déplacement, ou rien du tout quand
+        // la lecture arrive d'elle-même au début de la piste
+        const QMediaPlayer::MediaStatus status = playerStatus();
+        if (segmented && mediaPath == openedMedia && status != QMediaPlayer::NoMedia
+                && status != QMediaPlayer::InvalidMedia && status != QMediaPlayer::EndOfMedia) {
+            const qint64 position = playerPosition();
+            if (position < segmentStartMs || position > segmentStartMs + segmentSeekTolerance) {
+                pendingSeek = segmentStartMs;
+                setPlayerPosition(segmentStartMs);
+            }
+        } else {
+            pendingSeek = -1;
+            openMedia(mediaPath);
+            pendingSeek = segmentStartMs > 0 ? segmentStartMs : -1;
+            if (pendingSeek >= 0) {
+                setPlayerPosition(pendingSeek);
+            }
+        }
+        playerPlay();
+        playingTrack = track;
+        applyLoop();
+        playHistory->record(PlayHistory::Started, filePath, 0);
         musicNameLabel->setText(musicName);
 
+        // Durée déjà connue : affichée sans attendre le lecteur
+        probedDuration = trackStore->duration(track);
+        if (probedDuration > 0) {
+            musicSlider->setRange(0, int(probedDuration));
+        }
+        updateTimeLabels();
+
         QPixmap image;
         if (customMusicImageMap.contains(musicName)) {
             image = customMusicImageMap.value(musicName);
+        } else if (coverCache.contains(musicName)) {
+            image = *coverCache.object(musicName);
         } else {
-            image = musicImageMap.value(filePath);
+            image = defaultImage;
+            if (customMusicImagePaths.contains(musicName)) {
+                loadCover(musicName);
+            }
+        }
+        if (backgroundMode) {
+            coverPending = true;
+        } else {
+            musicImageLabel->setPixmap(image.scaled(musicImageLabel->size(), Qt::KeepAspectRatio, Qt::SmoothTransformation));
         }
-        musicImageLabel->setPixmap(image.scaled(musicImageLabel->size(), Qt::KeepAspectRatio, Qt::SmoothTransformation));
 
         selectedMusicName = musicName;
         selectedMusicImage = image;
@@ -220,8 +568,13 @@ void QticallyMainWindow::playSelectedMusic()
 
         ui->pushButton_edit->setEnabled(true);
 
-        QSystemTrayIcon::MessageIcon icon = QSystemTrayIcon::Information;
-        trayIcon->showMessage("Qtically", "En train de jouer : " + musicName, icon, 5000);
+        trackStore->setPlayCount(track, playHistory->stats(filePath).plays);
+        trackModel->trackChanged(track);
+        libraryTracksChanged(QVector<int>() << track, TrackStore::PlayCount);
+
+        prefetchCandidates();
+
+        notifyNowPlaying(musicName);
     }
 }
 
@@ -232,11 +585,11 @@ void QticallyMainWindow::playSelectedMusic()
 void QticallyMainWindow::playMusic()
 {
     if (!isPlaying) {
-        player->play();
+        playerPlay();
         isPlaying = true;
         ui->pushButton_play->setIcon(QIcon(":/images/images/pause.png"));
     } else {
-        player->pause();
+        playerPause();
         isPlaying = false;
         ui->pushButton_play->setIcon(QIcon(":/images/images/play.png"));
     }
@@ -248,15 +601,16 @@ void QticallyMainWindow::nextMusic()
     int nextIndex;
 
     if (shuffleEnabled) {
-        do {
-            nextIndex = QRandomGenerator::global()->bounded(musicList->count());
-        } while (nextIndex == prevIndex);
+        if (trackModel->rowCount() == 0) {
+            return;
+        }
+        nextIndex = takeShuffleRow();
     } else {
-        nextIndex = musicList->currentRow() + 1;
+        nextIndex = musicList->currentIndex().row() + 1;
     }
 
-    if (nextIndex < musicList->count()) {
-        musicList->setCurrentRow(nextIndex);
+    if (nextIndex < trackModel->rowCount()) {
+        setCurrentRow(nextIndex);
         playSelectedMusic();
     }
 
@@ -265,18 +619,18 @@ void QticallyMainWindow::nextMusic()
 
 void QticallyMainWindow::previousMusic()
 {
-    int prevIndex = musicList->currentRow() - 1;
+    int prevIndex = musicList->currentIndex().row() - 1;
 
     if (prevIndex >= 0) {
-        musicList->setCurrentRow(prevIndex);
+        setCurrentRow(prevIndex);
         playSelectedMusic();
     }
 }
 
 void QticallyMainWindow::updateTimeLabels()
 {
-    int currentPosition = player->position();
-    int totalDuration = player->duration();
+    int currentPosition = int(trackPosition());
+    int totalDuration = int(trackLength());
 
     QTime currentTime(0, 0, 0, 0);
     currentTime = currentTime.addMSecs(currentPosition);
@@ -293,37 +647,36 @@ void QticallyMainWindow::updateTimeLabels()
 
 void QticallyMainWindow::updateSliderPosition()
 {
-    if (player->duration() != 0) {
-        musicSlider->setRange(0, player->duration());
+    // Fenêtre invisible : rien à redessiner, tout est remis à jour au retour
+    ++positionEvents;
+    if (backgroundMode) {
+        return;
+    }
+
+    const qint64 length = trackLength();
+    if (length != 0) {
+        musicSlider->setRange(0, int(length));
     }
 
     if (!musicSlider->isSliderDown()) {
-        musicSlider->setValue(player->position());
+        musicSlider->setValue(int(trackPosition()));
     }
 
     updateTimeLabels();
 }
 
 
-void QticallyMainWindow::updateMusicName(const QString &oldName, const QString &newName)
+void QticallyMainWindow::updateMusicName(int track, const QString &oldName, const QString &newName)
 {
-    for (int i = 0; i < musicList->count(); ++i) {
-        QListWidgetItem *item = musicList->item(i);
-        if (item->text() == oldName) {
-            item->setText(newName);
-            break;
-        }
-    }
+    // Par identifiant : des titres en double (« Piste 01 » des feuilles CUE) ne sont pas touchés
+    trackStore->setTitle(track, newName);
+    trackModel->trackChanged(track);
+    libraryTracksChanged(QVector<int>() << track, TrackStore::Title);
 
-    if (musicNameLabel->text() == oldName) {
+    if (track == playingTrack) {
         musicNameLabel->setText(newName);
     }
 
-    QMap<QString, QString>::iterator it = musicMap.find(oldName);
-    if (it != musicMap.end()) {
-        it.value() = newName;
-    }
-
     if (selectedMusicName == oldName) {
         selectedMusicName = newName;
     }
@@ -334,9 +687,13 @@ void QticallyMainWindow::updateMusicName(const QString &oldName, const QString &
         customMusicImageMap.insert(newName, image);
     }
 
-    QMap<QString, QPixmap>::iterator it2 = musicImageMap.find(oldName);
-    if (it2 != musicImageMap.end()) {
-        it2.value() = newName;
+    if (customMusicImagePaths.contains(oldName)) {
+        customMusicImagePaths.insert(newName, customMusicImagePaths.take(oldName));
+    }
+
+    if (QPixmap *cover = coverCache.take(oldName)) {
+        cacheCover(newName, *cover);
+        delete cover;
     }
 
 }
@@ -347,7 +704,13 @@ void QticallyMainWindow::updateMusicName(const QString &oldName, const QString &
 
 void QticallyMainWindow::updateMusicImage(const QString &musicName, const QPixmap &newImage)
 {
-    customMusicImageMap.insert(musicName, newImage);
+    // Une pochette relue depuis son fichier peut être évincée du cache
+    if (customMusicImagePaths.contains(musicName)) {
+        customMusicImageMap.remove(musicName);
+        cacheCover(musicName, newImage);
+    } else {
+        customMusicImageMap.insert(musicName, newImage);
+    }
     musicImageLabel->setPixmap(newImage.scaled(musicImageLabel->size(), Qt::KeepAspectRatio, Qt::SmoothTransformation));
 }
 
@@ -356,260 +719,1949 @@ void QticallyMainWindow::updateMusicImage(const QString &musicName, const QPixma
 
 void QticallyMainWindow::importPlaylist()
 {
-    QString fileName = QFileDialog::getOpenFileName(this, tr("Open Playlist"), "", tr("Playlist Files (*.m3u)"));
+    QString fileName = QFileDialog::getOpenFileName(this, tr("Open Playlist"), "", tr("Playlist Files (*.m3u *.cue)"));
     if (!fileName.isEmpty())
+    {
+        importPlaylistFile(fileName);
+    }
+}
+
+void QticallyMainWindow::importPlaylistFile(const QString &fileName)
+{
+    QFileInfo fileInfo(fileName);
+    const qint64 dateAdded = QDateTime::currentMSecsSinceEpoch();
+    QVector<int> tracks;
+    QVector<int> newTracks;
+
+    // Une feuille CUE importée devient la liste de ses pistes
+    if (fileInfo.suffix().compare("cue", Qt::CaseInsensitive) == 0)
+    {
+        tracks = ingestCueSheet(fileInfo.absoluteFilePath(), dateAdded, &newTracks);
+        if (tracks.isEmpty()) {
+            ui->statusbar->showMessage("Feuille CUE illisible : " + fileName, 5000);
+            return;
+        }
+    }
+    else
     {
         QFile file(fileName);
-        if (file.open(QIODevice::ReadOnly | QIODevice::Text))
-        {
-            QTextStream stream(&file);
-            QFileInfo fileInfo(fileName);
-            QString playlistDir = fileInfo.absoluteDir().absolutePath();
+        if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+            return;
+        }
+
+        QTextStream stream(&file);
+        QString playlistDir = fileInfo.absoluteDir().absolutePath();
 
-            while (!stream.atEnd())
+        while (!stream.atEnd())
+        {
+            QString line = stream.readLine();
+            if (!line.startsWith('#'))
             {
-                QString line = stream.readLine();
-                if (!line.startsWith('#'))
-                {
-                    QFileInfo fileInfo(line);
-                    if (fileInfo.isRelative()) {
-                        fileInfo.setFile(playlistDir + '/' + line);
-                    }
+                QFileInfo fileInfo(line);
+                if (fileInfo.isRelative()) {
+                    fileInfo.setFile(playlistDir + '/' + line);
+                }
 
-                    if (fileInfo.exists())
-                    {
-                        QString musicName = fileInfo.completeBaseName();
-                        QListWidgetItem* item = new QListWidgetItem(musicName);
-                        item->setData(Qt::UserRole, fileInfo.absoluteFilePath());
-                        musicList->addItem(item);
-                        musicMap.insert(fileInfo.absoluteFilePath(), fileInfo.absoluteFilePath());
-                        QPixmap defaultImage(":/images/images/OIP.jpeg");
-                        musicImageMap.insert(fileInfo.absoluteFilePath(), defaultImage);
-                    }
+                if (fileInfo.exists())
+                {
+                    tracks += ingestFile(fileInfo, dateAdded, &newTracks);
                 }
             }
-            file.close();
         }
+        file.close();
     }
-}
 
-void QticallyMainWindow::deleteSelectedMusic()
-{
-    if (musicList->currentItem())
-    {
-        QString filePath = musicList->currentItem()->data(Qt::UserRole).toString();
-        player->stop();
-        isPlaying = false;
-        ui->pushButton_play->setIcon(QIcon(":/images/images/play.png"));
-        musicNameLabel->clear();
-        musicImageLabel->clear();
-        ui->pushButton_edit->setEnabled(false);
+    // Les fichiers inconnus rejoignent la table commune, la liste garde son ordre
+    libraryTracksAdded(newTracks);
+    analyzeTracks(newTracks);
 
-        musicList->takeItem(musicList->currentRow());
-        musicMap.remove(filePath);
-        musicImageMap.remove(filePath);
-        customMusicImageMap.remove(QFileInfo(filePath).fileName());
-    }
+    currentPlaylist = playlists.create(uniquePlaylistName(fileInfo.completeBaseName()), tracks);
+    currentSmartPlaylist = -1;
+    playlistsChanged();
+    refreshPlaylistSelector();
+    showCurrentView();
 }
 
-bool QticallyMainWindow::eventFilter(QObject *obj, QEvent *event)
+QVector<int> QticallyMainWindow::ingestFile(const QFileInfo &fileInfo, qint64 dateAdded, QVector<int> *newTracks)
 {
-    if (obj == musicList && event->type() == QEvent::ContextMenu)
-    {
-        if (QContextMenuEvent *contextMenuEvent = dynamic_cast<QContextMenuEvent *>(event))
-        {
-            const QPoint &pos = contextMenuEvent->pos();
-            QListWidgetItem *item = musicList->itemAt(pos);
-
-            if (item)
-            {
-                musicList->setCurrentItem(item);
-                contextMenu->exec(QCursor::pos());
-            }
-
-            return true;
+    // Une feuille CUE, donnée ou posée à côté du fichier, le découpe en pistes
+    const QString filePath = fileInfo.absoluteFilePath();
+    const QString cuePath = fileInfo.suffix().compare("cue", Qt::CaseInsensitive) == 0
+            ? filePath : CueSheet::findFor(filePath);
+    if (!cuePath.isEmpty()) {
+        const QVector<int> cueTracks = ingestCueSheet(cuePath, dateAdded, newTracks);
+        if (!cueTracks.isEmpty() || cuePath == filePath) {
+            return cueTracks;
         }
     }
 
-    return QMainWindow::eventFilter(obj, event);
+    // Une piste déjà connue est référencée, pas recopiée
+    int track = trackStore->idForPath(filePath);
+    if (track < 0) {
+        QString musicName = fileInfo.completeBaseName();
+        track = trackStore->add(filePath, musicName, dateAdded);
+        newTracks->append(track);
+        journalRecord(Journal::addTrack(filePath, musicName, dateAdded));
+    }
+    return QVector<int>() << track;
 }
 
-
-void QticallyMainWindow::saveState(const QString &filename)
+QVector<int> QticallyMainWindow::ingestCueSheet(const QString &cuePath, qint64 dateAdded, QVector<int> *newTracks)
 {
-    QJsonArray musicArray;
-
-    for (int i = 0; i < musicList->count(); ++i)
-    {
-        QListWidgetItem *item = musicList->item(i);
-        QJsonObject musicObject;
-        musicObject["name"] = item->text();
-        musicObject["filePath"] = item->data(Qt::UserRole).toString();
-
-        // Vérifier si l'image actuelle est la même que l'image par défaut
-        if (customMusicImageMap.contains(item->text()) && customMusicImageMap[item->text()] != defaultImage)
-        {
-            QBuffer buffer;
-            buffer.open(QIODevice::WriteOnly);
-            customMusicImageMap[item->text()].save(&buffer, "PNG");
-            musicObject["image"] = QJsonValue(QString(buffer.data().toBase64()));
-            buffer.close();
+    const CueSheet sheet = CueSheet::parse(cuePath);
+    QVector<int> openEnded;
+    QVector<int> tracks;
+    for (const CueSheet::Track &cueTrack : sheet.tracks) {
+        const QString path = CueSheet::virtualPath(cuePath, cueTrack.number);
+        int track = trackStore->idForPath(path);
+        if (track < 0) {
+            track = trackStore->add(path, cueTrack.title, dateAdded);
+            applyCueTrack(track, sheet, cueTrack, &openEnded);
+            newTracks->append(track);
+            journalRecord(Journal::addTrack(path, cueTrack.title, dateAdded));
         }
-
-        musicArray.append(musicObject);
+        tracks.append(track);
     }
+    probeSegmentEnds(openEnded);
+    return tracks;
+}
 
-    QJsonObject settingsObject;
-    settingsObject["repeatEnabled"] = repeatEnabled;
-    settingsObject["shuffleEnabled"] = shuffleEnabled;
-
-    QJsonObject stateObject;
-    stateObject["musicArray"] = musicArray;
-    stateObject["settings"] = settingsObject;
-
-    QJsonDocument jsonDoc(stateObject);
+void QticallyMainWindow::applyCueTrack(int track, const CueSheet &sheet, const CueSheet::Track &cueTrack,
+                                       QVector<int> *openEnded)
+{
+    TrackStore::Segment segment;
+    segment.file = cueTrack.file;
+    segment.start = cueTrack.start;
+    segment.end = cueTrack.end;
+    trackStore->setSegment(track, segment);
+    trackStore->setTags(track, cueTrack.performer, sheet.title);
+
+    // La dernière piste d'un fichier va jusqu'à sa fin : sa durée attend la mesure du fichier
+    if (cueTrack.end < 0) {
+        openEnded->append(track);
+        return;
+    }
+    trackStore->setDuration(track, qMax<qint64>(0, CueSheet::framesToMs(cueTrack.end) - CueSheet::framesToMs(cueTrack.start)));
+}
 
-    QFile file(filename);
-    if (file.open(QIODevice::WriteOnly))
-    {
-        file.write(jsonDoc.toJson());
-        file.close();
+void QticallyMainWindow::probeSegmentEnds(const QVector<int> &tracks)
+{
+    // Fichier mesuré en arrière-plan comme les autres : un MP3 peut demander de lire
+    // toutes ses trames. durationsReady retire le début de la piste
+    if (tracks.isEmpty()) {
+        return;
     }
-    else
-    {
-        QMessageBox::warning(this, "Erreur", "Impossible d'enregistrer la sauvegarde.");
+    QStringList files;
+    files.reserve(tracks.size());
+    for (int track : tracks) {
+        files.append(trackStore->segment(track).file);
     }
+    durationProber->probe(tracks, files);
 }
 
-
-
-void QticallyMainWindow::loadState(const QString &filename)
+void QticallyMainWindow::resolveSegments(const QVector<int> &tracks)
 {
-    QFile file(filename);
-    if (file.open(QIODevice::ReadOnly))
-    {
-        QByteArray jsonData = file.readAll();
-        file.close();
-
-        QJsonDocument jsonDoc = QJsonDocument::fromJson(jsonData);
-        if (!jsonDoc.isNull() && jsonDoc.isObject())
-        {
-            QJsonObject stateObject = jsonDoc.object();
-
-            QJsonArray musicArray = stateObject["musicArray"].toArray();
-            musicList->clear();
-            for (const QJsonValue &musicValue : musicArray)
-            {
-                if (musicValue.isObject())
-                {
-                    QJsonObject musicObject = musicValue.toObject();
-
-                    QString musicName = musicObject["name"].toString();
-                    QString filePath = musicObject["filePath"].toString();
-
-                    QListWidgetItem *item = new QListWidgetItem(musicName);
-                    item->setData(Qt::UserRole, filePath);
-                    musicList->addItem(item);
-
-                    QPixmap image;
-                    if (musicObject.contains("image"))
-                    {
-                        QByteArray imageData = QByteArray::fromBase64(musicObject["image"].toString().toLatin1());
-                        image.loadFromData(imageData);
-                    }
-                    else
-                    {
-                        image = defaultImage;
-                    }
-                    customMusicImageMap.insert(musicName, image);
-                    musicImageMap.insert(filePath, image);
-                }
-            }
-
-            QJsonObject settingsObject = stateObject["settings"].toObject();
-            repeatEnabled = settingsObject["repeatEnabled"].toBool();
-            shuffleEnabled = settingsObject["shuffleEnabled"].toBool();
-
-            ui->pushButton_repeat->setChecked(repeatEnabled);
-            ui->pushButton_shuffle->setChecked(shuffleEnabled);
+    // Pistes CUE relues du journal ou d'une sauvegarde : une lecture par feuille
+    QHash<QString, CueSheet> sheets;
+    QVector<int> openEnded;
+    QVector<int> resolved;
+    for (int track : tracks) {
+        if (trackStore->hasSegment(track)) {
+            continue;
         }
-        else
-        {
-            QMessageBox::warning(this, "Erreur", "Le fichier de sauvegarde est invalide.");
+        const QString path = trackStore->path(track);
+        const QString cuePath = CueSheet::cuePathOf(path);
+        if (!sheets.contains(cuePath)) {
+            sheets.insert(cuePath, CueSheet::parse(cuePath));
+        }
+        const CueSheet sheet = sheets.value(cuePath);
+        const int number = CueSheet::trackNumberOf(path);
+        for (const CueSheet::Track &cueTrack : sheet.tracks) {
+            if (cueTrack.number == number) {
+                applyCueTrack(track, sheet, cueTrack, &openEnded);
+                resolved.append(track);
+                break;
+            }
         }
     }
-    else
-    {
-        QMessageBox::warning(this, "Erreur", "Impossible d'ouvrir le fichier de sauvegarde.");
+    probeSegmentEnds(openEnded);
+
+    if (!resolved.isEmpty()) {
+        trackModel->tracksChanged();
+        libraryTracksChanged(resolved, TrackStore::Artist);
+        libraryTracksChanged(resolved, TrackStore::Album);
+        libraryTracksChanged(resolved, TrackStore::Duration);
     }
 }
 
-void QticallyMainWindow::save()
+qint64 QticallyMainWindow::trackPosition() const
 {
-    QString defaultFileName = QDateTime::currentDateTime().toString("yyyy-MM-dd_hh-mm-ss");
-    QString fileName = QFileDialog::getSaveFileName(this, "Sauvegarder", defaultFileName, "Fichiers de sauvegarde (*.json)");
+    return qMax<qint64>(0, playerPosition() - segmentStartMs);
+}
 
-    if (!fileName.isEmpty())
-    {
-        if (!fileName.endsWith(".json", Qt::CaseInsensitive)) {
-            fileName += ".json";
-        }
-        saveState(fileName);
+qint64 QticallyMainWindow::trackLength() const
+{
+    // Pour une piste CUE, sa portion du fichier
+    if (segmentEndMs >= 0) {
+        return segmentEndMs - segmentStartMs;
+    }
+    if (playerDuration() > 0) {
+        return qMax<qint64>(0, playerDuration() - segmentStartMs);
     }
+    return probedDuration;
 }
 
-void QticallyMainWindow::open()
+void QticallyMainWindow::seekTrack(qint64 position)
 {
-    QString fileName = QFileDialog::getOpenFileName(this, "Ouvrir", "", "Fichiers de sauvegarde (*.json)");
-    if (!fileName.isEmpty())
-    {
-        loadState(fileName);
-    }
+    setPlayerPosition(segmentStartMs + qBound<qint64>(0, position, qMax<qint64>(0, trackLength())));
 }
 
-void QticallyMainWindow::keyPressEvent(QKeyEvent *event)
+void QticallyMainWindow::openMedia(const QString &path)
 {
-    if (event->key() == Qt::Key_Space || event->key() == Qt::Key_Return) {
-        playMusic();
-    } else if (event->key() == Qt::Key_Left) {
-        int currentPosition = player->position();
-        int newPosition = currentPosition - 10000;
-        if (newPosition >= 0) {
-            player->setPosition(newPosition);
+    // WAV PCM : lu depuis le fichier projeté, sans décodeur ; sinon le lecteur multimédia
+    if (path.endsWith(".wav", Qt::CaseInsensitive) && wavPlayer->open(path)) {
+        if (!directWav) {
+            player->stop();
+            player->setMedia(QMediaContent());
+            directWav = true;
         }
-    } else if (event->key() == Qt::Key_Right) {
-        int currentPosition = player->position();
-        int newPosition = currentPosition + 10000;
-        if (newPosition <= player->duration()) {
-            player->setPosition(newPosition);
+    } else {
+        if (directWav) {
+            wavPlayer->close();
+            directWav = false;
         }
+        player->setMedia(QUrl::fromLocalFile(path));
     }
-    QMainWindow::keyPressEvent(event);
+    openedMedia = path;
+}
+
+qint64 QticallyMainWindow::playerPosition() const
+{
+    return directWav ? wavPlayer->position() : player->position();
 }
 
+qint64 QticallyMainWindow::playerDuration() const
+{
+    return directWav ? wavPlayer->duration() : player->duration();
+}
 
-void QticallyMainWindow::sliderPressed()
+void QticallyMainWindow::setPlayerPosition(qint64 position)
 {
-    int position = musicSlider->value();
-    player->setPosition(position);
-    updateTimeLabels();
+    if (directWav) {
+        wavPlayer->setPosition(position);
+    } else {
+        player->setPosition(position);
+    }
 }
 
+QMediaPlayer::MediaStatus QticallyMainWindow::playerStatus() const
+{
+    return directWav ? wavPlayer->mediaStatus() : player->mediaStatus();
+}
 
-void QticallyMainWindow::filterMusicList()
+void QticallyMainWindow::playerPlay()
 {
-    QString filter = searchBar->text();
-    for (int i = 0; i < musicList->count(); ++i)
-    {
-        QListWidgetItem *item = musicList->item(i);
-        if (item->text().contains(filter, Qt::CaseInsensitive))
-        {
-            item->setHidden(false);
-        }
-        else
-        {
-            item->setHidden(true);
-        }
+    if (directWav) {
+        wavPlayer->play();
+    } else {
+        player->play();
     }
 }
 
+void QticallyMainWindow::playerPause()
+{
+    if (directWav) {
+        wavPlayer->pause();
+    } else {
+        player->pause();
+    }
+}
+
+void QticallyMainWindow::playerStop()
+{
+    if (directWav) {
+        wavPlayer->stop();
+    } else {
+        player->stop();
+    }
+}
+
+void QticallyMainWindow::applyNotifyInterval()
+{
+    // Une fin de piste CUE est guettée même en arrière-plan, un peu moins souvent ;
+    // une fin de boucle A-B aussi, sauf en WAV où la boucle se referme dans le flux
+    int interval = backgroundMode ? backgroundNotifyInterval : defaultNotifyInterval;
+    if (segmentEndMs >= 0 || (loopEndMs >= 0 && !directWav)) {
+        interval = backgroundMode ? backgroundSegmentNotifyInterval : segmentNotifyInterval;
+    }
+    player->setNotifyInterval(interval);
+    wavPlayer->setNotifyInterval(interval);
+}
+
+bool QticallyMainWindow::repeatsTrack() const
+{
+    // Répétition avec lecture aléatoire : une autre piste est tirée
+    return repeatEnabled && !shuffleEnabled;
+}
+
+void QticallyMainWindow::recordRepeat()
+{
+    // Nouvelle écoute de la même piste : l'historique seul, ni pochette ni notification
+    const int track = playingTrack;
+    endPlayback(PlayHistory::Finished);
+    if (track < 0 || !trackStore->contains(track)) {
+        return;
+    }
+    playingTrack = track;
+    const QString filePath = trackStore->path(track);
+    playHistory->record(PlayHistory::Started, filePath, 0);
+    trackStore->setPlayCount(track, playHistory->stats(filePath).plays);
+    trackModel->trackChanged(track);
+    libraryTracksChanged(QVector<int>() << track, TrackStore::PlayCount);
+}
+
+void QticallyMainWindow::restartTrack()
+{
+    // Lecteur multimédia : un déplacement dans le fichier déjà ouvert et décodé
+    recordRepeat();
+    pendingSeek = segmentStartMs;
+    setPlayerPosition(segmentStartMs);
+    playerPlay();
+    isPlaying = true;
+    ui->pushButton_play->setIcon(QIcon(":/images/images/pause.png"));
+}
+
+void QticallyMainWindow::applyLoop()
+{
+    // Le WAV boucle dans son flux, à l'échantillon près : la boucle A-B, sinon la
+    // piste entière quand elle se répète. Le lecteur multimédia boucle par déplacement
+    if (directWav) {
+        const qint64 rate = wavPlayer->sampleRate();
+        if (loopEndMs >= 0) {
+            wavPlayer->setLoop(loopStartMs * rate / 1000, loopEndMs * rate / 1000);
+        } else if (repeatsTrack() && playingTrack >= 0 && trackStore->hasSegment(playingTrack)) {
+            // Bornes CUE en trames CD, converties sans passer par les millisecondes
+            const TrackStore::Segment segment = trackStore->segment(playingTrack);
+            wavPlayer->setLoop(segment.start * rate / CueSheet::FramesPerSecond,
+                               segment.end >= 0 ? segment.end * rate / CueSheet::FramesPerSecond
+                                                : wavPlayer->frameCount());
+        } else if (repeatsTrack() && playingTrack >= 0) {
+            wavPlayer->setLoop(0, wavPlayer->frameCount());
+        } else {
+            wavPlayer->clearLoop();
+        }
+    }
+    applyNotifyInterval();
+}
+
+void QticallyMainWindow::setLoopStart(qint64 position)
+{
+    if (playingTrack < 0) {
+        return;
+    }
+    loopStartMs = position;
+    if (loopEndMs >= 0 && loopEndMs - loopStartMs < minLoopMs) {
+        loopEndMs = -1;
+    }
+    applyLoop();
+    ui->statusbar->showMessage("Début de boucle : " + loopTime(loopStartMs - segmentStartMs), 3000);
+}
+
+void QticallyMainWindow::setLoopEnd(qint64 position)
+{
+    if (playingTrack < 0) {
+        return;
+    }
+    // Sans début marqué, la boucle part du début de la piste
+    qint64 start = loopStartMs >= 0 ? loopStartMs : segmentStartMs;
+    qint64 end = position;
+    if (end < start) {
+        qSwap(start, end);
+    }
+    if (end - start < minLoopMs) {
+        ui->statusbar->showMessage("Boucle trop courte", 3000);
+        return;
+    }
+    loopStartMs = start;
+    loopEndMs = end;
+    applyLoop();
+    ui->statusbar->showMessage(QString("Boucle de %1 à %2").arg(loopTime(loopStartMs - segmentStartMs))
+                               .arg(loopTime(loopEndMs - segmentStartMs)), 3000);
+}
+
+void QticallyMainWindow::markLoopPoint()
+{
+    // Au clavier : début, fin, puis retrait de la boucle
+    if (loopEndMs >= 0) {
+        clearLoop();
+    } else if (loopStartMs < 0) {
+        setLoopStart(playerPosition());
+    } else {
+        setLoopEnd(playerPosition());
+    }
+}
+
+void QticallyMainWindow::clearLoop()
+{
+    if (loopStartMs < 0 && loopEndMs < 0) {
+        return;
+    }
+    loopStartMs = -1;
+    loopEndMs = -1;
+    applyLoop();
+    ui->statusbar->showMessage("Boucle retirée", 3000);
+}
+
+void QticallyMainWindow::showSliderMenu(const QPoint &pos)
+{
+    if (playingTrack < 0) {
+        return;
+    }
+    // Position de la piste sous le pointeur, et non celle de la poignée
+    const qint64 position = segmentStartMs + QStyle::sliderValueFromPosition(musicSlider->minimum(), musicSlider->maximum(),
+                                                                             pos.x(), musicSlider->width());
+    QMenu menu(this);
+    menu.addAction("Début de boucle ici", this, [this, position]() {
+        setLoopStart(position);
+    });
+    menu.addAction("Fin de boucle ici", this, [this, position]() {
+        setLoopEnd(position);
+    });
+    QAction *clear = menu.addAction("Retirer la boucle", this, &QticallyMainWindow::clearLoop);
+    clear->setEnabled(loopStartMs >= 0 || loopEndMs >= 0);
+    menu.exec(musicSlider->mapToGlobal(pos));
+}
+
+void QticallyMainWindow::notifyNowPlaying(const QString &musicName)
+{
+    pendingNotification = musicName;
+    notificationTimer->start();
+}
+
+void QticallyMainWindow::showPendingNotification()
+{
+    QSystemTrayIcon::MessageIcon icon = QSystemTrayIcon::Information;
+    trayIcon->showMessage("Qtically", "En train de jouer : " + pendingNotification, icon, 5000);
+}
+
+void QticallyMainWindow::changeEvent(QEvent *event)
+{
+    if (event->type() == QEvent::WindowStateChange) {
+        QTimer::singleShot(0, this, &QticallyMainWindow::updateBackgroundMode);
+    }
+    QMainWindow::changeEvent(event);
+}
+
+void QticallyMainWindow::showEvent(QShowEvent *event)
+{
+    QMainWindow::showEvent(event);
+    QTimer::singleShot(0, this, &QticallyMainWindow::updateBackgroundMode);
+}
+
+void QticallyMainWindow::hideEvent(QHideEvent *event)
+{
+    QMainWindow::hideEvent(event);
+    QTimer::singleShot(0, this, &QticallyMainWindow::updateBackgroundMode);
+}
+
+void QticallyMainWindow::updateBackgroundMode()
+{
+    const bool background = !isVisible() || isMinimized();
+    if (background == backgroundMode) {
+        return;
+    }
+    backgroundMode = background;
+    applyNotifyInterval();
+    // Le tampon plus long sert dès la piste ou le déplacement suivant
+    wavPlayer->setBufferDuration(background ? backgroundBufferMs : foregroundBufferMs);
+
+    qint64 cpuMs = 0;
+    qint64 wakeups = 0;
+    processUsage(&cpuMs, &wakeups);
+
+    if (background) {
+        memoryTimer->stop();
+        backgroundTimer.start();
+        backgroundCpuMs = cpuMs;
+        backgroundWakeups = wakeups;
+        positionEvents = 0;
+        return;
+    }
+
+    // Retour au premier plan : ce qui a été différé, puis le bilan de l'absence
+    memoryTimer->start();
+    if (coverPending) {
+        musicImageLabel->setPixmap(selectedMusicImage.scaled(musicImageLabel->size(), Qt::KeepAspectRatio, Qt::SmoothTransformation));
+        coverPending = false;
+    }
+    const int events = positionEvents;
+    updateSliderPosition();
+
+    const double seconds = qMax<qint64>(1, backgroundTimer.elapsed()) / 1000.0;
+    ui->statusbar->showMessage(QString("Arrière-plan pendant %1 s : %2 réveils/s, %3 ms de processeur/min, %4 positions reçues")
+                               .arg(qRound(seconds))
+                               .arg((wakeups - backgroundWakeups) / seconds, 0, 'f', 1)
+                               .arg(qRound((cpuMs - backgroundCpuMs) * 60 / seconds))
+                               .arg(events), 10000);
+}
+
+void QticallyMainWindow::checkSegmentEnd(qint64 position)
+{
+    // Positions d'avant un déplacement encore en cours : ignorées jusqu'à son arrivée
+    if (pendingSeek >= 0) {
+        if (qAbs(position - pendingSeek) <= segmentSeekTolerance) {
+            pendingSeek = -1;
+        }
+        return;
+    }
+    // Fin de boucle A-B du lecteur multimédia : retour au début, le WAV boucle seul
+    if (loopEndMs >= 0 && !directWav && playingTrack >= 0 && position >= loopEndMs) {
+        pendingSeek = loopStartMs;
+        setPlayerPosition(loopStartMs);
+        return;
+    }
+    if (segmentEndMs < 0 || playingTrack < 0 || position < segmentEndMs) {
+        return;
+    }
+
+    // Fin d'une piste CUE au milieu du fichier : même enchaînement qu'en fin de
+    // fichier, la piste suivante contiguë continue sans déplacement
+    if (repeatsTrack()) {
+        restartTrack();
+        return;
+    }
+    endPlayback(PlayHistory::Finished);
+    if (repeatEnabled) {
+        if (shuffleEnabled && trackModel->rowCount() > 0) {
+            setCurrentRow(takeShuffleRow());
+        }
+        playSelectedMusic();
+    } else {
+        nextMusic();
+    }
+
+    // Rien à la suite : le reste du fichier appartient à d'autres pistes
+    if (playingTrack < 0) {
+        playerStop();
+        isPlaying = false;
+        ui->pushButton_play->setIcon(QIcon(":/images/images/play.png"));
+    }
+}
+
+void QticallyMainWindow::openArguments(const QStringList &arguments)
+{
+    // Fichiers et commandes transmis au lancement ou par une autre instance
+    const qint64 dateAdded = QDateTime::currentMSecsSinceEpoch();
+    QVector<int> newTracks;
+    int firstTrack = -1;
+
+    for (const QString &argument : arguments) {
+        if (argument == SingleInstance::playPauseCommand) {
+            playMusic();
+        } else if (argument == SingleInstance::nextCommand) {
+            nextMusic();
+        } else if (argument == SingleInstance::previousCommand) {
+            previousMusic();
+        } else if (argument.endsWith(".m3u", Qt::CaseInsensitive)) {
+            importPlaylistFile(argument);
+        } else if (argument.endsWith(".mp3", Qt::CaseInsensitive) || argument.endsWith(".wav", Qt::CaseInsensitive)
+                   || argument.endsWith(".cue", Qt::CaseInsensitive)) {
+            const QFileInfo fileInfo(argument);
+            if (fileInfo.exists()) {
+                const QVector<int> tracks = ingestFile(fileInfo, dateAdded, &newTracks);
+                if (firstTrack < 0 && !tracks.isEmpty()) {
+                    firstTrack = tracks.first();
+                }
+            }
+        }
+    }
+
+    // Un seul lot pour la liste, les règles et l'analyse, quel que soit le nombre de fichiers
+    if (!newTracks.isEmpty()) {
+        libraryTracksAdded(newTracks);
+        analyzeTracks(newTracks);
+    }
+
+    if (firstTrack >= 0) {
+        if (trackModel->rowOf(firstTrack) < 0 && (currentSmartPlaylist >= 0 || currentPlaylist >= 0)) {
+            playlistSelector->setCurrentIndex(0);
+        }
+        const int row = trackModel->rowOf(firstTrack);
+        if (row >= 0) {
+            setCurrentRow(row);
+            playSelectedMusic();
+        }
+    }
+
+    if (arguments.isEmpty() || firstTrack >= 0) {
+        showNormal();
+        raise();
+        activateWindow();
+    }
+}
+
+void QticallyMainWindow::deleteSelectedMusic()
+{
+    const int track = currentTrack();
+    if (track >= 0)
+    {
+        clearNowPlaying();
+        removeLibraryTracks(QVector<int>() << track);
+    }
+}
+
+void QticallyMainWindow::clearNowPlaying()
+{
+    endPlayback(PlayHistory::Skipped);
+    loopStartMs = -1;
+    loopEndMs = -1;
+    wavPlayer->clearLoop();
+    playerStop();
+    isPlaying = false;
+    ui->pushButton_play->setIcon(QIcon(":/images/images/play.png"));
+    musicNameLabel->clear();
+    musicImageLabel->clear();
+    ui->pushButton_edit->setEnabled(false);
+}
+
+void QticallyMainWindow::removeLibraryTracks(const QVector<int> &tracks)
+{
+    if (tracks.isEmpty()) {
+        return;
+    }
+
+    if (tracks.size() == 1) {
+        trackModel->removeTrack(tracks.first());
+    } else {
+        trackModel->removeTracks(tracks);
+    }
+    applySmartChanges(smartPlaylists->tracksRemoved(tracks));
+    playlists.removeTracks(tracks);
+    playlistsChanged();
+
+    for (int track : tracks) {
+        const QString filePath = trackStore->path(track);
+        const QString musicName = trackStore->title(track);
+        trackStore->remove(track);
+        customMusicImageMap.remove(musicName);
+        customMusicImagePaths.remove(musicName);
+        coverCache.remove(musicName);
+        journalRecord(Journal::removeTrack(filePath));
+    }
+    updateLibraryStatus();
+}
+
+bool QticallyMainWindow::eventFilter(QObject *obj, QEvent *event)
+{
+    if (obj == musicList->viewport() && event->type() == QEvent::ContextMenu)
+    {
+        if (QContextMenuEvent *contextMenuEvent = dynamic_cast<QContextMenuEvent *>(event))
+        {
+            const QPoint &pos = contextMenuEvent->pos();
+            QModelIndex index = musicList->indexAt(pos);
+
+            if (index.isValid())
+            {
+                musicList->setCurrentIndex(index);
+                contextMenu->exec(QCursor::pos());
+            }
+
+            return true;
+        }
+    }
+
+    return QMainWindow::eventFilter(obj, event);
+}
+
+
+void QticallyMainWindow::saveState(const QString &filename)
+{
+    QJsonArray musicArray;
+
+    // Toute la bibliothèque est sauvegardée, quelle que soit la liste affichée
+    QVector<int> tracks = trackStore->ids();
+    if (currentSmartPlaylist < 0 && currentPlaylist < 0) {
+        tracks = trackModel->allTracks();
+    }
+    QHash<int, int> trackIndexes;
+    for (int track : tracks)
+    {
+        trackIndexes.insert(track, musicArray.size());
+        QString musicName = trackStore->title(track);
+        QJsonObject musicObject;
+        musicObject["name"] = musicName;
+        musicObject["filePath"] = trackStore->path(track);
+        musicObject["dateAdded"] = double(trackStore->dateAdded(track));
+
+        // Une pochette choisie par l'utilisateur est sauvegardée par son chemin,
+        // sans être réencodée
+        if (customMusicImagePaths.contains(musicName))
+        {
+            musicObject["imagePath"] = customMusicImagePaths.value(musicName);
+        }
+        // Vérifier si l'image actuelle est la même que l'image par défaut
+        else if (customMusicImageMap.contains(musicName) && customMusicImageMap[musicName] != defaultImage)
+        {
+            QBuffer buffer;
+            buffer.open(QIODevice::WriteOnly);
+            customMusicImageMap[musicName].save(&buffer, "PNG");
+            musicObject["image"] = QJsonValue(QString(buffer.data().toBase64()));
+            buffer.close();
+        }
+
+        musicArray.append(musicObject);
+    }
+
+    QJsonObject settingsObject;
+    settingsObject["repeatEnabled"] = repeatEnabled;
+    settingsObject["shuffleEnabled"] = shuffleEnabled;
+
+    // Listes intelligentes : la règle et les membres, par position dans musicArray
+    QJsonArray smartArray;
+    for (int i = 0; i < smartPlaylists->count(); ++i)
+    {
+        QJsonArray members;
+        const QVector<int> ids = smartPlaylists->members(i);
+        for (int id : ids) {
+            members.append(trackIndexes.value(id));
+        }
+        QJsonObject smartObject;
+        smartObject["name"] = smartPlaylists->name(i);
+        smartObject["rule"] = smartPlaylists->rule(i);
+        smartObject["members"] = members;
+        smartArray.append(smartObject);
+    }
+
+    QJsonObject stateObject;
+    stateObject["musicArray"] = musicArray;
+    stateObject["settings"] = settingsObject;
+    stateObject["smartPlaylists"] = smartArray;
+
+    QJsonArray playlistArray;
+    for (int i = 0; i < playlists.count(); ++i)
+    {
+        QJsonArray entries;
+        const QVector<int> ids = playlists.tracks(i);
+        for (int id : ids) {
+            if (trackIndexes.contains(id)) {
+                entries.append(trackIndexes.value(id));
+            }
+        }
+        QJsonObject playlistObject;
+        playlistObject["name"] = playlists.name(i);
+        playlistObject["tracks"] = entries;
+        playlistArray.append(playlistObject);
+    }
+    stateObject["playlists"] = playlistArray;
+
+    QJsonDocument jsonDoc(stateObject);
+
+    QFile file(filename);
+    if (file.open(QIODevice::WriteOnly))
+    {
+        file.write(jsonDoc.toJson());
+        file.close();
+    }
+    else
+    {
+        QMessageBox::warning(this, "Erreur", "Impossible d'enregistrer la sauvegarde.");
+    }
+}
+
+
+
+void QticallyMainWindow::loadState(const QString &filename)
+{
+    QFile file(filename);
+    if (file.open(QIODevice::ReadOnly))
+    {
+        QByteArray jsonData = file.readAll();
+        file.close();
+
+        QJsonDocument jsonDoc = QJsonDocument::fromJson(jsonData);
+        if (!jsonDoc.isNull() && jsonDoc.isObject())
+        {
+            QJsonObject stateObject = jsonDoc.object();
+
+            QJsonArray musicArray = stateObject["musicArray"].toArray();
+            trackStore->clear();
+            *smartPlaylists = SmartPlaylists(trackStore);
+            journalRecord(Journal::clearLibrary());
+            const qint64 now = QDateTime::currentMSecsSinceEpoch();
+            QVector<int> loadedTracks;
+            for (const QJsonValue &musicValue : musicArray)
+            {
+                if (musicValue.isObject())
+                {
+                    QJsonObject musicObject = musicValue.toObject();
+
+                    QString musicName = musicObject["name"].toString();
+                    QString filePath = musicObject["filePath"].toString();
+
+                    const qint64 dateAdded = musicObject.contains("dateAdded") ? qint64(musicObject["dateAdded"].toDouble()) : now;
+                    loadedTracks.append(trackStore->add(filePath, musicName, dateAdded));
+
+                    journalRecord(Journal::addTrack(filePath, musicName, dateAdded));
+
+                    QPixmap image;
+                    if (musicObject.contains("imagePath"))
+                    {
+                        QString imagePath = musicObject["imagePath"].toString();
+                        customMusicImagePaths.insert(musicName, imagePath);
+                        journalRecord(Journal::setArtworkFile(filePath, imagePath));
+                        continue;
+                    }
+                    if (musicObject.contains("image"))
+                    {
+                        QByteArray imageData = QByteArray::fromBase64(musicObject["image"].toString().toLatin1());
+                        image = QPixmap::fromImage(CoverLoader::decodeData(imageData, CoverLoader::coverSize()));
+                        journalRecord(Journal::setArtwork(filePath, image.toImage()));
+                    }
+                    else
+                    {
+                        image = defaultImage;
+                    }
+                    customMusicImageMap.insert(musicName, image);
+                }
+            }
+
+            // Membres relus tels quels : pas de réévaluation des règles
+            const QJsonArray smartArray = stateObject["smartPlaylists"].toArray();
+            for (const QJsonValue &smartValue : smartArray)
+            {
+                const QJsonObject smartObject = smartValue.toObject();
+                const QString name = smartObject["name"].toString();
+                const QString rule = smartObject["rule"].toString();
+                if (name.isEmpty()) {
+                    continue;
+                }
+                if (smartObject.contains("members")) {
+                    QVector<int> members;
+                    const QJsonArray memberArray = smartObject["members"].toArray();
+                    for (const QJsonValue &member : memberArray) {
+                        const int index = member.toInt(-1);
+                        if (index >= 0 && index < loadedTracks.size()) {
+                            members.append(loadedTracks.at(index));
+                        }
+                    }
+                    smartPlaylists->restore(name, rule, members);
+                } else {
+                    smartPlaylists->add(name, rule);
+                }
+                journalRecord(Journal::setSmartPlaylist(name, rule));
+            }
+
+            playlists.clear();
+            const QJsonArray playlistArray = stateObject["playlists"].toArray();
+            for (const QJsonValue &playlistValue : playlistArray)
+            {
+                const QJsonObject playlistObject = playlistValue.toObject();
+                QVector<int> ids;
+                const QJsonArray entries = playlistObject["tracks"].toArray();
+                for (const QJsonValue &entry : entries) {
+                    const int index = entry.toInt(-1);
+                    if (index >= 0 && index < loadedTracks.size()) {
+                        ids.append(loadedTracks.at(index));
+                    }
+                }
+                playlists.create(uniquePlaylistName(playlistObject["name"].toString()), ids);
+            }
+            playlistsChanged();
+
+            currentSmartPlaylist = -1;
+            currentPlaylist = -1;
+            refreshPlaylistSelector();
+            trackModel->resetTracks();
+            analyzeTracks(trackStore->ids());
+            // Les chemins de la sauvegarde ne sont peut-être plus valables
+            checkLibraryHealth();
+
+            QJsonObject settingsObject = stateObject["settings"].toObject();
+            repeatEnabled = settingsObject["repeatEnabled"].toBool();
+            shuffleEnabled = settingsObject["shuffleEnabled"].toBool();
+
+            ui->pushButton_repeat->setChecked(repeatEnabled);
+            ui->pushButton_shuffle->setChecked(shuffleEnabled);
+
+            journalRecord(Journal::setSetting("repeatEnabled", repeatEnabled));
+            journalRecord(Journal::setSetting("shuffleEnabled", shuffleEnabled));
+            journal->compact();
+        }
+        else
+        {
+            QMessageBox::warning(this, "Erreur", "Le fichier de sauvegarde est invalide.");
+        }
+    }
+    else
+    {
+        QMessageBox::warning(this, "Erreur", "Impossible d'ouvrir le fichier de sauvegarde.");
+    }
+}
+
+void QticallyMainWindow::save()
+{
+    QString defaultFileName = QDateTime::currentDateTime().toString("yyyy-MM-dd_hh-mm-ss");
+    QString fileName = QFileDialog::getSaveFileName(this, "Sauvegarder", defaultFileName, "Fichiers de sauvegarde (*.json)");
+
+    if (!fileName.isEmpty())
+    {
+        if (!fileName.endsWith(".json", Qt::CaseInsensitive)) {
+            fileName += ".json";
+        }
+        saveState(fileName);
+    }
+}
+
+void QticallyMainWindow::open()
+{
+    QString fileName = QFileDialog::getOpenFileName(this, "Ouvrir", "", "Fichiers de sauvegarde (*.json)");
+    if (!fileName.isEmpty())
+    {
+        loadState(fileName);
+    }
+}
+
+void QticallyMainWindow::keyPressEvent(QKeyEvent *event)
+{
+    if (event->key() == Qt::Key_Space || event->key() == Qt::Key_Return) {
+        playMusic();
+    } else if (event->key() == Qt::Key_Left) {
+        qint64 newPosition = trackPosition() - 10000;
+        if (newPosition >= 0) {
+            seekTrack(newPosition);
+        }
+    } else if (event->key() == Qt::Key_Right) {
+        qint64 newPosition = trackPosition() + 10000;
+        if (newPosition <= trackLength()) {
+            seekTrack(newPosition);
+        }
+    } else if (event->key() == Qt::Key_L) {
+        markLoopPoint();
+    } else if (event->key() == Qt::Key_Escape) {
+        clearLoop();
+    }
+    QMainWindow::keyPressEvent(event);
+}
+
+
+void QticallyMainWindow::sliderPressed()
+{
+    int position = musicSlider->value();
+    seekTrack(position);
+    updateTimeLabels();
+}
+
+
+void QticallyMainWindow::filterMusicList()
+{
+    QElapsedTimer timer;
+    timer.start();
+    trackModel->setFilter(searchBar->text());
+
+    if (!searchBar->text().trimmed().isEmpty()) {
+        ui->statusbar->showMessage(QString("%1 résultats en %2 ms").arg(trackModel->rowCount()).arg(timer.elapsed()), 3000);
+    } else {
+        ui->statusbar->clearMessage();
+    }
+}
+
+
+void QticallyMainWindow::journalRecord(const Journal::Record &record)
+{
+    if (journal && !restoringJournal) {
+        journal->append(record);
+    }
+}
+
+void QticallyMainWindow::restoreFromJournal()
+{
+    restoringJournal = true;
+
+    QMap<QString, QString> smartRules;
+    const QVector<Journal::Record> records = journal->takeReplayedRecords();
+    for (const Journal::Record &record : records)
+    {
+        const int track = trackStore->idForPath(record.path);
+
+        switch (record.type) {
+        case Journal::AddTrack:
+            if (track < 0) {
+                trackStore->add(record.path, record.text, record.value);
+            } else {
+                trackStore->setTitle(track, record.text);
+            }
+            break;
+        case Journal::RenameTrack:
+            if (track >= 0) {
+                QString oldName = trackStore->title(track);
+                if (customMusicImageMap.contains(oldName)) {
+                    customMusicImageMap.insert(record.text, customMusicImageMap.take(oldName));
+                }
+                if (customMusicImagePaths.contains(oldName)) {
+                    customMusicImagePaths.insert(record.text, customMusicImagePaths.take(oldName));
+                }
+                trackStore->setTitle(track, record.text);
+            }
+            break;
+        case Journal::SetArtwork:
+            if (track >= 0 && !record.text.isEmpty()) {
+                customMusicImagePaths.insert(trackStore->title(track), record.text);
+                customMusicImageMap.remove(trackStore->title(track));
+                coverCache.remove(trackStore->title(track));
+            } else if (track >= 0) {
+                QImage image = CoverLoader::decodeData(record.data, CoverLoader::coverSize());
+                customMusicImageMap.insert(trackStore->title(track), QPixmap::fromImage(image));
+            }
+            break;
+        case Journal::RemoveTrack:
+            if (track >= 0) {
+                customMusicImageMap.remove(trackStore->title(track));
+                customMusicImagePaths.remove(trackStore->title(track));
+                trackStore->remove(track);
+            }
+            break;
+        case Journal::SetSetting:
+            if (record.path == "repeatEnabled") {
+                repeatEnabled = record.flag;
+                ui->pushButton_repeat->setChecked(repeatEnabled);
+            } else if (record.path == "shuffleEnabled") {
+                shuffleEnabled = record.flag;
+                ui->pushButton_shuffle->setChecked(shuffleEnabled);
+            }
+            break;
+        case Journal::ClearLibrary:
+            trackStore->clear();
+            customMusicImageMap.clear();
+            customMusicImagePaths.clear();
+            coverCache.clear();
+            smartRules.clear();
+            break;
+        case Journal::SetSmartPlaylist:
+            smartRules.insert(record.path, record.text);
+            break;
+        case Journal::RemoveSmartPlaylist:
+            smartRules.remove(record.path);
+            break;
+        case Journal::RelinkTrack:
+            if (track >= 0) {
+                trackStore->setPath(track, record.text);
+            }
+            break;
+        }
+    }
+
+    // Les règles sont évaluées une fois la bibliothèque complète
+    for (QMap<QString, QString>::const_iterator it = smartRules.constBegin(); it != smartRules.constEnd(); ++it) {
+        smartPlaylists->add(it.key(), it.value());
+    }
+    playlists.load(playlistsFileName, trackStore);
+    refreshPlaylistSelector();
+
+    trackModel->resetTracks();
+    analyzeTracks(trackStore->ids());
+
+    restoringJournal = false;
+}
+
+int QticallyMainWindow::currentTrack() const
+{
+    QModelIndex index = musicList->currentIndex();
+    return index.isValid() ? trackModel->trackAt(index.row()) : -1;
+}
+
+void QticallyMainWindow::setCurrentRow(int row)
+{
+    musicList->setCurrentIndex(trackModel->index(row, 0));
+}
+
+void QticallyMainWindow::scanTags(const QVector<int> &tracks)
+{
+    pendingTagScan += tracks;
+    if (tagBatchesPending > 0 || pendingTagScan.isEmpty()) {
+        return;
+    }
+
+    // Les étiquettes sont lues en arrière-plan, un ajout à la fois, dans la file
+    // normale : la recherche et la lecture ne les attendent jamais
+    tagScanTracks.clear();
+    tagScanTracks.swap(pendingTagScan);
+    for (int begin = 0; begin < tagScanTracks.size(); begin += tagBatchSize) {
+        const QVector<int> batch = tagScanTracks.mid(begin, tagBatchSize);
+        QStringList paths;
+        for (int track : batch) {
+            paths.append(trackStore->path(track));
+        }
+        ++tagBatchesPending;
+        TaskScheduler::instance()->run(TaskScheduler::Io, TaskScheduler::Normal, tagTasks, [this, batch, paths]() {
+            QVector<TagReader::Tags> tags;
+            tags.reserve(paths.size());
+            for (const QString &path : paths) {
+                tags.append(TagReader::read(path));
+            }
+            QMetaObject::invokeMethod(this, "tagsRead", Qt::QueuedConnection,
+                                      Q_ARG(QVector<int>, batch), Q_ARG(QVector<TagReader::Tags>, tags));
+        });
+    }
+}
+
+void QticallyMainWindow::tagsRead(const QVector<int> &tracks, const QVector<TagReader::Tags> &tags)
+{
+    for (int i = 0; i < tracks.size(); ++i) {
+        trackStore->setTags(tracks.at(i), tags.at(i).artist, tags.at(i).album);
+    }
+    if (--tagBatchesPending == 0) {
+        tagScanFinished();
+    }
+}
+
+void QticallyMainWindow::tagScanFinished()
+{
+    trackModel->tracksChanged();
+    libraryTracksChanged(tagScanTracks, TrackStore::Artist);
+    libraryTracksChanged(tagScanTracks, TrackStore::Album);
+    tagScanTracks.clear();
+    scanTags(QVector<int>());
+}
+
+void QticallyMainWindow::analyzeTracks(const QVector<int> &tracks)
+{
+    // Étiquettes et durées des pistes CUE viennent de leur feuille
+    QVector<int> files;
+    QVector<int> segments;
+    QStringList paths;
+    files.reserve(tracks.size());
+    paths.reserve(tracks.size());
+    for (int track : tracks) {
+        const QString path = trackStore->path(track);
+        if (CueSheet::isVirtualPath(path)) {
+            segments.append(track);
+        } else {
+            files.append(track);
+            paths.append(path);
+        }
+    }
+    resolveSegments(segments);
+
+    scanTags(files);
+    durationProber->probe(files, paths);
+    applyPlayCounts(tracks);
+    updateLibraryStatus();
+}
+
+void QticallyMainWindow::applyPlayCounts(const QVector<int> &tracks)
+{
+    QVector<int> changed;
+    for (int track : tracks) {
+        const PlayHistory::Stats stats = playHistory->stats(trackStore->path(track));
+        trackStore->setSkipCount(track, stats.skips);
+        if (stats.plays != trackStore->playCount(track)) {
+            trackStore->setPlayCount(track, stats.plays);
+            changed.append(track);
+        }
+    }
+    if (!changed.isEmpty()) {
+        trackModel->tracksChanged(changed, TrackStore::PlayCount);
+        libraryTracksChanged(changed, TrackStore::PlayCount);
+    }
+}
+
+void QticallyMainWindow::endPlayback(PlayHistory::EventType type)
+{
+    // Une piste lancée puis quittée avant la fin compte comme sautée
+    if (playingTrack < 0 || !trackStore->contains(playingTrack)) {
+        playingTrack = -1;
+        return;
+    }
+    const qint64 position = type == PlayHistory::Finished ? trackStore->duration(playingTrack) : trackPosition();
+    const QString filePath = trackStore->path(playingTrack);
+    playHistory->record(type, filePath, position);
+    // Le tirage aléatoire lit les sauts dans la table, pas dans l'historique
+    trackStore->setSkipCount(playingTrack, playHistory->stats(filePath).skips);
+    playingTrack = -1;
+}
+
+int QticallyMainWindow::shuffleRow() const
+{
+    // Tirage pondéré : les pistes souvent écoutées reviennent plus, les pistes
+    // souvent sautées moins ; la ligne en cours est exclue quand c'est possible
+    const int count = trackModel->rowCount();
+    const int current = musicList->currentIndex().row();
+    QVector<double> cumulative(count);
+    double total = 0;
+    for (int row = 0; row < count; ++row) {
+        if (row != current || count == 1) {
+            const int track = trackModel->trackAt(row);
+            total += (2.0 + qMin<qint64>(trackStore->playCount(track), 20)) / (2.0 + 2.0 * trackStore->skipCount(track));
+        }
+        cumulative[row] = total;
+    }
+
+    const double target = QRandomGenerator::global()->generateDouble() * total;
+    const int row = int(std::upper_bound(cumulative.constBegin(), cumulative.constEnd(), target) - cumulative.constBegin());
+    return qMin(row, count - 1);
+}
+
+int QticallyMainWindow::takeShuffleRow()
+{
+    // Le tirage fait à l'avance est celui qui a été préchargé
+    const int row = nextShuffleTrack >= 0 ? trackModel->rowOf(nextShuffleTrack) : -1;
+    nextShuffleTrack = -1;
+    return row >= 0 ? row : shuffleRow();
+}
+
+void QticallyMainWindow::prefetchCandidates()
+{
+    // Suivante (tirée d'avance en aléatoire), puis les voisines de la ligne en cours
+    const int row = musicList->currentIndex().row();
+    const int count = trackModel->rowCount();
+    QVector<int> rows;
+    if (shuffleEnabled && count > 1) {
+        nextShuffleTrack = trackModel->trackAt(shuffleRow());
+        rows << trackModel->rowOf(nextShuffleTrack) << row - 1;
+    } else {
+        nextShuffleTrack = -1;
+        rows << row + 1 << row + 2 << row - 1;
+    }
+
+    QStringList paths;
+    for (int candidate : rows) {
+        if (candidate >= 0 && candidate < count && candidate != row) {
+            const QString path = trackStore->mediaPath(trackModel->trackAt(candidate));
+            if (path != openedMedia) {
+                paths.append(path);
+            }
+        }
+    }
+    prefetcher->prefetch(paths);
+}
+
+void QticallyMainWindow::showPrefetchStats()
+{
+    const Prefetcher::Stats stats = prefetcher->stats();
+    const int total = stats.hits + stats.misses;
+    const auto average = [](qint64 sum, int samples) -> QString {
+        return samples > 0 ? QString("%1 ms").arg(sum / samples) : QString("—");
+    };
+
+    QString text;
+    text += QString("Pistes préchargées à temps : %1 sur %2 (%3 %)\n")
+            .arg(stats.hits).arg(total).arg(total > 0 ? stats.hits * 100 / total : 0);
+    text += QString("Délai avant le son, piste préchargée : %1\n").arg(average(stats.hitLatencyMs, stats.hitSamples));
+    text += QString("Délai avant le son, sans préchargement : %1\n").arg(average(stats.missLatencyMs, stats.missSamples));
+    text += QString("Données lues d'avance : %1 Mo").arg(stats.bytesWarmed / (1024 * 1024));
+    QMessageBox::information(this, "Préchargement", text);
+}
+
+void QticallyMainWindow::showSchedulerStats()
+{
+    const TaskScheduler *scheduler = TaskScheduler::instance();
+    const char *const poolNames[] = { "Calcul", "Entrées-sorties" };
+    const char *const laneNames[] = { "Interactif", "Normal", "Analyse" };
+    const auto milliseconds = [](qint64 us) -> QString {
+        return QString::number(us / 1000.0, 'f', 1) + " ms";
+    };
+
+    QString text;
+    for (int pool = 0; pool < TaskScheduler::PoolCount; ++pool) {
+        const TaskScheduler::Pool p = TaskScheduler::Pool(pool);
+        text += QString("%1 : %2 threads, %3 tâches reprises à un autre thread\n")
+                .arg(poolNames[pool]).arg(scheduler->threadCount(p)).arg(scheduler->steals(p));
+        for (int lane = 0; lane < TaskScheduler::LaneCount; ++lane) {
+            const TaskScheduler::LaneStats stats = scheduler->stats(p, TaskScheduler::Lane(lane));
+            const qint64 started = stats.completed + stats.cancelled;
+            text += QString("   %1 : %2 en attente, %3 en cours, %4 terminées, %5 annulées")
+                    .arg(laneNames[lane]).arg(stats.queued).arg(stats.running)
+                    .arg(stats.completed).arg(stats.cancelled);
+            if (started > 0) {
+                text += QString(" — attente %1 (max %2)").arg(milliseconds(stats.totalWaitUs / started))
+                        .arg(milliseconds(stats.maxWaitUs));
+            }
+            if (stats.completed > 0) {
+                text += QString(", durée %1").arg(milliseconds(stats.totalRunUs / stats.completed));
+            }
+            text += "\n";
+        }
+    }
+    QMessageBox::information(this, "Tâches de fond", text.trimmed());
+}
+
+void QticallyMainWindow::setVisualizerEnabled(bool enabled)
+{
+    QSettings().setValue("visualizer/enabled", enabled);
+    spectrumWidget->setVisible(enabled);
+}
+
+QStringList QticallyMainWindow::watchRoots() const
+{
+    // Dossiers choisis, sinon le dossier Musique et les parents des dossiers de la bibliothèque
+    QStringList roots = QSettings().value("health/watchRoots").toStringList();
+    if (roots.isEmpty()) {
+        roots.append(QStandardPaths::writableLocation(QStandardPaths::MusicLocation));
+        QSet<QString> parents;
+        for (int track : trackStore->ids()) {
+            const QString path = trackStore->path(track);
+            const QString directory = path.left(path.lastIndexOf('/'));
+            parents.insert(directory.left(qMax(1, directory.lastIndexOf('/'))));
+        }
+        roots += parents.values();
+    }
+
+    // Un dossier contenu dans un autre ne serait parcouru que deux fois
+    std::sort(roots.begin(), roots.end());
+    QStringList minimal;
+    for (const QString &root : roots) {
+        if (root.isEmpty()) {
+            continue;
+        }
+        if (minimal.isEmpty() || (root != minimal.last() && !root.startsWith(minimal.last() + '/'))) {
+            minimal.append(root);
+        }
+    }
+    return minimal;
+}
+
+void QticallyMainWindow::checkLibraryHealth()
+{
+    if (healthChecker->isRunning()) {
+        return;
+    }
+    // Les pistes CUE n'ont pas de fichier à elles, leur chemin n'est pas relié
+    QVector<int> tracks;
+    QStringList paths;
+    for (int track : trackStore->ids()) {
+        const QString path = trackStore->path(track);
+        if (!CueSheet::isVirtualPath(path)) {
+            tracks.append(track);
+            paths.append(path);
+        }
+    }
+    healthChecker->start(tracks, paths, watchRoots());
+}
+
+void QticallyMainWindow::addWatchRoot()
+{
+    const QString directory = QFileDialog::getExistingDirectory(this, "Dossier surveillé");
+    if (directory.isEmpty()) {
+        return;
+    }
+    QSettings settings;
+    QStringList roots = settings.value("health/watchRoots").toStringList();
+    if (!roots.contains(directory)) {
+        roots.append(directory);
+        settings.setValue("health/watchRoots", roots);
+    }
+    checkLibraryHealth();
+}
+
+QString QticallyMainWindow::currentFolder() const
+{
+    const int track = currentTrack();
+    return track >= 0 ? QFileInfo(trackStore->mediaPath(track)).absolutePath() : QString();
+}
+
+void QticallyMainWindow::removeFolder()
+{
+    bool ok = false;
+    const QString folder = QInputDialog::getText(this, "Retirer un dossier", "Dossier à retirer de la bibliothèque :",
+                                                 QLineEdit::Normal, currentFolder(), &ok);
+    if (!ok || folder.isEmpty()) {
+        return;
+    }
+
+    // Pistes trouvées dans l'arbre des dossiers, sans parcourir la bibliothèque
+    const QVector<int> tracks = trackStore->tracksUnder(QDir::fromNativeSeparators(folder));
+    if (tracks.isEmpty()) {
+        ui->statusbar->showMessage("Aucune piste dans " + folder, 5000);
+        return;
+    }
+    if (QMessageBox::question(this, "Retirer un dossier", QString("Retirer %1 pistes de la bibliothèque ?").arg(tracks.size()))
+            != QMessageBox::Yes) {
+        return;
+    }
+
+    if (tracks.contains(playingTrack)) {
+        clearNowPlaying();
+    }
+    removeLibraryTracks(tracks);
+}
+
+void QticallyMainWindow::relinkFolder()
+{
+    bool ok = false;
+    const QString from = QDir::cleanPath(QDir::fromNativeSeparators(QInputDialog::getText(this, "Relier un dossier déplacé", "Ancien emplacement :",
+                                                                                         QLineEdit::Normal, currentFolder(), &ok)));
+    if (!ok || from.isEmpty() || from == ".") {
+        return;
+    }
+    const QString to = QDir::cleanPath(QFileDialog::getExistingDirectory(this, "Nouvel emplacement de " + from, QFileInfo(from).absolutePath()));
+    if (to.isEmpty() || to == ".") {
+        return;
+    }
+
+    // Anciens chemins relevés avant le déplacement : l'historique et le journal les suivent
+    QHash<int, QString> oldPaths;
+    for (int track : trackStore->tracksUnder(from)) {
+        oldPaths.insert(track, trackStore->path(track));
+    }
+    const QVector<int> moved = trackStore->moveDirectory(from, to);
+    if (moved.isEmpty()) {
+        ui->statusbar->showMessage("Aucune piste reliée : dossier inconnu ou chemins déjà présents", 5000);
+        return;
+    }
+
+    for (int track : moved) {
+        const QString oldPath = oldPaths.value(track);
+        const QString newPath = trackStore->path(track);
+        playHistory->relink(oldPath, newPath);
+        healthChecker->pathChanged(oldPath, newPath);
+        journalRecord(Journal::relinkTrack(oldPath, newPath));
+
+        // Le fichier audio d'une feuille CUE a bougé avec elle
+        if (trackStore->hasSegment(track)) {
+            TrackStore::Segment segment = trackStore->segment(track);
+            if (segment.file.startsWith(from + '/')) {
+                segment.file = to + segment.file.mid(from.size());
+                trackStore->setSegment(track, segment);
+            }
+        }
+    }
+
+    trackModel->tracksChanged(moved, TrackStore::Path);
+    libraryTracksChanged(moved, TrackStore::Path);
+    playlistsChanged();
+    ui->statusbar->showMessage(QString("%1 pistes reliées à %2").arg(moved.size()).arg(to), 5000);
+}
+
+void QticallyMainWindow::healthProgress(int done, int total)
+{
+    healthStatus = QString("vérification %1 %").arg(total > 0 ? qint64(done) * 100 / total : 100);
+    updateLibraryStatus();
+}
+
+void QticallyMainWindow::healthCheckFinished(const HealthChecker::Result &result)
+{
+    // Fichiers déplacés : même piste, nouveau chemin partout où il est gardé
+    QVector<int> relinked;
+    for (const QPair<int, QString> &relink : result.relinked) {
+        const int track = relink.first;
+        const QString &newPath = relink.second;
+        if (!trackStore->contains(track) || trackStore->idForPath(newPath) >= 0) {
+            continue;
+        }
+        const QString oldPath = trackStore->path(track);
+        trackStore->setPath(track, newPath);
+        playHistory->relink(oldPath, newPath);
+        journalRecord(Journal::relinkTrack(oldPath, newPath));
+        relinked.append(track);
+    }
+    if (!relinked.isEmpty()) {
+        trackModel->tracksChanged(relinked, TrackStore::Path);
+        libraryTracksChanged(relinked, TrackStore::Path);
+        playlistsChanged();
+    }
+
+    missingTracks.clear();
+    for (int track : result.missing) {
+        missingTracks.insert(track);
+    }
+    unreachableTracks.clear();
+    for (int track : result.unreachable) {
+        unreachableTracks.insert(track);
+    }
+
+    const int unavailable = missingTracks.size() + unreachableTracks.size();
+    healthStatus = unavailable > 0 ? QString("%1 introuvables").arg(unavailable) : QString();
+    updateLibraryStatus();
+    ui->statusbar->showMessage(QString("Bibliothèque vérifiée en %1 ms : %2 reliés, %3 introuvables, %4 injoignables")
+                               .arg(result.elapsedMs).arg(relinked.size())
+                               .arg(missingTracks.size()).arg(unreachableTracks.size()), 8000);
+}
+
+void QticallyMainWindow::showAlbumGrid()
+{
+    if (!albumGridWindow) {
+        albumGridWindow = new AlbumGridWindow(trackStore, this);
+        connect(albumGridWindow, &AlbumGridWindow::groupActivated, this, &QticallyMainWindow::showAlbumGroup);
+        enforceMemoryBudgets();
+    }
+    albumGridWindow->refresh(customMusicImagePaths);
+    albumGridWindow->show();
+    albumGridWindow->raise();
+}
+
+void QticallyMainWindow::showAlbumGroup(const QString &query)
+{
+    // Les pistes du groupe dans la bibliothèque, par la recherche
+    if (currentSmartPlaylist >= 0 || currentPlaylist >= 0) {
+        playlistSelector->setCurrentIndex(0);
+    }
+    searchBar->setText(query);
+    activateWindow();
+}
+
+void QticallyMainWindow::showListeningStats()
+{
+    const int shown = 10;
+    const auto describe = [this](const QStringList &paths) -> QString {
+        QStringList lines;
+        for (const QString &path : paths) {
+            const int track = trackStore->idForPath(path);
+            const PlayHistory::Stats stats = playHistory->stats(path);
+            const QString name = track >= 0 ? trackStore->title(track) : QFileInfo(path).completeBaseName();
+            lines.append(QString("%1 (%2 lectures, %3 sauts)").arg(name).arg(stats.plays).arg(stats.skips));
+        }
+        return lines.isEmpty() ? QString("—") : lines.join("\n");
+    };
+
+    QElapsedTimer timer;
+    timer.start();
+    QString text;
+    text += QString("Les plus écoutés :\n%1\n\n").arg(describe(playHistory->mostPlayed(shown)));
+    text += QString("Les plus écoutés (%1 derniers jours) :\n%2\n\n")
+            .arg(PlayHistory::windowDays()).arg(describe(playHistory->mostPlayed(shown, true)));
+    text += QString("Écoutés récemment :\n%1\n\n").arg(describe(playHistory->recentlyPlayed(shown)));
+    text += QString("Souvent sautés :\n%1").arg(describe(playHistory->skippedOften(shown)));
+    ui->statusbar->showMessage(QString("%1 évènements d'écoute analysés en %2 ms")
+                             .arg(playHistory->eventCount()).arg(timer.elapsed()), 5000);
+
+    QMessageBox::information(this, "Statistiques d'écoute", text);
+}
+
+void QticallyMainWindow::durationsReady(const QVector<int> &tracks, const QVector<qint64> &durations)
+{
+    for (int i = 0; i < tracks.size(); ++i) {
+        qint64 duration = durations.at(i);
+        // Dernière piste CUE : c'est le fichier entier qui a été mesuré
+        if (trackStore->hasSegment(tracks.at(i))) {
+            duration = qMax<qint64>(0, duration - CueSheet::framesToMs(trackStore->segment(tracks.at(i)).start));
+        }
+        trackStore->setDuration(tracks.at(i), duration);
+    }
+    probedTracks += tracks;
+    if (!durationFlushTimer->isActive()) {
+        durationFlushTimer->start();
+    }
+}
+
+void QticallyMainWindow::flushProbedDurations()
+{
+    trackModel->tracksChanged(probedTracks, TrackStore::Duration);
+    libraryTracksChanged(probedTracks, TrackStore::Duration);
+    probedTracks.clear();
+    updateLibraryStatus();
+}
+
+void QticallyMainWindow::updateLibraryStatus()
+{
+    // Le total est tenu à jour par le TrackStore à chaque ajout ou suppression
+    QString total = TrackModel::formatDuration(trackStore->totalDuration());
+    QString status = QString::number(trackStore->count()) + " pistes";
+    if (!total.isEmpty()) {
+        status += " — " + total;
+    }
+
+    // Liste affichée : ses lignes ont leur propre total, la bibliothèque est nommée à part
+    if (currentPlaylist >= 0 || currentSmartPlaylist >= 0) {
+        const QVector<int> tracks = trackModel->allTracks();
+        qint64 duration = 0;
+        for (int track : tracks) {
+            duration += trackStore->duration(track);
+        }
+        QString listStatus = "Liste : " + QString::number(tracks.size()) + " pistes";
+        const QString listTotal = TrackModel::formatDuration(duration);
+        if (!listTotal.isEmpty()) {
+            listStatus += " — " + listTotal;
+        }
+        status = listStatus + " · Bibliothèque : " + status;
+    }
+    if (!healthStatus.isEmpty()) {
+        status += " — " + healthStatus;
+    }
+    libraryStatusLabel->setText(status);
+}
+
+void QticallyMainWindow::loadCover(const QString &musicName)
+{
+    // Pochette attendue à l'écran : file interactive
+    const QString imagePath = customMusicImagePaths.value(musicName);
+    TaskScheduler::instance()->run(TaskScheduler::Cpu, TaskScheduler::Interactive, coverTasks, [this, musicName, imagePath]() {
+        const QImage image = CoverLoader::decode(imagePath, CoverLoader::coverSize());
+        QMetaObject::invokeMethod(this, "coverDecoded", Qt::QueuedConnection,
+                                  Q_ARG(QString, musicName), Q_ARG(QImage, image));
+    });
+}
+
+void QticallyMainWindow::coverDecoded(const QString &musicName, const QImage &image)
+{
+    if (image.isNull() || !customMusicImagePaths.contains(musicName)) {
+        return;
+    }
+
+    QPixmap cover = QPixmap::fromImage(image);
+    cacheCover(musicName, cover);
+    if (selectedMusicName == musicName) {
+        selectedMusicImage = cover;
+        musicImageLabel->setPixmap(cover.scaled(musicImageLabel->size(), Qt::KeepAspectRatio, Qt::SmoothTransformation));
+    }
+}
+
+void QticallyMainWindow::cacheCover(const QString &musicName, const QPixmap &cover)
+{
+    // Coût en Ko pour rester dans les bornes d'un int
+    coverCache.insert(musicName, new QPixmap(cover), qMax(1, int(pixmapBytes(cover) / 1024)));
+}
+
+void QticallyMainWindow::showMemoryDialog()
+{
+    MemoryDialog dialog(memoryMonitor, this);
+    dialog.exec();
+}
+
+void QticallyMainWindow::sampleMemory()
+{
+    const TrackStore::MemoryUsage store = trackStore->memoryUsage();
+    const qint64 maps = qint64(customMusicImagePaths.size()) * mapNodeBytes;
+    memoryMonitor->report(MemoryMonitor::TrackStore, store.columns + maps + durationProber->memoryUsage());
+    memoryMonitor->report(MemoryMonitor::Strings, store.strings);
+    memoryMonitor->report(MemoryMonitor::Search, store.sortKeys + trackModel->memoryUsage());
+
+    // Les pixmaps partagées (image par défaut) ne sont comptées qu'une fois
+    QSet<qint64> counted;
+    counted.insert(defaultImage.cacheKey());
+    qint64 artwork = qint64(coverCache.totalCost()) * 1024 + pixmapBytes(defaultImage);
+    for (const QPixmap &pixmap : customMusicImageMap) {
+        if (!counted.contains(pixmap.cacheKey())) {
+            counted.insert(pixmap.cacheKey());
+            artwork += pixmapBytes(pixmap);
+        }
+    }
+    if (albumGridWindow) {
+        artwork += albumGridWindow->memoryUsage();
+    }
+    memoryMonitor->report(MemoryMonitor::Artwork, artwork);
+
+    // Le lecteur multimédia garde ses tampons dans son backend ; comptés ici l'anneau
+    // du visualiseur et le tampon de sortie des WAV lus directement
+    memoryMonitor->report(MemoryMonitor::AudioBuffers, spectrumAnalyzer->memoryUsage() + wavPlayer->memoryUsage());
+
+    enforceMemoryBudgets();
+}
+
+void QticallyMainWindow::enforceMemoryBudgets()
+{
+    // Pochettes : seules celles relues depuis un fichier peuvent être évincées
+    const qint64 artworkBudget = memoryMonitor->budget(MemoryMonitor::Artwork);
+    const qint64 gridBytes = albumGridWindow ? albumGridWindow->memoryUsage() : 0;
+    if (artworkBudget > 0) {
+        // La grille et le cache des pochettes se partagent ce qui reste
+        const qint64 pinned = memoryMonitor->bytes(MemoryMonitor::Artwork) - qint64(coverCache.totalCost()) * 1024 - gridBytes;
+        const qint64 evictable = qMax<qint64>(artworkBudget - pinned, 0);
+        const qint64 gridShare = albumGridWindow ? evictable / 2 : 0;
+        coverCache.setMaxCost(int((evictable - gridShare) / 1024));
+        if (albumGridWindow) {
+            albumGridWindow->setCacheLimit(gridShare);
+        }
+    } else {
+        coverCache.setMaxCost(std::numeric_limits<int>::max());
+    }
+
+    // Clés de tri : celles des colonnes non triées sont recalculées à la demande
+    if (memoryMonitor->overBudget(MemoryMonitor::Search)) {
+        trackStore->releaseSortKeys(trackModel->currentSortColumn());
+        memoryMonitor->report(MemoryMonitor::Search, trackStore->memoryUsage().sortKeys + trackModel->memoryUsage());
+    }
+}
+
+void QticallyMainWindow::refreshPlaylistSelector()
+{
+    // Rôle utilisateur : liste intelligente ; rôle suivant : liste de lecture
+    playlistSelector->blockSignals(true);
+    playlistSelector->clear();
+    playlistSelector->addItem("Bibliothèque", -1);
+    playlistSelector->setItemData(0, -1, Qt::UserRole + 1);
+    for (int i = 0; i < smartPlaylists->count(); ++i) {
+        playlistSelector->addItem(smartPlaylists->name(i), i);
+        playlistSelector->setItemData(playlistSelector->count() - 1, -1, Qt::UserRole + 1);
+    }
+    for (int i = 0; i < playlists.count(); ++i) {
+        playlistSelector->addItem(playlists.name(i), -1);
+        playlistSelector->setItemData(playlistSelector->count() - 1, i, Qt::UserRole + 1);
+    }
+
+    int current = 0;
+    if (currentSmartPlaylist >= 0) {
+        current = playlistSelector->findData(currentSmartPlaylist);
+    } else if (currentPlaylist >= 0) {
+        current = playlistSelector->findData(currentPlaylist, Qt::UserRole + 1);
+    }
+    playlistSelector->setCurrentIndex(qMax(0, current));
+    playlistSelector->blockSignals(false);
+}
+
+void QticallyMainWindow::showCurrentView()
+{
+    // Le vecteur de la liste est partagé avec le modèle : aucun recopiage
+    if (currentPlaylist >= 0) {
+        trackModel->setTracks(playlists.tracks(currentPlaylist));
+    } else if (currentSmartPlaylist >= 0) {
+        trackModel->setTracks(smartPlaylists->open(currentSmartPlaylist));
+    } else {
+        trackModel->resetTracks();
+    }
+    updateLibraryStatus();
+}
+
+void QticallyMainWindow::selectPlaylist(int index)
+{
+    currentSmartPlaylist = playlistSelector->itemData(index).toInt();
+    currentPlaylist = playlistSelector->itemData(index, Qt::UserRole + 1).toInt();
+    showCurrentView();
+}
+
+void QticallyMainWindow::libraryTracksAdded(const QVector<int> &tracks)
+{
+    if (currentSmartPlaylist < 0 && currentPlaylist < 0) {
+        trackModel->insertTracks(tracks);
+    }
+    applySmartChanges(smartPlaylists->tracksAdded(tracks));
+}
+
+void QticallyMainWindow::libraryTracksChanged(const QVector<int> &tracks, int column)
+{
+    applySmartChanges(smartPlaylists->tracksChanged(tracks, column));
+}
+
+void QticallyMainWindow::applySmartChanges(const QVector<SmartPlaylists::Change> &changes)
+{
+    // Seule la liste affichée touche au modèle
+    bool shownChanged = false;
+    for (const SmartPlaylists::Change &change : changes) {
+        if (change.playlist != currentSmartPlaylist) {
+            continue;
+        }
+        trackModel->insertTracks(change.added);
+        for (int track : change.removed) {
+            trackModel->removeTrack(track);
+        }
+        shownChanged = true;
+    }
+    if (shownChanged) {
+        updateLibraryStatus();
+    }
+}
+
+void QticallyMainWindow::newSmartPlaylist()
+{
+    bool ok = false;
+    QString name = QInputDialog::getText(this, "Nouvelle liste intelligente", "Nom :", QLineEdit::Normal, QString(), &ok).trimmed();
+    if (!ok || name.isEmpty()) {
+        return;
+    }
+    if (smartPlaylists->indexOf(name) >= 0) {
+        QMessageBox::warning(this, "Erreur", "Une liste porte déjà ce nom.");
+        return;
+    }
+
+    QString rule = QInputDialog::getText(this, "Nouvelle liste intelligente",
+                                         "Règle (ex. added>30d, plays:0, duration>8:00, path:/nas/live) :",
+                                         QLineEdit::Normal, QString(), &ok).trimmed();
+    if (!ok || rule.isEmpty()) {
+        return;
+    }
+
+    currentSmartPlaylist = smartPlaylists->add(name, rule);
+    currentPlaylist = -1;
+    journalRecord(Journal::setSmartPlaylist(name, rule));
+    refreshPlaylistSelector();
+    showCurrentView();
+}
+
+void QticallyMainWindow::editSmartPlaylist()
+{
+    if (currentSmartPlaylist < 0) {
+        return;
+    }
+
+    bool ok = false;
+    QString rule = QInputDialog::getText(this, smartPlaylists->name(currentSmartPlaylist), "Règle :",
+                                         QLineEdit::Normal, smartPlaylists->rule(currentSmartPlaylist), &ok).trimmed();
+    if (!ok || rule.isEmpty()) {
+        return;
+    }
+
+    smartPlaylists->setRule(currentSmartPlaylist, rule);
+    journalRecord(Journal::setSmartPlaylist(smartPlaylists->name(currentSmartPlaylist), rule));
+    showCurrentView();
+}
+
+void QticallyMainWindow::removePlaylist()
+{
+    if (currentSmartPlaylist >= 0) {
+        journalRecord(Journal::removeSmartPlaylist(smartPlaylists->name(currentSmartPlaylist)));
+        smartPlaylists->remove(currentSmartPlaylist);
+        currentSmartPlaylist = -1;
+    } else if (currentPlaylist >= 0) {
+        playlists.remove(currentPlaylist);
+        playlistsChanged();
+        currentPlaylist = -1;
+    } else {
+        return;
+    }
+    refreshPlaylistSelector();
+    showCurrentView();
+}
+
+void QticallyMainWindow::newPlaylist()
+{
+    bool ok = false;
+    QString name = QInputDialog::getText(this, "Nouvelle liste", "Nom :", QLineEdit::Normal, QString(), &ok).trimmed();
+    if (!ok || name.isEmpty()) {
+        return;
+    }
+
+    currentPlaylist = playlists.create(uniquePlaylistName(name));
+    currentSmartPlaylist = -1;
+    playlistsChanged();
+    refreshPlaylistSelector();
+    showCurrentView();
+}
+
+void QticallyMainWindow::duplicatePlaylist()
+{
+    if (currentPlaylist < 0) {
+        return;
+    }
+
+    bool ok = false;
+    QString name = QInputDialog::getText(this, "Dupliquer la liste", "Nom :", QLineEdit::Normal,
+                                         playlists.name(currentPlaylist) + " (copie)", &ok).trimmed();
+    if (!ok || name.isEmpty()) {
+        return;
+    }
+
+    currentPlaylist = playlists.duplicate(currentPlaylist, uniquePlaylistName(name));
+    playlistsChanged();
+    refreshPlaylistSelector();
+    showCurrentView();
+}
+
+void QticallyMainWindow::renamePlaylist()
+{
+    if (currentPlaylist < 0) {
+        return;
+    }
+
+    bool ok = false;
+    QString name = QInputDialog::getText(this, "Renommer la liste", "Nom :", QLineEdit::Normal,
+                                         playlists.name(currentPlaylist), &ok).trimmed();
+    if (!ok || name.isEmpty() || name == playlists.name(currentPlaylist)) {
+        return;
+    }
+
+    playlists.rename(currentPlaylist, uniquePlaylistName(name));
+    playlistsChanged();
+    refreshPlaylistSelector();
+}
+
+void QticallyMainWindow::addToPlaylist()
+{
+    const int track = currentTrack();
+    if (track < 0) {
+        return;
+    }
+
+    QStringList names;
+    for (int i = 0; i < playlists.count(); ++i) {
+        names.append(playlists.name(i));
+    }
+    if (names.isEmpty()) {
+        QMessageBox::information(this, "Listes", "Créez d'abord une liste depuis le menu Listes.");
+        return;
+    }
+
+    bool ok = false;
+    const QString name = QInputDialog::getItem(this, "Ajouter à une liste", "Liste :", names, 0, false, &ok);
+    const int index = playlists.indexOf(name);
+    if (!ok || index < 0) {
+        return;
+    }
+
+    playlists.append(index, QVector<int>() << track);
+    playlistsChanged();
+    if (index == currentPlaylist) {
+        trackModel->insertTracks(QVector<int>() << track);
+    }
+}
+
+void QticallyMainWindow::removeFromPlaylist()
+{
+    const int track = currentTrack();
+    if (currentPlaylist < 0 || track < 0) {
+        return;
+    }
+
+    playlists.removeAt(currentPlaylist, playlists.tracks(currentPlaylist).indexOf(track));
+    playlistsChanged();
+    trackModel->removeTrack(track);
+}
+
+void QticallyMainWindow::moveTrackUp()
+{
+    moveSelectedTrack(-1);
+}
+
+void QticallyMainWindow::moveTrackDown()
+{
+    moveSelectedTrack(1);
+}
+
+void QticallyMainWindow::moveSelectedTrack(int offset)
+{
+    const int row = musicList->currentIndex().row();
+    if (currentPlaylist < 0 || row < 0) {
+        return;
+    }
+
+    // Les lignes ne suivent l'ordre de la liste que sans tri ni recherche
+    if (trackModel->currentSortColumn() >= 0 || !searchBar->text().trimmed().isEmpty()) {
+        ui->statusbar->showMessage("Retirez le tri et la recherche pour réorganiser la liste.", 3000);
+        return;
+    }
+
+    const int target = row + offset;
+    if (target < 0 || target >= playlists.tracks(currentPlaylist).size()) {
+        return;
+    }
+    playlists.move(currentPlaylist, row, target);
+    playlistsChanged();
+    trackModel->setTracks(playlists.tracks(currentPlaylist));
+    setCurrentRow(target);
+}
+
+void QticallyMainWindow::playlistsChanged()
+{
+    if (!restoringJournal) {
+        playlistSaveTimer->start();
+    }
+    if (currentPlaylist >= 0) {
+        updateLibraryStatus();
+    }
+}
+
+void QticallyMainWindow::savePlaylists()
+{
+    playlistSaveTimer->stop();
+    if (!playlists.save(playlistsFileName, trackStore)) {
+        qWarning() << "Impossible d'enregistrer les listes :" << playlistsFileName;
+    }
+}
+
+QString QticallyMainWindow::uniquePlaylistName(const QString &name) const
+{
+    QString base = name.isEmpty() ? QString("Liste") : name;
+    QString unique = base;
+    for (int i = 2; playlists.indexOf(unique) >= 0 || smartPlaylists->indexOf(unique) >= 0; ++i) {
+        unique = base + " (" + QString::number(i) + ")";
+    }
+    return unique;
+}
@@ -5,9 +5,33 @@
 #include <QMediaPlayer>
 #include <QFileDialog>
 #include <QFileDialog>
-#include <QListWidget>
+#include <QTreeView>
 #include <QLabel>
 #include <QSystemTrayIcon>
+#include <QTimer>
+#include <QCache>
+#include "journal.h"
+#include "trackstore.h"
+#include "trackmodel.h"
+#include "tagreader.h"
+#include "durationprober.h"
+#include "memorymonitor.h"
+#include "smartplaylists.h"
+#include "playlists.h"
+#include "playhistory.h"
+#include "prefetcher.h"
+#include "spectrumanalyzer.h"
+#include "spectrumwidget.h"
+#include "healthchecker.h"
+#include "albumgridwindow.h"
+#include "cuesheet.h"
+#include "wavplayer.h"
+#include "taskscheduler.h"
+#include <QComboBox>
+#include <QImage>
+#include <QFileInfo>
+#include <QSet>
+#include <QElapsedTimer>
 
 QT_BEGIN_NAMESPACE
 namespace Ui { class QticallyMainWindow; }
@@ -24,13 +48,15 @@ public :
 public slots :
     void addMusic();
     void playSelectedMusic();
-    void updateMusicName(const QString &oldName, const QString &newName);
+    void updateMusicName(int track, const QString &oldName, const QString &newName);
     void updateMusicImage(const QString &musicName, const QPixmap &newImage);
     void deleteSelectedMusic();
     void loadState(const QString &filename);
     void saveState(const QString &filename);
     void save();
     void open();
+    void showMemoryDialog();
+    void openArguments(const QStringList &arguments);
 
 
 
@@ -38,7 +64,11 @@ public slots :
 private:
     Ui::QticallyMainWindow *ui;
     QMediaPlayer *player;
-    QListWidget *musicList;
+    WavPlayer *wavPlayer;
+    bool directWav;
+    QTreeView *musicList;
+    TrackStore *trackStore;
+    TrackModel *trackModel;
     QSlider *musicSlider;
     QLabel *musicImageLabel;
     QLabel *timeElapsedLabel;
@@ -48,9 +78,17 @@ private:
     bool repeatEnabled;
     bool shuffleEnabled;
     QLabel *musicNameLabel;
-    QMap<QString, QString> musicMap;
-    QMap<QString, QPixmap> musicImageMap;
+    SmartPlaylists *smartPlaylists;
+    QComboBox *playlistSelector;
+    int currentSmartPlaylist;
+    Playlists playlists;
+    int currentPlaylist;
+    QString playlistsFileName;
+    QTimer *playlistSaveTimer;
     QMap<QString, QPixmap> customMusicImageMap;
+    QMap<QString, QString> customMusicImagePaths;
+    QCache<QString, QPixmap> coverCache;
+    TaskScheduler::Group coverTasks;
     QString selectedMusicName;
     QPixmap selectedMusicImage;
     int prevIndex;
@@ -60,6 +98,101 @@ private:
     QPixmap defaultImage;
     QLineEdit *searchBar;
     QSystemTrayIcon *trayIcon;
+    Journal *journal;
+    bool restoringJournal;
+    qint64 probedDuration;
+    DurationProber *durationProber;
+    QVector<int> probedTracks;
+    QTimer *durationFlushTimer;
+    QLabel *libraryStatusLabel;
+    PlayHistory *playHistory;
+    int playingTrack;
+    QString openedMedia;
+    qint64 segmentStartMs;
+    qint64 segmentEndMs;
+    qint64 pendingSeek;
+    qint64 loopStartMs;     // boucle A-B, positions dans le fichier ; -1 sans point
+    qint64 loopEndMs;
+    Prefetcher *prefetcher;
+    int nextShuffleTrack;
+    SpectrumAnalyzer *spectrumAnalyzer;
+    SpectrumWidget *spectrumWidget;
+    HealthChecker *healthChecker;
+    AlbumGridWindow *albumGridWindow;
+    QSet<int> missingTracks;
+    QSet<int> unreachableTracks;
+    QString healthStatus;
+    MemoryMonitor *memoryMonitor;
+    QTimer *memoryTimer;
+    bool backgroundMode;
+    bool coverPending;
+    QElapsedTimer backgroundTimer;
+    qint64 backgroundCpuMs;
+    qint64 backgroundWakeups;
+    int positionEvents;
+    QTimer *notificationTimer;
+    QString pendingNotification;
+
+    TaskScheduler::Group tagTasks;
+    QVector<int> tagScanTracks;
+    QVector<int> pendingTagScan;
+    int tagBatchesPending;
+
+    void restoreFromJournal();
+    void journalRecord(const Journal::Record &record);
+    int currentTrack() const;
+    void setCurrentRow(int row);
+    void scanTags(const QVector<int> &tracks);
+    void tagScanFinished();
+    void analyzeTracks(const QVector<int> &tracks);
+    void updateLibraryStatus();
+    void loadCover(const QString &musicName);
+    void cacheCover(const QString &musicName, const QPixmap &cover);
+    void enforceMemoryBudgets();
+    void refreshPlaylistSelector();
+    void showCurrentView();
+    void libraryTracksAdded(const QVector<int> &tracks);
+    void libraryTracksChanged(const QVector<int> &tracks, int column);
+    void applySmartChanges(const QVector<SmartPlaylists::Change> &changes);
+    void playlistsChanged();
+    QString uniquePlaylistName(const QString &name) const;
+    void moveSelectedTrack(int offset);
+    QVector<int> ingestFile(const QFileInfo &fileInfo, qint64 dateAdded, QVector<int> *newTracks);
+    QVector<int> ingestCueSheet(const QString &cuePath, qint64 dateAdded, QVector<int> *newTracks);
+    void applyCueTrack(int track, const CueSheet &sheet, const CueSheet::Track &cueTrack,
+                       QVector<int> *openEnded);
+    void probeSegmentEnds(const QVector<int> &tracks);
+    void resolveSegments(const QVector<int> &tracks);
+    void removeLibraryTracks(const QVector<int> &tracks);
+    void clearNowPlaying();
+    QString currentFolder() const;
+    qint64 trackPosition() const;
+    qint64 trackLength() const;
+    void seekTrack(qint64 position);
+    void openMedia(const QString &path);
+    qint64 playerPosition() const;
+    qint64 playerDuration() const;
+    void setPlayerPosition(qint64 position);
+    QMediaPlayer::MediaStatus playerStatus() const;
+    void playerPlay();
+    void playerPause();
+    void playerStop();
+    void applyNotifyInterval();
+    bool repeatsTrack() const;
+    void recordRepeat();
+    void restartTrack();
+    void applyLoop();
+    void setLoopStart(qint64 position);
+    void setLoopEnd(qint64 position);
+    void markLoopPoint();
+    void notifyNowPlaying(const QString &musicName);
+    void importPlaylistFile(const QString &fileName);
+    void endPlayback(PlayHistory::EventType type);
+    void applyPlayCounts(const QVector<int> &tracks);
+    int shuffleRow() const;
+    int takeShuffleRow();
+    void prefetchCandidates();
+    QStringList watchRoots() const;
 
 
 
@@ -81,12 +214,49 @@ private slots:
     void sliderPressed();
     void filterMusicList();
     void iconActivated(QSystemTrayIcon::ActivationReason reason);
+    void tagsRead(const QVector<int> &tracks, const QVector<TagReader::Tags> &tags);
+    void durationsReady(const QVector<int> &tracks, const QVector<qint64> &durations);
+    void flushProbedDurations();
+    void coverDecoded(const QString &musicName, const QImage &image);
+    void sampleMemory();
+    void selectPlaylist(int index);
+    void newSmartPlaylist();
+    void editSmartPlaylist();
+    void removePlaylist();
+    void newPlaylist();
+    void duplicatePlaylist();
+    void renamePlaylist();
+    void addToPlaylist();
+    void removeFromPlaylist();
+    void moveTrackUp();
+    void moveTrackDown();
+    void savePlaylists();
+    void showListeningStats();
+    void showAlbumGrid();
+    void showAlbumGroup(const QString &query);
+    void showPrefetchStats();
+    void showSchedulerStats();
+    void setVisualizerEnabled(bool enabled);
+    void checkLibraryHealth();
+    void addWatchRoot();
+    void removeFolder();
+    void relinkFolder();
+    void healthProgress(int done, int total);
+    void healthCheckFinished(const HealthChecker::Result &result);
+    void checkSegmentEnd(qint64 position);
+    void clearLoop();
+    void showSliderMenu(const QPoint &pos);
+    void updateBackgroundMode();
+    void showPendingNotification();
 
 
 
 
 protected:
     bool eventFilter(QObject *obj, QEvent *event) override;
+    void changeEvent(QEvent *event) override;
+    void showEvent(QShowEvent *event) override;
+    void hideEvent(QHideEvent *event) override;
 
 };
 
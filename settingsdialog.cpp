@@ -1,11 +1,13 @@
 #include "settingsdialog.h"
 #include "ui_settingsdialog.h"
+#include "coverloader.h"
 #include <QFileDialog>
 #include <QMessageBox>
 
 SettingsDialog::SettingsDialog(QString musicName, QPixmap image, QWidget *parent)
     : QDialog(parent)
     , ui(new Ui::SettingsDialog)
+    , coverPending(false)
 {
     ui->setupUi(this);
 
@@ -22,6 +24,9 @@ SettingsDialog::SettingsDialog(QString musicName, QPixmap image, QWidget *parent
 
 SettingsDialog::~SettingsDialog()
 {
+    // Décodages encore attendus : abandonnés, ceux en cours terminés avant la destruction
+    decodeTasks.cancel();
+    decodeTasks.wait();
     delete ui;
 }
 
@@ -35,22 +40,59 @@ QPixmap SettingsDialog::getImage() const
     return currentImage;
 }
 
+QString SettingsDialog::getImagePath() const
+{
+    return currentImagePath;
+}
+
 void SettingsDialog::changeImage()
 {
     QString imagePath = QFileDialog::getOpenFileName(this, tr("Choose Image"), "", tr("Image Files (*.png *.jpg *.jpeg *.bmp)"));
 
     if (!imagePath.isEmpty()) {
-        if (!imagePath.isEmpty()) {
-            QPixmap pixmap(imagePath);
-            if (!pixmap.isNull()) {
-                currentImage = pixmap;
-                musicImageLabel->setPixmap(pixmap.scaled(musicImageLabel->size(), Qt::KeepAspectRatio, Qt::SmoothTransformation));
-            } else {
-                QMessageBox::warning(this, "Error", "Failed to load the image.");
-            }
-
-        } else {
-            currentImage = QPixmap();
-        }
+        pendingImagePath = imagePath;
+        coverPending = true;
+        ui->buttonBox->button(QDialogButtonBox::Ok)->setEnabled(false);
+
+        // Décodage de la pochette hors du thread graphique, en file interactive comme
+        // celles de la fenêtre : un aperçu minuscule d'abord, puis l'image à la taille d'affichage
+        decodeTasks.cancel();
+        TaskScheduler *scheduler = TaskScheduler::instance();
+        scheduler->run(TaskScheduler::Cpu, TaskScheduler::Interactive, decodeTasks, [this, imagePath]() {
+            const QImage preview = CoverLoader::decode(imagePath, CoverLoader::previewSize());
+            QMetaObject::invokeMethod(this, "previewDecoded", Qt::QueuedConnection,
+                                      Q_ARG(QString, imagePath), Q_ARG(QImage, preview));
+        });
+        scheduler->run(TaskScheduler::Cpu, TaskScheduler::Interactive, decodeTasks, [this, imagePath]() {
+            const QImage image = CoverLoader::decode(imagePath, CoverLoader::coverSize());
+            QMetaObject::invokeMethod(this, "coverDecoded", Qt::QueuedConnection,
+                                      Q_ARG(QString, imagePath), Q_ARG(QImage, image));
+        });
+    }
+}
+
+void SettingsDialog::previewDecoded(const QString &imagePath, const QImage &preview)
+{
+    // Aperçu d'une image déjà remplacée, ou arrivé après l'image complète : ignoré
+    if (!preview.isNull() && coverPending && imagePath == pendingImagePath) {
+        musicImageLabel->setPixmap(QPixmap::fromImage(preview).scaled(musicImageLabel->size(), Qt::KeepAspectRatio, Qt::FastTransformation));
+    }
+}
+
+void SettingsDialog::coverDecoded(const QString &imagePath, const QImage &image)
+{
+    if (imagePath != pendingImagePath) {
+        return;
+    }
+    coverPending = false;
+    ui->buttonBox->button(QDialogButtonBox::Ok)->setEnabled(true);
+
+    if (!image.isNull()) {
+        currentImage = QPixmap::fromImage(image);
+        currentImagePath = pendingImagePath;
+        musicImageLabel->setPixmap(currentImage.scaled(musicImageLabel->size(), Qt::KeepAspectRatio, Qt::SmoothTransformation));
+    } else {
+        musicImageLabel->setPixmap(currentImage);
+        QMessageBox::warning(this, "Error", "Failed to load the image.");
     }
 }
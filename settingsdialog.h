@@ -5,6 +5,8 @@
 #include <QLineEdit>
 #include <QLabel>
 #include <QPushButton>
+#include <QImage>
+#include "taskscheduler.h"
 
 namespace Ui {
 class SettingsDialog;
@@ -20,9 +22,12 @@ public:
 
     QString getMusicName() const;
     QPixmap getImage() const;
+    QString getImagePath() const;
 
 private slots:
     void changeImage();
+    void previewDecoded(const QString &imagePath, const QImage &preview);
+    void coverDecoded(const QString &imagePath, const QImage &image);
 
 private:
     Ui::SettingsDialog *ui;
@@ -30,6 +35,10 @@ private:
     QLabel *musicImageLabel;
     QPushButton *changeImageButton;
     QPixmap currentImage;
+    QString currentImagePath;
+    QString pendingImagePath;
+    bool coverPending;
+    TaskScheduler::Group decodeTasks;
 };
 
 #endif // SETTINGSDIALOG_H
@@ -0,0 +1,98 @@
+#include "singleinstance.h"
+#include <QLocalServer>
+#include <QLocalSocket>
+#include <QDataStream>
+#include <QCryptographicHash>
+#include <QDir>
+#include <QFileInfo>
+
+namespace {
+
+// Délai court : une instance principale locale répond en quelques millisecondes
+const int connectTimeoutMs = 200;
+const int writeTimeoutMs = 1000;
+
+}
+
+const QString SingleInstance::playPauseCommand("--play-pause");
+const QString SingleInstance::nextCommand("--next");
+const QString SingleInstance::previousCommand("--previous");
+
+SingleInstance::SingleInstance(QObject *parent)
+    : QObject(parent)
+    , server(nullptr)
+{
+    // Nom propre à l'utilisateur : deux sessions ne se partagent pas le lecteur
+    const QByteArray home = QCryptographicHash::hash(QDir::homePath().toUtf8(), QCryptographicHash::Md5).toHex();
+    serverName = "Qtically-" + QString::fromLatin1(home.left(12));
+}
+
+bool SingleInstance::forward(const QStringList &arguments)
+{
+    QLocalSocket socket;
+    socket.connectToServer(serverName);
+    if (!socket.waitForConnected(connectTimeoutMs)) {
+        return false;
+    }
+
+    QDataStream out(&socket);
+    out << arguments;
+    socket.flush();
+    while (socket.bytesToWrite() > 0) {
+        if (!socket.waitForBytesWritten(writeTimeoutMs)) {
+            return false;
+        }
+    }
+    socket.disconnectFromServer();
+    return true;
+}
+
+bool SingleInstance::listen()
+{
+    server = new QLocalServer(this);
+    server->setSocketOptions(QLocalServer::UserAccessOption);
+    connect(server, &QLocalServer::newConnection, this, &SingleInstance::newConnection);
+
+    if (server->listen(serverName)) {
+        return true;
+    }
+
+    // Soit une autre instance vient de démarrer, soit une socket est restée après un plantage
+    QLocalSocket probe;
+    probe.connectToServer(serverName);
+    if (probe.waitForConnected(connectTimeoutMs)) {
+        return false;
+    }
+    QLocalServer::removeServer(serverName);
+    return server->listen(serverName);
+}
+
+QStringList SingleInstance::normalizedArguments(const QStringList &arguments)
+{
+    // Les chemins relatifs dépendent du dossier du lanceur, pas de celui de l'instance principale
+    QStringList result;
+    for (const QString &argument : arguments) {
+        if (argument.startsWith("--")) {
+            result.append(argument);
+        } else {
+            result.append(QFileInfo(argument).absoluteFilePath());
+        }
+    }
+    return result;
+}
+
+void SingleInstance::newConnection()
+{
+    while (QLocalSocket *socket = server->nextPendingConnection()) {
+        connect(socket, &QLocalSocket::disconnected, socket, &QLocalSocket::deleteLater);
+        connect(socket, &QLocalSocket::readyRead, this, [this, socket]() {
+            QDataStream in(socket);
+            in.startTransaction();
+            QStringList arguments;
+            in >> arguments;
+            if (in.commitTransaction()) {
+                emit argumentsReceived(arguments);
+            }
+        });
+    }
+}
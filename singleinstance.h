@@ -0,0 +1,40 @@
+#ifndef SINGLEINSTANCE_H
+#define SINGLEINSTANCE_H
+
+#include <QObject>
+#include <QStringList>
+
+class QLocalServer;
+
+// Une seule fenêtre par utilisateur : les lancements suivants transmettent
+// leurs arguments à l'instance principale par un QLocalSocket puis s'arrêtent.
+class SingleInstance : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit SingleInstance(QObject *parent = nullptr);
+
+    // Vrai si une instance principale a reçu les arguments
+    bool forward(const QStringList &arguments);
+    // Devient l'instance principale ; faux si une autre l'est devenue entre-temps
+    bool listen();
+
+    static QStringList normalizedArguments(const QStringList &arguments);
+
+    static const QString playPauseCommand;
+    static const QString nextCommand;
+    static const QString previousCommand;
+
+signals:
+    void argumentsReceived(const QStringList &arguments);
+
+private slots:
+    void newConnection();
+
+private:
+    QString serverName;
+    QLocalServer *server;
+};
+
+#endif // SINGLEINSTANCE_H
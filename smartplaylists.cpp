@@ -0,0 +1,244 @@
+#include "smartplaylists.h"
+#include "trackstore.h"
+#include <QDateTime>
+
+namespace {
+
+// Délai après lequel une règle à date relative est recalculée à l'ouverture
+const qint64 relativeRefreshMs = 60 * 1000;
+
+}
+
+SmartPlaylists::SmartPlaylists(const TrackStore *store)
+    : store(store)
+{
+}
+
+int SmartPlaylists::count() const
+{
+    return playlists.size();
+}
+
+int SmartPlaylists::indexOf(const QString &name) const
+{
+    for (int i = 0; i < playlists.size(); ++i) {
+        if (playlists.at(i).name == name) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+QString SmartPlaylists::name(int index) const
+{
+    return playlists.value(index).name;
+}
+
+QString SmartPlaylists::rule(int index) const
+{
+    return playlists.value(index).query.text();
+}
+
+int SmartPlaylists::memberCount(int index) const
+{
+    return playlists.value(index).memberCount;
+}
+
+int SmartPlaylists::add(const QString &name, const QString &rule)
+{
+    int index = indexOf(name);
+    if (index < 0) {
+        Playlist playlist;
+        playlist.name = name;
+        playlists.append(playlist);
+        index = playlists.size() - 1;
+    }
+    setRule(index, rule);
+    return index;
+}
+
+int SmartPlaylists::restore(const QString &name, const QString &rule, const QVector<int> &members)
+{
+    int index = indexOf(name);
+    if (index < 0) {
+        Playlist playlist;
+        playlist.name = name;
+        playlists.append(playlist);
+        index = playlists.size() - 1;
+    }
+
+    Playlist &playlist = playlists[index];
+    playlist.query = TrackQuery(rule);
+    playlist.members = QBitArray(store->capacity());
+    playlist.memberCount = 0;
+    for (int id : members) {
+        if (store->contains(id) && !playlist.members.testBit(id)) {
+            playlist.members.setBit(id);
+            ++playlist.memberCount;
+        }
+    }
+    playlist.evaluatedAt = QDateTime::currentMSecsSinceEpoch();
+    return index;
+}
+
+void SmartPlaylists::setRule(int index, const QString &rule)
+{
+    if (index < 0 || index >= playlists.size()) {
+        return;
+    }
+    playlists[index].query = TrackQuery(rule);
+    evaluateAll(index);
+}
+
+void SmartPlaylists::remove(int index)
+{
+    if (index >= 0 && index < playlists.size()) {
+        playlists.remove(index);
+    }
+}
+
+void SmartPlaylists::clear()
+{
+    for (Playlist &playlist : playlists) {
+        playlist.members = QBitArray();
+        playlist.memberCount = 0;
+    }
+}
+
+QVector<int> SmartPlaylists::open(int index)
+{
+    if (index < 0 || index >= playlists.size()) {
+        return QVector<int>();
+    }
+
+    Playlist &playlist = playlists[index];
+    if (playlist.query.isRelative()
+            && QDateTime::currentMSecsSinceEpoch() - playlist.evaluatedAt > relativeRefreshMs) {
+        playlist.query = TrackQuery(playlist.query.text());
+        evaluateAll(index);
+    }
+    return members(index);
+}
+
+QVector<int> SmartPlaylists::members(int index) const
+{
+    QVector<int> result;
+    if (index < 0 || index >= playlists.size()) {
+        return result;
+    }
+
+    const Playlist &playlist = playlists.at(index);
+    result.reserve(playlist.memberCount);
+    for (int id = 0; id < playlist.members.size(); ++id) {
+        if (playlist.members.testBit(id)) {
+            result.append(id);
+        }
+    }
+    return result;
+}
+
+bool SmartPlaylists::contains(int index, int trackId) const
+{
+    if (index < 0 || index >= playlists.size()) {
+        return false;
+    }
+    const QBitArray &members = playlists.at(index).members;
+    return trackId >= 0 && trackId < members.size() && members.testBit(trackId);
+}
+
+QVector<SmartPlaylists::Change> SmartPlaylists::tracksAdded(const QVector<int> &ids)
+{
+    QVector<Change> changes;
+    if (ids.isEmpty()) {
+        return changes;
+    }
+    for (int i = 0; i < playlists.size(); ++i) {
+        Change change;
+        evaluate(i, ids, &change);
+        if (!change.added.isEmpty()) {
+            changes.append(change);
+        }
+    }
+    return changes;
+}
+
+QVector<SmartPlaylists::Change> SmartPlaylists::tracksChanged(const QVector<int> &ids, int column)
+{
+    // Une règle qui ne lit pas la colonne modifiée ne peut pas changer
+    QVector<Change> changes;
+    if (ids.isEmpty()) {
+        return changes;
+    }
+    for (int i = 0; i < playlists.size(); ++i) {
+        if (!playlists.at(i).query.dependsOn(column)) {
+            continue;
+        }
+        Change change;
+        evaluate(i, ids, &change);
+        if (!change.added.isEmpty() || !change.removed.isEmpty()) {
+            changes.append(change);
+        }
+    }
+    return changes;
+}
+
+QVector<SmartPlaylists::Change> SmartPlaylists::tracksRemoved(const QVector<int> &ids)
+{
+    QVector<Change> changes;
+    for (int i = 0; i < playlists.size(); ++i) {
+        Playlist &playlist = playlists[i];
+        Change change;
+        change.playlist = i;
+        for (int id : ids) {
+            if (id >= 0 && id < playlist.members.size() && playlist.members.testBit(id)) {
+                playlist.members.clearBit(id);
+                --playlist.memberCount;
+                change.removed.append(id);
+            }
+        }
+        if (!change.removed.isEmpty()) {
+            changes.append(change);
+        }
+    }
+    return changes;
+}
+
+void SmartPlaylists::evaluate(int index, const QVector<int> &ids, Change *change)
+{
+    Playlist &playlist = playlists[index];
+    if (playlist.members.size() < store->capacity()) {
+        playlist.members.resize(store->capacity());
+    }
+    change->playlist = index;
+
+    // Les deux listes sont dans le même ordre : un seul parcours suffit
+    const QVector<int> matching = playlist.query.matching(store, ids);
+    int next = 0;
+    for (int id : ids) {
+        const bool member = next < matching.size() && matching.at(next) == id;
+        if (member) {
+            ++next;
+        }
+        if (!store->contains(id) || member == playlist.members.testBit(id)) {
+            continue;
+        }
+        playlist.members.setBit(id, member);
+        if (member) {
+            ++playlist.memberCount;
+            change->added.append(id);
+        } else {
+            --playlist.memberCount;
+            change->removed.append(id);
+        }
+    }
+}
+
+void SmartPlaylists::evaluateAll(int index)
+{
+    Playlist &playlist = playlists[index];
+    playlist.members = QBitArray(store->capacity());
+    playlist.memberCount = 0;
+    Change change;
+    evaluate(index, store->ids(), &change);
+    playlist.evaluatedAt = QDateTime::currentMSecsSinceEpoch();
+}
@@ -0,0 +1,65 @@
+#ifndef SMARTPLAYLISTS_H
+#define SMARTPLAYLISTS_H
+
+#include <QString>
+#include <QVector>
+#include <QBitArray>
+#include "trackquery.h"
+
+class TrackStore;
+
+// Listes intelligentes : une règle écrite avec la syntaxe de recherche
+// (par exemple "added>30d" ou "plays:0 duration>8:00"). L'appartenance est
+// gardée dans un tableau de bits par liste et mise à jour pièce par pièce :
+// seules les pistes ajoutées, modifiées ou supprimées sont réévaluées.
+class SmartPlaylists
+{
+public:
+    struct Change {
+        int playlist = -1;
+        QVector<int> added;
+        QVector<int> removed;
+    };
+
+    explicit SmartPlaylists(const TrackStore *store);
+
+    int count() const;
+    int indexOf(const QString &name) const;
+    QString name(int index) const;
+    QString rule(int index) const;
+    int memberCount(int index) const;
+
+    int add(const QString &name, const QString &rule);
+    // Appartenance déjà connue (sauvegarde) : aucune réévaluation
+    int restore(const QString &name, const QString &rule, const QVector<int> &members);
+    void setRule(int index, const QString &rule);
+    void remove(int index);
+    void clear();
+
+    // Membres par identifiant croissant ; une règle à date relative
+    // est réévaluée si elle n'a pas servi depuis un moment.
+    QVector<int> open(int index);
+    QVector<int> members(int index) const;
+    bool contains(int index, int trackId) const;
+
+    QVector<Change> tracksAdded(const QVector<int> &ids);
+    QVector<Change> tracksChanged(const QVector<int> &ids, int column);
+    QVector<Change> tracksRemoved(const QVector<int> &ids);
+
+private:
+    struct Playlist {
+        QString name;
+        TrackQuery query;
+        QBitArray members;
+        int memberCount = 0;
+        qint64 evaluatedAt = 0;
+    };
+
+    void evaluate(int index, const QVector<int> &ids, Change *change);
+    void evaluateAll(int index);
+
+    const TrackStore *store;
+    QVector<Playlist> playlists;
+};
+
+#endif // SMARTPLAYLISTS_H
@@ -0,0 +1,279 @@
+#include "spectrumanalyzer.h"
+#include "wavplayer.h"
+#include <QMediaPlayer>
+#include <QAudioProbe>
+#include <QAudioBuffer>
+#include <QElapsedTimer>
+#include <QMutexLocker>
+#include <cmath>
+
+namespace {
+
+const int fftSize = 2048;
+const int fftBits = 11;
+// Puissance de deux : l'indice d'écriture est ramené par masque
+const int ringSize = 16384;
+const float minFrequency = 40.0f;
+const float maxFrequency = 16000.0f;
+const float floorDb = -70.0f;
+const float pi = 3.14159265358979f;
+
+// Échantillons entrelacés vers mono flottant, sans allocation
+template <typename T>
+void mixDown(const T *data, int frames, int channels, float scale, float offset, float *out)
+{
+    for (int i = 0; i < frames; ++i) {
+        float sum = 0;
+        for (int c = 0; c < channels; ++c) {
+            sum += float(data[i * channels + c]) * scale + offset;
+        }
+        out[i] = sum / channels;
+    }
+}
+
+}
+
+SpectrumAnalyzer::SpectrumAnalyzer(QMediaPlayer *player, WavPlayer *wavPlayer, QObject *parent)
+    : QObject(parent)
+    , player(player)
+    , wavPlayer(wavPlayer)
+    , probe(nullptr)
+    , writeIndex(0)
+    , sampleRate(44100)
+    , lastReadIndex(0)
+    , busy(false)
+    , idle(false)
+    , frameNs(0)
+    , frames(0)
+{
+    // Fenêtre de Hann, permutation et facteurs de rotation calculés une fois
+    window.resize(fftSize);
+    for (int i = 0; i < fftSize; ++i) {
+        window[i] = 0.5f - 0.5f * std::cos(2.0f * pi * i / (fftSize - 1));
+    }
+    bitReverse.resize(fftSize);
+    for (int i = 0; i < fftSize; ++i) {
+        int reversed = 0;
+        for (int b = 0; b < fftBits; ++b) {
+            reversed |= ((i >> b) & 1) << (fftBits - 1 - b);
+        }
+        bitReverse[i] = reversed;
+    }
+    twiddleRe.resize(fftSize / 2);
+    twiddleIm.resize(fftSize / 2);
+    for (int i = 0; i < fftSize / 2; ++i) {
+        twiddleRe[i] = std::cos(2.0f * pi * i / fftSize);
+        twiddleIm[i] = -std::sin(2.0f * pi * i / fftSize);
+    }
+
+    frame.bands.fill(0, bandCount);
+}
+
+SpectrumAnalyzer::~SpectrumAnalyzer()
+{
+    tasks.wait();
+}
+
+void SpectrumAnalyzer::setActive(bool active)
+{
+    if (active == isActive()) {
+        return;
+    }
+
+    if (active) {
+        ring.fill(0, ringSize);
+        probe = new QAudioProbe(this);
+        connect(probe, &QAudioProbe::audioBufferProbed, this, &SpectrumAnalyzer::bufferProbed);
+        probe->setSource(player);
+        // Les WAV lus directement ne passent pas par le lecteur multimédia
+        connect(wavPlayer, &WavPlayer::audioBufferProbed, this, &SpectrumAnalyzer::bufferProbed);
+        wavPlayer->setProbing(true);
+    } else {
+        // Plus de copie des tampons : coût nul tant que rien n'est affiché
+        wavPlayer->setProbing(false);
+        disconnect(wavPlayer, &WavPlayer::audioBufferProbed, this, &SpectrumAnalyzer::bufferProbed);
+        delete probe;
+        probe = nullptr;
+        tasks.wait();
+        ring.clear();
+        ring.squeeze();
+    }
+}
+
+bool SpectrumAnalyzer::isActive() const
+{
+    return probe != nullptr;
+}
+
+SpectrumAnalyzer::Frame SpectrumAnalyzer::latestFrame() const
+{
+    QMutexLocker locker(&frameMutex);
+    return frame;
+}
+
+void SpectrumAnalyzer::requestFrame()
+{
+    // Une seule image en cours : si le calcul est en retard, on saute un tour
+    if (!isActive() || busy.exchange(true)) {
+        return;
+    }
+    // Image à l'écran : file interactive, jamais derrière une analyse de la bibliothèque
+    TaskScheduler::instance()->run(TaskScheduler::Cpu, TaskScheduler::Interactive, tasks, [this]() {
+        computeFrame();
+        busy = false;
+    });
+}
+
+bool SpectrumAnalyzer::hasNewSamples() const
+{
+    return writeIndex.load(std::memory_order_acquire) != lastReadIndex.load();
+}
+
+void SpectrumAnalyzer::setIdle(bool value)
+{
+    idle = value;
+}
+
+qint64 SpectrumAnalyzer::averageFrameNs() const
+{
+    const qint64 count = frames;
+    return count > 0 ? frameNs / count : 0;
+}
+
+qint64 SpectrumAnalyzer::memoryUsage() const
+{
+    return qint64(ring.capacity() + window.capacity() + twiddleRe.capacity() + twiddleIm.capacity()) * qint64(sizeof(float))
+            + qint64(bitReverse.capacity()) * qint64(sizeof(int));
+}
+
+void SpectrumAnalyzer::bufferProbed(const QAudioBuffer &buffer)
+{
+    const QAudioFormat format = buffer.format();
+    const int channels = format.channelCount();
+    int count = buffer.frameCount();
+    if (channels <= 0 || count <= 0 || ring.isEmpty()) {
+        return;
+    }
+    sampleRate = format.sampleRate();
+
+    // Écriture par blocs contigus de l'anneau ; seul ce thread avance l'indice
+    quint64 write = writeIndex.load(std::memory_order_relaxed);
+    int done = 0;
+    while (done < count) {
+        const int offset = int(write & (ringSize - 1));
+        const int chunk = qMin(count - done, ringSize - offset);
+        float *out = ring.data() + offset;
+        const int skip = done * channels;
+
+        if (format.sampleType() == QAudioFormat::Float && format.sampleSize() == 32) {
+            mixDown(buffer.constData<float>() + skip, chunk, channels, 1.0f, 0.0f, out);
+        } else if (format.sampleType() == QAudioFormat::SignedInt && format.sampleSize() == 16) {
+            mixDown(buffer.constData<qint16>() + skip, chunk, channels, 1.0f / 32768.0f, 0.0f, out);
+        } else if (format.sampleType() == QAudioFormat::SignedInt && format.sampleSize() == 32) {
+            mixDown(buffer.constData<qint32>() + skip, chunk, channels, 1.0f / 2147483648.0f, 0.0f, out);
+        } else if (format.sampleType() == QAudioFormat::UnSignedInt && format.sampleSize() == 8) {
+            mixDown(buffer.constData<quint8>() + skip, chunk, channels, 1.0f / 128.0f, -1.0f, out);
+        } else {
+            return;
+        }
+        done += chunk;
+        write += quint64(chunk);
+    }
+    writeIndex.store(write, std::memory_order_release);
+
+    if (idle.exchange(false)) {
+        emit activity();
+    }
+}
+
+void SpectrumAnalyzer::computeFrame()
+{
+    QElapsedTimer timer;
+    timer.start();
+
+    // Les fftSize derniers échantillons ; refusés si le producteur les a
+    // écrasés pendant la copie (anneau bien plus grand que la fenêtre)
+    const quint64 end = writeIndex.load(std::memory_order_acquire);
+    if (end < quint64(fftSize)) {
+        return;
+    }
+    float re[fftSize];
+    float im[fftSize];
+    const float *samples = ring.constData();
+    for (int i = 0; i < fftSize; ++i) {
+        re[bitReverse.at(i)] = samples[(end - fftSize + quint64(i)) & (ringSize - 1)];
+    }
+    if (writeIndex.load(std::memory_order_acquire) - end > quint64(ringSize - fftSize)) {
+        return;
+    }
+    lastReadIndex = end;
+
+    float sumSquares = 0;
+    float peak = 0;
+    for (int i = 0; i < fftSize; ++i) {
+        const float value = re[i];
+        sumSquares += value * value;
+        peak = qMax(peak, std::fabs(value));
+        re[i] = value * window.at(bitReverse.at(i));
+        im[i] = 0;
+    }
+
+    fft(re, im);
+
+    // Bandes espacées logarithmiquement, en dB ramenés entre 0 et 1
+    Frame result;
+    result.bands.resize(bandCount);
+    const float rate = float(sampleRate.load());
+    const float top = qMin(maxFrequency, rate / 2);
+    const float binWidth = rate / fftSize;
+    for (int band = 0; band < bandCount; ++band) {
+        const float low = minFrequency * std::pow(top / minFrequency, float(band) / bandCount);
+        const float high = minFrequency * std::pow(top / minFrequency, float(band + 1) / bandCount);
+        const int first = qBound(1, int(low / binWidth), fftSize / 2 - 1);
+        const int last = qBound(first, int(high / binWidth), fftSize / 2 - 1);
+        float power = 0;
+        for (int bin = first; bin <= last; ++bin) {
+            power = qMax(power, re[bin] * re[bin] + im[bin] * im[bin]);
+        }
+        const float db = 10.0f * std::log10(power / (fftSize * fftSize / 16) + 1e-12f);
+        result.bands[band] = qBound(0.0f, 1.0f - db / floorDb, 1.0f);
+    }
+    result.rms = std::sqrt(sumSquares / fftSize);
+    result.peak = qMin(peak, 1.0f);
+
+    {
+        QMutexLocker locker(&frameMutex);
+        frame = result;
+    }
+    frameNs += timer.nsecsElapsed();
+    ++frames;
+}
+
+void SpectrumAnalyzer::fft(float *re, float *im) const
+{
+    // Radix 2 itératif sur tableaux séparés réel/imaginaire : la boucle
+    // intérieure est contiguë et se vectorise dès que le demi-bloc fait 4
+    float wr[fftSize / 2];
+    float wi[fftSize / 2];
+    for (int half = 1; half < fftSize; half *= 2) {
+        const int stride = fftSize / (2 * half);
+        for (int j = 0; j < half; ++j) {
+            wr[j] = twiddleRe.at(j * stride);
+            wi[j] = twiddleIm.at(j * stride);
+        }
+        for (int block = 0; block < fftSize; block += 2 * half) {
+            float *ar = re + block;
+            float *ai = im + block;
+            float *br = ar + half;
+            float *bi = ai + half;
+            for (int j = 0; j < half; ++j) {
+                const float tr = br[j] * wr[j] - bi[j] * wi[j];
+                const float ti = br[j] * wi[j] + bi[j] * wr[j];
+                br[j] = ar[j] - tr;
+                bi[j] = ai[j] - ti;
+                ar[j] += tr;
+                ai[j] += ti;
+            }
+        }
+    }
+}
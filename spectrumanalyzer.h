@@ -0,0 +1,82 @@
+#ifndef SPECTRUMANALYZER_H
+#define SPECTRUMANALYZER_H
+
+#include <QObject>
+#include <QMutex>
+#include <QVector>
+#include <atomic>
+#include "taskscheduler.h"
+
+class QMediaPlayer;
+class WavPlayer;
+class QAudioProbe;
+class QAudioBuffer;
+
+// Analyse du son joué : les tampons décodés sont copiés dans un anneau sans
+// verrou, les FFT fenêtrées sont calculées sur un thread à part à la demande
+// de l'affichage. Rien n'est copié ni calculé tant que l'analyse est inactive.
+class SpectrumAnalyzer : public QObject
+{
+    Q_OBJECT
+
+public:
+    struct Frame {
+        QVector<float> bands;   // 0 à 1, fréquences croissantes
+        float rms = 0;
+        float peak = 0;
+    };
+
+    static const int bandCount = 32;
+
+    SpectrumAnalyzer(QMediaPlayer *player, WavPlayer *wavPlayer, QObject *parent = nullptr);
+    ~SpectrumAnalyzer();
+
+    void setActive(bool active);
+    bool isActive() const;
+
+    // Dernière image calculée, puis calcul de la suivante en arrière-plan
+    Frame latestFrame() const;
+    void requestFrame();
+    bool hasNewSamples() const;
+    void setIdle(bool idle);
+
+    qint64 averageFrameNs() const;
+    qint64 memoryUsage() const;
+
+signals:
+    // Du son arrive alors que l'affichage s'était mis en veille
+    void activity();
+
+private slots:
+    void bufferProbed(const QAudioBuffer &buffer);
+
+private:
+    void computeFrame();
+    void fft(float *re, float *im) const;
+
+    QMediaPlayer *player;
+    WavPlayer *wavPlayer;
+    QAudioProbe *probe;
+    TaskScheduler::Group tasks;
+
+    // Anneau à un producteur (interface) et un consommateur (calcul)
+    QVector<float> ring;
+    std::atomic<quint64> writeIndex;
+    std::atomic<int> sampleRate;
+    std::atomic<quint64> lastReadIndex;
+
+    std::atomic<bool> busy;
+    std::atomic<bool> idle;
+    std::atomic<qint64> frameNs;
+    std::atomic<qint64> frames;
+
+    QVector<float> window;
+    QVector<int> bitReverse;
+    QVector<float> twiddleRe;
+    QVector<float> twiddleIm;
+
+    mutable QMutex frameMutex;
+    Frame frame;
+};
+
+#endif // SPECTRUMANALYZER_H
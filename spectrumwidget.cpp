@@ -0,0 +1,146 @@
+#include "spectrumwidget.h"
+#include "spectrumanalyzer.h"
+#include <QTimer>
+#include <QPainter>
+#include <QElapsedTimer>
+#include <QEvent>
+#include <QGuiApplication>
+#include <QScreen>
+
+namespace {
+
+// Retombée des barres par image, pour un mouvement lisible
+const float decay = 0.85f;
+const float silence = 0.01f;
+const int statsEveryFrames = 60;
+
+}
+
+SpectrumWidget::SpectrumWidget(SpectrumAnalyzer *analyzer, QWidget *parent)
+    : QWidget(parent)
+    , analyzer(analyzer)
+    , watchedWindow(nullptr)
+    , rms(0)
+    , peak(0)
+    , paintNs(0)
+    , paints(0)
+{
+    levels.fill(0, SpectrumAnalyzer::bandCount);
+
+    const QScreen *screen = QGuiApplication::primaryScreen();
+    const qreal refreshRate = screen && screen->refreshRate() > 0 ? screen->refreshRate() : 60;
+    timer = new QTimer(this);
+    timer->setTimerType(Qt::PreciseTimer);
+    timer->setInterval(qMax(1, int(1000 / refreshRate)));
+    connect(timer, &QTimer::timeout, this, &SpectrumWidget::tick);
+    connect(analyzer, &SpectrumAnalyzer::activity, this, &SpectrumWidget::resume);
+}
+
+qint64 SpectrumWidget::averagePaintNs() const
+{
+    return paints > 0 ? paintNs / paints : 0;
+}
+
+void SpectrumWidget::paintEvent(QPaintEvent *)
+{
+    QElapsedTimer elapsed;
+    elapsed.start();
+
+    QPainter painter(this);
+    painter.setPen(Qt::NoPen);
+
+    // Vumètre à droite : efficace plein, crête en trait
+    const int meterWidth = 6;
+    const int spectrumWidth = width() - 2 * meterWidth - 4;
+    const qreal barWidth = qreal(spectrumWidth) / levels.size();
+    painter.setBrush(QColor(255, 255, 255, 170));
+    for (int i = 0; i < levels.size(); ++i) {
+        const qreal barHeight = levels.at(i) * height();
+        painter.drawRect(QRectF(i * barWidth + 1, height() - barHeight, barWidth - 2, barHeight));
+    }
+
+    const int meterX = width() - 2 * meterWidth;
+    painter.setBrush(QColor(120, 220, 140, 200));
+    painter.drawRect(QRectF(meterX, height() * (1 - rms), meterWidth, height() * rms));
+    painter.setBrush(QColor(240, 90, 80, 220));
+    painter.drawRect(QRectF(meterX + meterWidth, height() * (1 - peak), meterWidth, 2));
+
+    paintNs += elapsed.nsecsElapsed();
+    ++paints;
+}
+
+void SpectrumWidget::showEvent(QShowEvent *event)
+{
+    QWidget::showEvent(event);
+    if (watchedWindow != window()) {
+        if (watchedWindow) {
+            watchedWindow->removeEventFilter(this);
+        }
+        watchedWindow = window();
+        watchedWindow->installEventFilter(this);
+    }
+    updateActivity();
+}
+
+void SpectrumWidget::hideEvent(QHideEvent *event)
+{
+    QWidget::hideEvent(event);
+    updateActivity();
+}
+
+bool SpectrumWidget::eventFilter(QObject *watched, QEvent *event)
+{
+    if (watched == watchedWindow && event->type() == QEvent::WindowStateChange) {
+        updateActivity();
+    }
+    return QWidget::eventFilter(watched, event);
+}
+
+void SpectrumWidget::tick()
+{
+    const SpectrumAnalyzer::Frame frame = analyzer->latestFrame();
+    bool quiet = true;
+    for (int i = 0; i < levels.size(); ++i) {
+        levels[i] = qMax(frame.bands.value(i), levels.at(i) * decay);
+        quiet = quiet && levels.at(i) < silence;
+    }
+    rms = qMax(frame.rms, rms * decay);
+    peak = qMax(frame.peak, peak * decay);
+
+    if (!analyzer->hasNewSamples() && quiet) {
+        // Lecture en pause : plus de réveil jusqu'au prochain tampon
+        timer->stop();
+        analyzer->setIdle(true);
+    } else {
+        analyzer->requestFrame();
+    }
+    update();
+
+    if (paints > 0 && paints % statsEveryFrames == 0) {
+        setToolTip(QString("Analyse : %1 µs, dessin : %2 µs par image")
+                   .arg(analyzer->averageFrameNs() / 1000.0, 0, 'f', 1)
+                   .arg(averagePaintNs() / 1000.0, 0, 'f', 1));
+    }
+}
+
+void SpectrumWidget::resume()
+{
+    if (analyzer->isActive() && !timer->isActive()) {
+        timer->start();
+    }
+}
+
+void SpectrumWidget::updateActivity()
+{
+    const bool active = isVisible() && !window()->isMinimized();
+    analyzer->setActive(active);
+    analyzer->setIdle(false);
+    if (active) {
+        timer->start();
+    } else {
+        timer->stop();
+        levels.fill(0);
+        rms = 0;
+        peak = 0;
+    }
+}
@@ -0,0 +1,44 @@
+#ifndef SPECTRUMWIDGET_H
+#define SPECTRUMWIDGET_H
+
+#include <QWidget>
+#include <QVector>
+
+class QTimer;
+class SpectrumAnalyzer;
+
+// Barres de spectre et vumètre superposés à la pochette. Le rafraîchissement
+// suit l'écran et s'arrête quand la fenêtre est cachée, réduite ou silencieuse.
+class SpectrumWidget : public QWidget
+{
+    Q_OBJECT
+
+public:
+    explicit SpectrumWidget(SpectrumAnalyzer *analyzer, QWidget *parent = nullptr);
+
+    qint64 averagePaintNs() const;
+
+protected:
+    void paintEvent(QPaintEvent *event) override;
+    void showEvent(QShowEvent *event) override;
+    void hideEvent(QHideEvent *event) override;
+    bool eventFilter(QObject *watched, QEvent *event) override;
+
+private slots:
+    void tick();
+    void resume();
+
+private:
+    void updateActivity();
+
+    SpectrumAnalyzer *analyzer;
+    QTimer *timer;
+    QWidget *watchedWindow;
+    QVector<float> levels;
+    float rms;
+    float peak;
+    qint64 paintNs;
+    qint64 paints;
+};
+
+#endif // SPECTRUMWIDGET_H
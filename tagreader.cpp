@@ -0,0 +1,171 @@
+#include "tagreader.h"
+#include <QFile>
+#include <QByteArray>
+
+namespace {
+
+// Les étiquettes plus grandes contiennent surtout des images : on s'arrête avant
+const int maxTagBytes = 256 * 1024;
+
+quint32 bigEndian(const QByteArray &data, int offset, int length)
+{
+    quint32 value = 0;
+    for (int i = 0; i < length; ++i) {
+        value = (value << 8) | quint8(data.at(offset + i));
+    }
+    return value;
+}
+
+quint32 syncSafe(const QByteArray &data, int offset)
+{
+    quint32 value = 0;
+    for (int i = 0; i < 4; ++i) {
+        value = (value << 7) | (quint8(data.at(offset + i)) & 0x7F);
+    }
+    return value;
+}
+
+QString decodeUtf16(const QByteArray &bytes, bool bigEndianOrder)
+{
+    QString text;
+    text.reserve(bytes.size() / 2);
+    for (int i = 0; i + 1 < bytes.size(); i += 2) {
+        const ushort hi = quint8(bytes.at(bigEndianOrder ? i : i + 1));
+        const ushort lo = quint8(bytes.at(bigEndianOrder ? i + 1 : i));
+        const ushort unit = ushort((hi << 8) | lo);
+        if (unit == 0) {
+            break;
+        }
+        text.append(QChar(unit));
+    }
+    return text;
+}
+
+QString decodeText(const QByteArray &body)
+{
+    if (body.isEmpty()) {
+        return QString();
+    }
+
+    const char encoding = body.at(0);
+    QByteArray text = body.mid(1);
+    switch (encoding) {
+    case 1:
+        if (text.startsWith("\xFE\xFF")) {
+            return decodeUtf16(text.mid(2), true);
+        }
+        if (text.startsWith("\xFF\xFE")) {
+            return decodeUtf16(text.mid(2), false);
+        }
+        return decodeUtf16(text, false);
+    case 2:
+        return decodeUtf16(text, true);
+    case 3:
+        return QString::fromUtf8(text.left(text.indexOf('\0') < 0 ? text.size() : text.indexOf('\0'))).trimmed();
+    default:
+        return QString::fromLatin1(text.left(text.indexOf('\0') < 0 ? text.size() : text.indexOf('\0'))).trimmed();
+    }
+}
+
+void readId3v2(QFile &file, TagReader::Tags *tags)
+{
+    const QByteArray header = file.read(10);
+    if (header.size() < 10 || !header.startsWith("ID3")) {
+        return;
+    }
+
+    const int major = quint8(header.at(3));
+    const quint8 flags = quint8(header.at(5));
+    const int tagSize = int(qMin<quint32>(syncSafe(header, 6), maxTagBytes));
+    const QByteArray data = file.read(tagSize);
+
+    int pos = 0;
+    if ((flags & 0x40) && major >= 3 && data.size() >= 4) {
+        pos = major == 4 ? int(syncSafe(data, 0)) : int(bigEndian(data, 0, 4)) + 4;
+    }
+    // Taille d'en-tête étendu corrompue : elle peut déborder en négatif
+    if (pos < 0 || pos > data.size()) {
+        return;
+    }
+
+    const int idLength = major == 2 ? 3 : 4;
+    const int frameHeaderSize = major == 2 ? 6 : 10;
+
+    while (pos + frameHeaderSize <= data.size()) {
+        const QByteArray id = data.mid(pos, idLength);
+        if (id.at(0) == '\0') {
+            break;
+        }
+
+        int frameSize;
+        if (major == 2) {
+            frameSize = int(bigEndian(data, pos + 3, 3));
+        } else if (major == 4) {
+            frameSize = int(syncSafe(data, pos + 4));
+        } else {
+            frameSize = int(bigEndian(data, pos + 4, 4));
+        }
+        if (frameSize <= 0 || frameSize > data.size() - pos - frameHeaderSize) {
+            break;
+        }
+
+        const QByteArray body = data.mid(pos + frameHeaderSize, frameSize);
+        if (id == "TIT2" || id == "TT2") {
+            tags->title = decodeText(body);
+        } else if (id == "TPE1" || id == "TP1") {
+            tags->artist = decodeText(body);
+        } else if (id == "TALB" || id == "TAL") {
+            tags->album = decodeText(body);
+        }
+
+        pos += frameHeaderSize + frameSize;
+    }
+}
+
+void readId3v1(QFile &file, TagReader::Tags *tags)
+{
+    if (file.size() < 128 || !file.seek(file.size() - 128)) {
+        return;
+    }
+
+    const QByteArray data = file.read(128);
+    if (data.size() < 128 || !data.startsWith("TAG")) {
+        return;
+    }
+
+    auto field = [&data](int offset) -> QString {
+        QByteArray value = data.mid(offset, 30);
+        const int end = value.indexOf('\0');
+        if (end >= 0) {
+            value.truncate(end);
+        }
+        return QString::fromLatin1(value).trimmed();
+    };
+
+    if (tags->title.isEmpty()) {
+        tags->title = field(3);
+    }
+    if (tags->artist.isEmpty()) {
+        tags->artist = field(33);
+    }
+    if (tags->album.isEmpty()) {
+        tags->album = field(63);
+    }
+}
+
+}
+
+TagReader::Tags TagReader::read(const QString &filePath)
+{
+    Tags tags;
+    QFile file(filePath);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return tags;
+    }
+
+    readId3v2(file, &tags);
+    if (tags.artist.isEmpty() || tags.album.isEmpty()) {
+        readId3v1(file, &tags);
+    }
+    return tags;
+}
@@ -0,0 +1,22 @@
+#ifndef TAGREADER_H
+#define TAGREADER_H
+
+#include <QString>
+#include <QMetaType>
+
+// Lecture minimale des étiquettes ID3 (v2.2 à v2.4, puis v1 en secours).
+class TagReader
+{
+public:
+    struct Tags {
+        QString title;
+        QString artist;
+        QString album;
+    };
+
+    static Tags read(const QString &filePath);
+};
+
+Q_DECLARE_METATYPE(TagReader::Tags)
+
+#endif // TAGREADER_H
@@ -0,0 +1,364 @@
+#include "taskscheduler.h"
+#include <QThread>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QWaitCondition>
+#include <QElapsedTimer>
+#include <QString>
+#include <QVector>
+#include <deque>
+
+namespace {
+
+// Entrées-sorties : assez pour couvrir la latence d'un disque ou d'un partage,
+// pas au point de faire sauter la tête de lecture d'un disque à plateaux
+const int ioThreads = 4;
+const int minCpuThreads = 2;
+
+const char *const poolNames[] = { "Calcul", "E/S" };
+
+QElapsedTimer schedulerClock;
+
+}
+
+struct TaskScheduler::Group::State {
+    QMutex mutex;
+    QWaitCondition done;
+    int outstanding = 0;
+    Token token;
+};
+
+struct TaskScheduler::Task {
+    std::function<void()> run;
+    std::shared_ptr<Group::State> group;
+    Token token;
+    qint64 queuedNs = 0;
+};
+
+struct TaskScheduler::Worker {
+    QMutex mutex;
+    std::deque<Task> lanes[LaneCount];
+    QThread *thread = nullptr;
+};
+
+struct TaskScheduler::PoolState {
+    QVector<Worker *> workers;
+
+    // Tâches soumises hors des threads de la réserve
+    QMutex injectMutex;
+    std::deque<Task> injected[LaneCount];
+
+    QMutex sleepMutex;
+    QWaitCondition wakeup;
+    quint64 signalCount = 0;
+    bool stopping = false;
+
+    std::atomic<int> idleRunning{0};
+    int idleLimit = 1;
+    std::atomic<qint64> steals{0};
+
+    mutable QMutex statsMutex;
+    LaneStats stats[LaneCount];
+};
+
+namespace {
+
+// Thread de réserve qui exécute la tâche courante : ses soumissions restent chez lui
+thread_local void *currentPool = nullptr;
+thread_local int currentWorker = -1;
+
+}
+
+
+TaskScheduler::Token::Token()
+    : flag(std::make_shared<std::atomic<bool> >(false))
+{
+}
+
+void TaskScheduler::Token::cancel() const
+{
+    flag->store(true);
+}
+
+bool TaskScheduler::Token::isCancelled() const
+{
+    return flag->load();
+}
+
+
+TaskScheduler::Group::Group()
+    : state(std::make_shared<State>())
+{
+}
+
+TaskScheduler::Group::~Group()
+{
+    cancel();
+    wait();
+}
+
+void TaskScheduler::Group::cancel()
+{
+    QMutexLocker locker(&state->mutex);
+    state->token.cancel();
+    state->token = Token();
+}
+
+void TaskScheduler::Group::wait()
+{
+    QMutexLocker locker(&state->mutex);
+    while (state->outstanding > 0) {
+        state->done.wait(&state->mutex);
+    }
+}
+
+TaskScheduler::Token TaskScheduler::Group::token() const
+{
+    QMutexLocker locker(&state->mutex);
+    return state->token;
+}
+
+
+TaskScheduler *TaskScheduler::instance()
+{
+    static TaskScheduler scheduler;
+    return &scheduler;
+}
+
+TaskScheduler::TaskScheduler()
+{
+    schedulerClock.start();
+
+    for (int p = 0; p < PoolCount; ++p) {
+        PoolState *pool = new PoolState;
+        const int count = p == Io ? ioThreads : qMax(minCpuThreads, QThread::idealThreadCount());
+        // Le premier thread est réservé à l'interactif : l'analyse se partage la moitié des autres
+        pool->idleLimit = qMax(1, (count - 1) / 2);
+        for (int i = 0; i < count; ++i) {
+            pool->workers.append(new Worker);
+        }
+        pools[p] = pool;
+
+        for (int i = 0; i < count; ++i) {
+            QThread *thread = QThread::create([this, pool, i]() {
+                work(pool, i);
+            });
+            thread->setObjectName(QString("%1 %2").arg(poolNames[p]).arg(i));
+            pool->workers[i]->thread = thread;
+            thread->start(i == 0 ? QThread::HighPriority : QThread::LowPriority);
+        }
+    }
+}
+
+TaskScheduler::~TaskScheduler()
+{
+    for (PoolState *pool : pools) {
+        {
+            QMutexLocker locker(&pool->sleepMutex);
+            pool->stopping = true;
+            pool->wakeup.wakeAll();
+        }
+        for (Worker *worker : pool->workers) {
+            worker->thread->wait();
+            delete worker->thread;
+        }
+
+        // Tâches jamais lancées : leurs groupes ne doivent pas les attendre
+        for (int lane = 0; lane < LaneCount; ++lane) {
+            std::deque<Task> remaining;
+            remaining.swap(pool->injected[lane]);
+            for (Worker *worker : pool->workers) {
+                remaining.insert(remaining.end(), worker->lanes[lane].begin(), worker->lanes[lane].end());
+            }
+            for (Task &task : remaining) {
+                task.token.cancel();
+                execute(pool, lane, task);
+            }
+        }
+        qDeleteAll(pool->workers);
+        delete pool;
+    }
+}
+
+void TaskScheduler::run(Pool pool, Lane lane, Group &group, const std::function<void()> &task)
+{
+    PoolState *state = pools[pool];
+    Task entry;
+    entry.run = task;
+    entry.group = group.state;
+    entry.queuedNs = schedulerClock.nsecsElapsed();
+    {
+        QMutexLocker locker(&group.state->mutex);
+        ++group.state->outstanding;
+        entry.token = group.state->token;
+    }
+    {
+        QMutexLocker locker(&state->statsMutex);
+        ++state->stats[lane].queued;
+    }
+
+    if (currentPool == state) {
+        Worker *worker = state->workers.at(currentWorker);
+        QMutexLocker locker(&worker->mutex);
+        worker->lanes[lane].push_back(entry);
+    } else {
+        QMutexLocker locker(&state->injectMutex);
+        state->injected[lane].push_back(entry);
+    }
+    wake(state);
+}
+
+TaskScheduler::LaneStats TaskScheduler::stats(Pool pool, Lane lane) const
+{
+    QMutexLocker locker(&pools[pool]->statsMutex);
+    return pools[pool]->stats[lane];
+}
+
+int TaskScheduler::threadCount(Pool pool) const
+{
+    return pools[pool]->workers.size();
+}
+
+qint64 TaskScheduler::steals(Pool pool) const
+{
+    return pools[pool]->steals.load();
+}
+
+void TaskScheduler::work(PoolState *pool, int index)
+{
+    currentPool = pool;
+    currentWorker = index;
+
+    forever {
+        // Compteur relevé avant de chercher : une soumission entre-temps empêche de s'endormir
+        quint64 seen;
+        {
+            QMutexLocker locker(&pool->sleepMutex);
+            if (pool->stopping) {
+                return;
+            }
+            seen = pool->signalCount;
+        }
+
+        Task task;
+        int lane = 0;
+        if (take(pool, index, &task, &lane)) {
+            execute(pool, lane, task);
+            continue;
+        }
+
+        QMutexLocker locker(&pool->sleepMutex);
+        while (!pool->stopping && pool->signalCount == seen) {
+            pool->wakeup.wait(&pool->sleepMutex);
+        }
+    }
+}
+
+bool TaskScheduler::take(PoolState *pool, int index, Task *task, int *lane)
+{
+    Worker *self = pool->workers.at(index);
+    const bool reserved = index == 0;
+
+    for (int l = Interactive; l < LaneCount; ++l) {
+        if (reserved && l != Interactive) {
+            return false;
+        }
+        if (l == Idle) {
+            // Place réservée avant de chercher, rendue si rien n'attend
+            int running = pool->idleRunning.load();
+            do {
+                if (running >= pool->idleLimit) {
+                    return false;
+                }
+            } while (!pool->idleRunning.compare_exchange_weak(running, running + 1));
+        }
+
+        bool found = false;
+        {
+            // Ses propres tâches, les plus récentes d'abord : leurs données sont encore chaudes
+            QMutexLocker locker(&self->mutex);
+            if (!self->lanes[l].empty()) {
+                *task = self->lanes[l].back();
+                self->lanes[l].pop_back();
+                found = true;
+            }
+        }
+        if (!found) {
+            QMutexLocker locker(&pool->injectMutex);
+            if (!pool->injected[l].empty()) {
+                *task = pool->injected[l].front();
+                pool->injected[l].pop_front();
+                found = true;
+            }
+        }
+        // Vol des plus anciennes tâches d'un autre thread
+        for (int i = 1; !found && i < pool->workers.size(); ++i) {
+            Worker *victim = pool->workers.at((index + i) % pool->workers.size());
+            QMutexLocker locker(&victim->mutex);
+            if (!victim->lanes[l].empty()) {
+                *task = victim->lanes[l].front();
+                victim->lanes[l].pop_front();
+                pool->steals.fetch_add(1);
+                found = true;
+            }
+        }
+
+        if (found) {
+            *lane = l;
+            return true;
+        }
+        if (l == Idle) {
+            pool->idleRunning.fetch_sub(1);
+        }
+    }
+    return false;
+}
+
+void TaskScheduler::execute(PoolState *pool, int lane, Task &task)
+{
+    const qint64 started = schedulerClock.nsecsElapsed();
+    const qint64 waitUs = (started - task.queuedNs) / 1000;
+    const bool cancelled = task.token.isCancelled();
+    {
+        QMutexLocker locker(&pool->statsMutex);
+        LaneStats &stats = pool->stats[lane];
+        --stats.queued;
+        stats.totalWaitUs += waitUs;
+        stats.maxWaitUs = qMax(stats.maxWaitUs, waitUs);
+        if (cancelled) {
+            ++stats.cancelled;
+        } else {
+            ++stats.running;
+        }
+    }
+
+    if (!cancelled) {
+        task.run();
+        const qint64 runUs = (schedulerClock.nsecsElapsed() - started) / 1000;
+        QMutexLocker locker(&pool->statsMutex);
+        LaneStats &stats = pool->stats[lane];
+        --stats.running;
+        ++stats.completed;
+        stats.totalRunUs += runUs;
+    }
+    task.run = nullptr;
+
+    if (lane == Idle && currentPool == pool) {
+        // Une place d'analyse se libère : un thread retenu peut la prendre
+        pool->idleRunning.fetch_sub(1);
+        wake(pool);
+    }
+
+    QMutexLocker locker(&task.group->mutex);
+    if (--task.group->outstanding == 0) {
+        task.group->done.wakeAll();
+    }
+}
+
+void TaskScheduler::wake(PoolState *pool)
+{
+    // Tous réveillés : le thread réservé ignore ce qui n'est pas interactif
+    QMutexLocker locker(&pool->sleepMutex);
+    ++pool->signalCount;
+    pool->wakeup.wakeAll();
+}
@@ -0,0 +1,89 @@
+#ifndef TASKSCHEDULER_H
+#define TASKSCHEDULER_H
+
+#include <QtGlobal>
+#include <functional>
+#include <memory>
+#include <atomic>
+
+// Ordonnanceur commun des travaux d'arrière-plan. Deux réserves de threads,
+// calcul et entrées-sorties, chacune avec trois files de priorité : l'interactif
+// (pochette visible, piste suivante) passe avant l'ajout de fichiers, qui passe
+// avant l'analyse. Le premier thread de chaque réserve ne sert que l'interactif
+// et l'analyse n'occupe jamais plus de la moitié des autres. Chaque thread a ses
+// files ; un thread désœuvré prend les tâches des autres.
+// Le QThreadPool global reste aux calculs synchrones de l'interface (recherche, tri).
+class TaskScheduler
+{
+public:
+    enum Pool { Cpu, Io, PoolCount };
+    enum Lane { Interactive, Normal, Idle, LaneCount };
+
+    // Annulation partagée entre le demandeur et ses tâches : une tâche annulée
+    // avant son démarrage n'est pas lancée, une tâche en cours peut l'interroger
+    class Token
+    {
+    public:
+        Token();
+        void cancel() const;
+        bool isCancelled() const;
+
+    private:
+        std::shared_ptr<std::atomic<bool> > flag;
+    };
+
+    // Tâches d'un même propriétaire, à attendre avant sa destruction
+    class Group
+    {
+    public:
+        Group();
+        ~Group();
+
+        // Abandonne les tâches non commencées ; les suivantes sont acceptées
+        void cancel();
+        void wait();
+        // Jeton des tâches soumises à partir de maintenant
+        Token token() const;
+
+    private:
+        friend class TaskScheduler;
+        struct State;
+        std::shared_ptr<State> state;
+    };
+
+    struct LaneStats {
+        int queued = 0;
+        int running = 0;
+        qint64 completed = 0;
+        qint64 cancelled = 0;
+        qint64 totalWaitUs = 0;     // cumul, divisé par completed + cancelled
+        qint64 maxWaitUs = 0;
+        qint64 totalRunUs = 0;      // cumul, divisé par completed
+    };
+
+    static TaskScheduler *instance();
+
+    void run(Pool pool, Lane lane, Group &group, const std::function<void()> &task);
+
+    LaneStats stats(Pool pool, Lane lane) const;
+    int threadCount(Pool pool) const;
+    qint64 steals(Pool pool) const;
+
+private:
+    struct Task;
+    struct Worker;
+    struct PoolState;
+
+    TaskScheduler();
+    ~TaskScheduler();
+    Q_DISABLE_COPY(TaskScheduler)
+
+    void work(PoolState *pool, int index);
+    bool take(PoolState *pool, int index, Task *task, int *lane);
+    void execute(PoolState *pool, int lane, Task &task);
+    void wake(PoolState *pool);
+
+    PoolState *pools[PoolCount];
+};
+
+#endif // TASKSCHEDULER_H
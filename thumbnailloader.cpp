@@ -0,0 +1,165 @@
+#include "thumbnailloader.h"
+#include "coverloader.h"
+#include <QDir>
+#include <QFileInfo>
+#include <QMutexLocker>
+
+namespace {
+
+const int workerCount = 2;
+const qint64 defaultCacheBytes = 48 * 1024 * 1024;
+
+// Noms usuels d'abord, puis n'importe quelle image du dossier
+const QStringList preferredNames = QStringList() << "cover" << "folder" << "front" << "album";
+const QStringList imageFilters = QStringList() << "*.jpg" << "*.jpeg" << "*.png";
+
+}
+
+ThumbnailLoader::ThumbnailLoader(const QSize &size, QObject *parent)
+    : QObject(parent)
+    , size(size)
+    , workers(0)
+{
+    // Coût en Ko
+    cache.setMaxCost(int(defaultCacheBytes / 1024));
+}
+
+ThumbnailLoader::~ThumbnailLoader()
+{
+    {
+        QMutexLocker locker(&mutex);
+        queue.clear();
+        queued.clear();
+    }
+    tasks.wait();
+}
+
+QSize ThumbnailLoader::thumbnailSize() const
+{
+    return size;
+}
+
+QImage ThumbnailLoader::thumbnail(const QString &key) const
+{
+    const QImage *image = cache.object(key);
+    return image ? *image : QImage();
+}
+
+void ThumbnailLoader::request(const QString &key, const QStringList &sources)
+{
+    if (cache.contains(key) || failed.contains(key)) {
+        return;
+    }
+
+    QMutexLocker locker(&mutex);
+    if (queued.contains(key)) {
+        return;
+    }
+    Request request;
+    request.key = key;
+    request.sources = sources;
+    queue.append(request);
+    queued.insert(key);
+
+    if (workers < workerCount) {
+        ++workers;
+        // Cases visibles : file interactive
+        TaskScheduler::instance()->run(TaskScheduler::Cpu, TaskScheduler::Interactive, tasks, [this]() {
+            drain();
+        });
+    }
+}
+
+void ThumbnailLoader::retain(const QSet<QString> &keys)
+{
+    QMutexLocker locker(&mutex);
+    QVector<Request> kept;
+    for (const Request &request : queue) {
+        if (keys.contains(request.key)) {
+            kept.append(request);
+        } else {
+            queued.remove(request.key);
+        }
+    }
+    queue.swap(kept);
+}
+
+void ThumbnailLoader::setCacheLimit(qint64 bytes)
+{
+    cache.setMaxCost(int(qMax<qint64>(bytes, 1024) / 1024));
+}
+
+qint64 ThumbnailLoader::memoryUsage() const
+{
+    return qint64(cache.totalCost()) * 1024;
+}
+
+void ThumbnailLoader::decoded(const QString &key, const QImage &image)
+{
+    if (image.isNull()) {
+        failed.insert(key);
+    } else {
+        cache.insert(key, new QImage(image), qMax(1, int(image.sizeInBytes() / 1024)));
+    }
+    emit thumbnailReady(key);
+}
+
+void ThumbnailLoader::drain()
+{
+    forever {
+        Request request;
+        {
+            // Dernière demande d'abord : c'est la zone que l'on regarde
+            QMutexLocker locker(&mutex);
+            if (queue.isEmpty()) {
+                --workers;
+                return;
+            }
+            request = queue.takeLast();
+        }
+
+        const QImage image = load(request.sources);
+        {
+            QMutexLocker locker(&mutex);
+            queued.remove(request.key);
+        }
+        QMetaObject::invokeMethod(this, "decoded", Qt::QueuedConnection,
+                                  Q_ARG(QString, request.key), Q_ARG(QImage, image));
+    }
+}
+
+QImage ThumbnailLoader::load(const QStringList &sources) const
+{
+    for (const QString &source : sources) {
+        const QFileInfo info(source);
+        QString imagePath;
+        if (info.isFile()) {
+            imagePath = source;
+        } else if (info.isDir()) {
+            const QStringList images = QDir(source).entryList(imageFilters, QDir::Files, QDir::Name);
+            for (const QString &name : preferredNames) {
+                for (const QString &image : images) {
+                    if (image.startsWith(name, Qt::CaseInsensitive)) {
+                        imagePath = QDir(source).filePath(image);
+                        break;
+                    }
+                }
+                if (!imagePath.isEmpty()) {
+                    break;
+                }
+            }
+            if (imagePath.isEmpty() && !images.isEmpty()) {
+                imagePath = QDir(source).filePath(images.first());
+            }
+        }
+
+        if (!imagePath.isEmpty()) {
+            // Réduite et convertie ici : l'interface n'a plus qu'à la peindre
+            const QImage image = CoverLoader::decode(imagePath, size);
+            if (!image.isNull()) {
+                return image.convertToFormat(QImage::Format_ARGB32_Premultiplied);
+            }
+        }
+    }
+    return QImage();
+}
@@ -0,0 +1,61 @@
+#ifndef THUMBNAILLOADER_H
+#define THUMBNAILLOADER_H
+
+#include <QObject>
+#include <QMutex>
+#include <QCache>
+#include <QImage>
+#include <QSet>
+#include <QVector>
+#include <QStringList>
+#include "taskscheduler.h"
+
+// Vignettes de la grille : décodées et réduites sur des threads de travail,
+// gardées en QImage déjà à la taille d'affichage. Les demandes encore en
+// attente sont abandonnées dès que leur case sort de la zone visible.
+class ThumbnailLoader : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit ThumbnailLoader(const QSize &size, QObject *parent = nullptr);
+    ~ThumbnailLoader();
+
+    QSize thumbnailSize() const;
+
+    // Vignette prête, sinon une image nulle
+    QImage thumbnail(const QString &key) const;
+    // Sources : fichiers image ou dossiers où chercher une pochette
+    void request(const QString &key, const QStringList &sources);
+    // Seules ces clés restent en attente
+    void retain(const QSet<QString> &keys);
+
+    void setCacheLimit(qint64 bytes);
+    qint64 memoryUsage() const;
+
+signals:
+    void thumbnailReady(const QString &key);
+
+private slots:
+    void decoded(const QString &key, const QImage &image);
+
+private:
+    struct Request {
+        QString key;
+        QStringList sources;
+    };
+
+    void drain();
+    QImage load(const QStringList &sources) const;
+
+    QSize size;
+    TaskScheduler::Group tasks;
+    QMutex mutex;
+    QVector<Request> queue;
+    QSet<QString> queued;
+    QSet<QString> failed;
+    int workers;
+    QCache<QString, QImage> cache;
+};
+
+#endif // THUMBNAILLOADER_H
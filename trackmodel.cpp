@@ -0,0 +1,333 @@
+#include "trackmodel.h"
+#include <QDateTime>
+#include <QHash>
+#include <QSet>
+#include <QTime>
+
+TrackModel::TrackModel(TrackStore *store, QObject *parent)
+    : QAbstractTableModel(parent)
+    , store(store)
+    , sortColumn(-1)
+    , sortOrder(Qt::AscendingOrder)
+{
+}
+
+QString TrackModel::formatDuration(qint64 duration)
+{
+    if (duration <= 0) {
+        return QString();
+    }
+
+    QTime time(0, 0, 0, 0);
+    time = time.addMSecs(int(duration % (24 * 3600 * 1000)));
+    if (duration >= 3600 * 1000) {
+        return QString::number(duration / (3600 * 1000)) + time.toString(":mm:ss");
+    }
+    return time.toString("mm:ss");
+}
+
+int TrackModel::rowCount(const QModelIndex &parent) const
+{
+    return parent.isValid() ? 0 : rows.size();
+}
+
+int TrackModel::columnCount(const QModelIndex &parent) const
+{
+    return parent.isValid() ? 0 : TrackStore::ColumnCount;
+}
+
+QVariant TrackModel::data(const QModelIndex &index, int role) const
+{
+    if (!index.isValid() || index.row() >= rows.size()) {
+        return QVariant();
+    }
+
+    const int id = rows.at(index.row());
+    switch (role) {
+    case Qt::DisplayRole:
+        switch (index.column()) {
+        case TrackStore::Title:
+            return store->title(id);
+        case TrackStore::Artist:
+            return store->artist(id);
+        case TrackStore::Album:
+            return store->album(id);
+        case TrackStore::Duration:
+            return formatDuration(store->duration(id));
+        case TrackStore::Path:
+            return store->path(id);
+        case TrackStore::DateAdded:
+            if (store->dateAdded(id) > 0) {
+                return QDateTime::fromMSecsSinceEpoch(store->dateAdded(id)).toString("dd/MM/yyyy hh:mm");
+            }
+            return QVariant();
+        case TrackStore::PlayCount:
+            return store->playCount(id);
+        }
+        break;
+    case Qt::TextAlignmentRole:
+        if (index.column() == TrackStore::Duration || index.column() == TrackStore::PlayCount) {
+            return int(Qt::AlignRight | Qt::AlignVCenter);
+        }
+        break;
+    case PathRole:
+        return store->path(id);
+    case TrackIdRole:
+        return id;
+    }
+
+    return QVariant();
+}
+
+QVariant TrackModel::headerData(int section, Qt::Orientation orientation, int role) const
+{
+    if (orientation != Qt::Horizontal || role != Qt::DisplayRole) {
+        return QVariant();
+    }
+
+    switch (section) {
+    case TrackStore::Title:
+        return tr("Titre");
+    case TrackStore::Artist:
+        return tr("Artiste");
+    case TrackStore::Album:
+        return tr("Album");
+    case TrackStore::Duration:
+        return tr("Durée");
+    case TrackStore::Path:
+        return tr("Chemin");
+    case TrackStore::DateAdded:
+        return tr("Ajouté le");
+    case TrackStore::PlayCount:
+        return tr("Lectures");
+    }
+    return QVariant();
+}
+
+void TrackModel::sort(int column, Qt::SortOrder order)
+{
+    sortColumn = column;
+    sortOrder = order;
+    // Sans colonne de tri, l'ordre propre de la liste affichée
+    sorted = natural;
+    if (sortColumn >= 0) {
+        store->sort(sorted, sortColumn, sortOrder);
+    }
+    setRows(filteredRows());
+}
+
+int TrackModel::trackAt(int row) const
+{
+    return rows.value(row, -1);
+}
+
+int TrackModel::rowOf(int trackId) const
+{
+    return rows.indexOf(trackId);
+}
+
+QVector<int> TrackModel::allTracks() const
+{
+    return sorted;
+}
+
+int TrackModel::currentSortColumn() const
+{
+    return sortColumn;
+}
+
+qint64 TrackModel::memoryUsage() const
+{
+    // Sans filtre les lignes partagent le tableau de l'ordre trié
+    qint64 bytes = qint64(natural.capacity()) * qint64(sizeof(int));
+    if (sorted.constData() != natural.constData()) {
+        bytes += qint64(sorted.capacity()) * qint64(sizeof(int));
+    }
+    if (rows.constData() != sorted.constData()) {
+        bytes += qint64(rows.capacity()) * qint64(sizeof(int));
+    }
+    return bytes;
+}
+
+void TrackModel::resetTracks()
+{
+    setTracks(store->ids());
+}
+
+void TrackModel::setTracks(const QVector<int> &ids)
+{
+    // Vecteurs partagés : sans tri ni filtre, changer de liste ne copie rien
+    beginResetModel();
+    natural = ids;
+    sorted = natural;
+    if (sortColumn >= 0) {
+        store->sort(sorted, sortColumn, sortOrder);
+    }
+    rows = filteredRows();
+    endResetModel();
+}
+
+void TrackModel::insertTracks(const QVector<int> &ids)
+{
+    if (ids.isEmpty()) {
+        return;
+    }
+
+    // Le lot est trié seul puis fusionné : pas de nouveau tri complet
+    natural += ids;
+    if (sortColumn >= 0) {
+        store->merge(sorted, ids, sortColumn, sortOrder);
+    } else {
+        sorted = natural;
+    }
+    setRows(filteredRows());
+}
+
+void TrackModel::removeTrack(int trackId)
+{
+    const int row = rows.indexOf(trackId);
+    natural.removeOne(trackId);
+    if (sortColumn >= 0) {
+        sorted.removeOne(trackId);
+    } else {
+        sorted = natural;
+    }
+    if (row >= 0) {
+        beginRemoveRows(QModelIndex(), row, row);
+        if (query.isEmpty()) {
+            rows = sorted;
+        } else {
+            rows.remove(row);
+        }
+        endRemoveRows();
+    }
+}
+
+void TrackModel::removeTracks(const QVector<int> &ids)
+{
+    if (ids.isEmpty()) {
+        return;
+    }
+
+    const QSet<int> removed = QSet<int>(ids.constBegin(), ids.constEnd());
+    const auto without = [&removed](const QVector<int> &list) -> QVector<int> {
+        QVector<int> kept;
+        kept.reserve(list.size());
+        for (int id : list) {
+            if (!removed.contains(id)) {
+                kept.append(id);
+            }
+        }
+        return kept;
+    };
+
+    natural = without(natural);
+    sorted = sortColumn >= 0 ? without(sorted) : natural;
+    setRows(query.isEmpty() ? sorted : without(rows));
+}
+
+void TrackModel::trackChanged(int trackId)
+{
+    if (sortColumn >= 0 && sorted.removeOne(trackId)) {
+        store->merge(sorted, QVector<int>() << trackId, sortColumn, sortOrder);
+        setRows(filteredRows());
+    } else if (!query.isEmpty()) {
+        setRows(filteredRows());
+    }
+
+    const int row = rows.indexOf(trackId);
+    if (row >= 0) {
+        emit dataChanged(index(row, 0), index(row, TrackStore::ColumnCount - 1));
+    }
+}
+
+void TrackModel::tracksChanged()
+{
+    if (sortColumn >= 0) {
+        store->sort(sorted, sortColumn, sortOrder);
+    }
+    setRows(filteredRows());
+
+    if (!rows.isEmpty()) {
+        emit dataChanged(index(0, 0), index(rows.size() - 1, TrackStore::ColumnCount - 1));
+    }
+}
+
+void TrackModel::tracksChanged(const QVector<int> &ids, int column)
+{
+    if (ids.isEmpty()) {
+        return;
+    }
+
+    // Seules les pistes modifiées sont retirées puis refusionnées
+    if (column == sortColumn) {
+        const QSet<int> changed = QSet<int>(ids.constBegin(), ids.constEnd());
+        QVector<int> kept;
+        kept.reserve(sorted.size());
+        QVector<int> moved;
+        for (int id : sorted) {
+            if (changed.contains(id)) {
+                moved.append(id);
+            } else {
+                kept.append(id);
+            }
+        }
+        store->merge(kept, moved, sortColumn, sortOrder);
+        sorted.swap(kept);
+        setRows(filteredRows());
+    }
+
+    if (!rows.isEmpty()) {
+        emit dataChanged(index(0, column), index(rows.size() - 1, column));
+    }
+}
+
+void TrackModel::setFilter(const QString &text)
+{
+    query = TrackQuery(text);
+    setRows(filteredRows());
+}
+
+QVector<int> TrackModel::filteredRows() const
+{
+    if (query.isEmpty()) {
+        return sorted;
+    }
+
+    // Requête compilée une fois dans setFilter, appliquée aux colonnes du TrackStore
+    return query.run(store, sorted);
+}
+
+void TrackModel::setRows(const QVector<int> &newRows)
+{
+    emit layoutAboutToBeChanged();
+
+    // La sélection et la piste courante suivent leur identifiant
+    const QModelIndexList oldIndexes = persistentIndexList();
+    QVector<int> oldIds;
+    QHash<int, int> newRowOf;
+    for (const QModelIndex &index : oldIndexes) {
+        const int id = rows.value(index.row(), -1);
+        oldIds.append(id);
+        newRowOf.insert(id, -1);
+    }
+
+    rows = newRows;
+    if (!newRowOf.isEmpty()) {
+        for (int row = 0; row < rows.size(); ++row) {
+            QHash<int, int>::iterator it = newRowOf.find(rows.at(row));
+            if (it != newRowOf.end()) {
+                it.value() = row;
+            }
+        }
+    }
+
+    QModelIndexList newIndexes;
+    for (int i = 0; i < oldIndexes.size(); ++i) {
+        const int row = newRowOf.value(oldIds.at(i), -1);
+        newIndexes.append(row >= 0 ? index(row, oldIndexes.at(i).column()) : QModelIndex());
+    }
+    changePersistentIndexList(oldIndexes, newIndexes);
+
+    emit layoutChanged();
+}
@@ -0,0 +1,62 @@
+#ifndef TRACKMODEL_H
+#define TRACKMODEL_H
+
+#include <QAbstractTableModel>
+#include <QVector>
+#include "trackstore.h"
+#include "trackquery.h"
+
+// Vue ordonnée et filtrée sur le TrackStore. Les lignes ne sont que des
+// identifiants de pistes : trier ou filtrer ne copie aucune donnée.
+class TrackModel : public QAbstractTableModel
+{
+    Q_OBJECT
+
+public:
+    enum Roles {
+        PathRole = Qt::UserRole,
+        TrackIdRole = Qt::UserRole + 1
+    };
+
+    explicit TrackModel(TrackStore *store, QObject *parent = nullptr);
+
+    static QString formatDuration(qint64 duration);
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    int columnCount(const QModelIndex &parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+    QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const override;
+    void sort(int column, Qt::SortOrder order = Qt::AscendingOrder) override;
+
+    int trackAt(int row) const;
+    int rowOf(int trackId) const;
+    QVector<int> allTracks() const;
+    int currentSortColumn() const;
+    qint64 memoryUsage() const;
+
+    void resetTracks();
+    // Affiche un sous-ensemble de la bibliothèque, par exemple une liste
+    void setTracks(const QVector<int> &ids);
+    void insertTracks(const QVector<int> &ids);
+    void removeTrack(int trackId);
+    // Un seul passage sur les listes, quelle que soit la taille du lot
+    void removeTracks(const QVector<int> &ids);
+    void trackChanged(int trackId);
+    void tracksChanged();
+    void tracksChanged(const QVector<int> &ids, int column);
+    void setFilter(const QString &text);
+
+private:
+    QVector<int> filteredRows() const;
+    void setRows(const QVector<int> &newRows);
+
+    TrackStore *store;
+    QVector<int> natural;
+    QVector<int> sorted;
+    QVector<int> rows;
+    int sortColumn;
+    Qt::SortOrder sortOrder;
+    TrackQuery query;
+};
+
+#endif // TRACKMODEL_H
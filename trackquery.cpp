@@ -0,0 +1,406 @@
+#include "trackquery.h"
+#include "trackstore.h"
+#include <QtConcurrent>
+#include <QThread>
+#include <QHash>
+#include <QDate>
+#include <QDateTime>
+#include <QStringList>
+#include <algorithm>
+#include <functional>
+
+namespace {
+
+const int parallelChunkSize = 16384;
+
+struct Chunk {
+    int first;
+    int last;
+    QVector<int> *selection;
+};
+
+int fieldColumn(const QString &name)
+{
+    static const QHash<QString, int> fields = {
+        { "title", TrackStore::Title }, { "titre", TrackStore::Title },
+        { "artist", TrackStore::Artist }, { "artiste", TrackStore::Artist },
+        { "album", TrackStore::Album },
+        { "path", TrackStore::Path }, { "chemin", TrackStore::Path },
+        { "duration", TrackStore::Duration }, { "durée", TrackStore::Duration }, { "duree", TrackStore::Duration },
+        { "added", TrackStore::DateAdded }, { "ajout", TrackStore::DateAdded },
+        { "plays", TrackStore::PlayCount }, { "lectures", TrackStore::PlayCount }
+    };
+    return fields.value(name, -1);
+}
+
+// "5:00", "1:02:03" ou un nombre de secondes, en millisecondes
+bool parseDuration(const QString &text, qint64 *value)
+{
+    qint64 seconds = 0;
+    const QStringList parts = text.split(':');
+    if (parts.size() > 3) {
+        return false;
+    }
+    for (const QString &part : parts) {
+        bool ok = false;
+        const qint64 number = part.toLongLong(&ok);
+        if (!ok || number < 0) {
+            return false;
+        }
+        seconds = seconds * 60 + number;
+    }
+    *value = seconds * 1000;
+    return true;
+}
+
+// "2024", "2024-03" ou "2024-03-15" : début et fin (exclue) de la période.
+// "30d", "2w", "6m" ou "1y" : l'instant situé autant de temps avant maintenant.
+bool parseDate(const QString &text, qint64 *begin, qint64 *end, bool *relative)
+{
+    const QChar unit = text.isEmpty() ? QChar() : text.at(text.size() - 1);
+    if (unit == 'd' || unit == 'w' || unit == 'm' || unit == 'y') {
+        bool ok = false;
+        const int count = text.left(text.size() - 1).toInt(&ok);
+        if (!ok || count < 0) {
+            return false;
+        }
+        QDateTime instant = QDateTime::currentDateTime();
+        if (unit == 'd') {
+            instant = instant.addDays(-count);
+        } else if (unit == 'w') {
+            instant = instant.addDays(-7 * count);
+        } else if (unit == 'm') {
+            instant = instant.addMonths(-count);
+        } else {
+            instant = instant.addYears(-count);
+        }
+        *begin = instant.toMSecsSinceEpoch();
+        *end = *begin;
+        *relative = true;
+        return true;
+    }
+
+    QDate first;
+    QDate next;
+    if (text.size() == 4) {
+        first = QDate::fromString(text, "yyyy");
+        next = first.addYears(1);
+    } else if (text.size() == 7) {
+        first = QDate::fromString(text, "yyyy-MM");
+        next = first.addMonths(1);
+    } else {
+        first = QDate::fromString(text, "yyyy-MM-dd");
+        next = first.addDays(1);
+    }
+    if (!first.isValid()) {
+        return false;
+    }
+    *begin = first.startOfDay().toMSecsSinceEpoch();
+    *end = next.startOfDay().toMSecsSinceEpoch();
+    return true;
+}
+
+bool containsFolded(const QString &text, const QString &needle)
+{
+    const int size = text.size();
+    const int length = needle.size();
+    const ushort *haystack = reinterpret_cast<const ushort *>(text.constData());
+    const ushort *pattern = reinterpret_cast<const ushort *>(needle.constData());
+    for (int i = 0; i + length <= size; ++i) {
+        int j = 0;
+        while (j < length && FuzzyMatcher::fold(haystack[i + j]) == pattern[j]) {
+            ++j;
+        }
+        if (j == length) {
+            return true;
+        }
+    }
+    return false;
+}
+
+}
+
+TrackQuery::TrackQuery(const QString &text)
+    : source(text)
+    , relative(false)
+{
+    QStringList freeText;
+    const QStringList terms = tokenize(text);
+    for (const QString &term : terms) {
+        const bool negate = term.size() > 1 && term.startsWith('-');
+        if (parseTerm(negate ? term.mid(1) : term, negate)) {
+            continue;
+        }
+
+        if (negate) {
+            // Mot exclu : recherche exacte sur le titre, l'artiste et l'album
+            Predicate predicate;
+            predicate.needle = foldText(term.mid(1));
+            predicate.negate = true;
+            predicates.append(predicate);
+        } else {
+            freeText.append(term);
+        }
+    }
+    matcher = FuzzyMatcher(freeText.join(' '));
+
+    // Les comparaisons numériques coûtent moins cher que les recherches de texte
+    std::stable_sort(predicates.begin(), predicates.end(), [](const Predicate &a, const Predicate &b) {
+        return a.op != Contains && b.op == Contains;
+    });
+}
+
+bool TrackQuery::isEmpty() const
+{
+    return predicates.isEmpty() && matcher.isEmpty();
+}
+
+QString TrackQuery::text() const
+{
+    return source;
+}
+
+bool TrackQuery::isRelative() const
+{
+    return relative;
+}
+
+bool TrackQuery::dependsOn(int column) const
+{
+    const bool text = column == TrackStore::Title || column == TrackStore::Artist || column == TrackStore::Album;
+    if (text && !matcher.isEmpty()) {
+        return true;
+    }
+    for (const Predicate &predicate : predicates) {
+        if (predicate.column == column || (text && predicate.column < 0)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+QVector<int> TrackQuery::run(const TrackStore *store, const QVector<int> &candidates) const
+{
+    const QVector<int> selected = predicates.isEmpty() ? candidates : filter(store, candidates, false);
+    if (matcher.isEmpty()) {
+        return selected;
+    }
+    return matcher.rank(store, selected);
+}
+
+QVector<int> TrackQuery::matching(const TrackStore *store, const QVector<int> &candidates) const
+{
+    if (isEmpty()) {
+        return candidates;
+    }
+    return filter(store, candidates, !matcher.isEmpty());
+}
+
+QStringList TrackQuery::tokenize(const QString &text)
+{
+    // Les guillemets regroupent les mots : artist:"daft punk"
+    QStringList terms;
+    QString term;
+    bool quoted = false;
+    for (const QChar ch : text) {
+        if (ch == '"') {
+            quoted = !quoted;
+        } else if (ch.isSpace() && !quoted) {
+            if (!term.isEmpty()) {
+                terms.append(term);
+                term.clear();
+            }
+        } else {
+            term.append(ch);
+        }
+    }
+    if (!term.isEmpty()) {
+        terms.append(term);
+    }
+    return terms;
+}
+
+QString TrackQuery::foldText(const QString &text)
+{
+    QString folded;
+    folded.reserve(text.size());
+    for (const QChar ch : text) {
+        folded.append(QChar(FuzzyMatcher::fold(ch.unicode())));
+    }
+    return folded;
+}
+
+bool TrackQuery::parseTerm(const QString &term, bool negate)
+{
+    int position = -1;
+    for (int i = 1; i < term.size(); ++i) {
+        const QChar ch = term.at(i);
+        if (ch == ':' || ch == '<' || ch == '>' || ch == '=') {
+            position = i;
+            break;
+        }
+    }
+    if (position < 0) {
+        return false;
+    }
+
+    const int column = fieldColumn(term.left(position).toLower());
+    if (column < 0) {
+        return false;
+    }
+
+    const QChar symbol = term.at(position);
+    const bool orEqual = (symbol == '<' || symbol == '>') && term.mid(position + 1).startsWith('=');
+    const QString value = term.mid(position + (orEqual ? 2 : 1));
+    if (value.isEmpty()) {
+        return false;
+    }
+
+    Predicate predicate;
+    predicate.column = column;
+    predicate.negate = negate;
+
+    if (column == TrackStore::Title || column == TrackStore::Artist || column == TrackStore::Album
+            || column == TrackStore::Path) {
+        if (symbol != ':' && symbol != '=') {
+            return false;
+        }
+        predicate.op = Contains;
+        predicate.needle = foldText(value);
+        predicates.append(predicate);
+        return true;
+    }
+
+    // Valeur et précision de l'égalité selon le champ
+    qint64 begin = 0;
+    qint64 end = 0;
+    if (column == TrackStore::Duration) {
+        if (!parseDuration(value, &begin)) {
+            return false;
+        }
+        end = begin + 1000;
+    } else if (column == TrackStore::DateAdded) {
+        if (!parseDate(value, &begin, &end, &relative)) {
+            return false;
+        }
+    } else {
+        bool ok = false;
+        begin = value.toLongLong(&ok);
+        if (!ok) {
+            return false;
+        }
+        end = begin + 1;
+    }
+
+    // Bornes ramenées à la précision du champ : duration<=5:00 vaut duration<5:01
+    if (symbol == '<') {
+        predicate.op = Less;
+        predicate.value = orEqual ? end : begin;
+    } else if (symbol == '>') {
+        predicate.op = GreaterEqual;
+        predicate.value = orEqual ? begin : end;
+    } else {
+        predicate.op = Between;
+        predicate.value = begin;
+        predicate.upper = end;
+    }
+    predicates.append(predicate);
+    return true;
+}
+
+QVector<int> TrackQuery::filter(const TrackStore *store, const QVector<int> &candidates, bool freeText) const
+{
+    const int chunkCount = qBound(1, candidates.size() / parallelChunkSize, qMax(1, QThread::idealThreadCount()) * 4);
+    QVector<QVector<int> > selections(chunkCount);
+    QVector<Chunk> chunks;
+    for (int i = 0; i < chunkCount; ++i) {
+        Chunk chunk;
+        chunk.first = int(qint64(candidates.size()) * i / chunkCount);
+        chunk.last = int(qint64(candidates.size()) * (i + 1) / chunkCount);
+        chunk.selection = &selections[i];
+        chunks.append(chunk);
+    }
+
+    // Chaque prédicat réduit la sélection du morceau avant le suivant
+    const int *ids = candidates.constData();
+    const std::function<void(const Chunk &)> process = [this, store, ids, freeText](const Chunk &chunk) {
+        QVector<int> &selection = *chunk.selection;
+        selection.reserve(chunk.last - chunk.first);
+        for (int i = chunk.first; i < chunk.last; ++i) {
+            selection.append(ids[i]);
+        }
+
+        for (const Predicate &predicate : predicates) {
+            int kept = 0;
+            if (predicate.op == Contains && predicate.column < 0) {
+                const QString *titles = store->textColumn(TrackStore::Title);
+                const QString *artists = store->textColumn(TrackStore::Artist);
+                const QString *albums = store->textColumn(TrackStore::Album);
+                for (int id : selection) {
+                    const bool found = containsFolded(titles[id], predicate.needle)
+                            || containsFolded(artists[id], predicate.needle)
+                            || containsFolded(albums[id], predicate.needle);
+                    if (found != predicate.negate) {
+                        selection[kept++] = id;
+                    }
+                }
+            } else if (predicate.op == Contains && predicate.column == TrackStore::Path) {
+                // Chemins reconstruits depuis l'arbre des dossiers
+                for (int id : selection) {
+                    if (containsFolded(store->path(id), predicate.needle) != predicate.negate) {
+                        selection[kept++] = id;
+                    }
+                }
+            } else if (predicate.op == Contains) {
+                const QString *texts = store->textColumn(predicate.column);
+                for (int id : selection) {
+                    if (containsFolded(texts[id], predicate.needle) != predicate.negate) {
+                        selection[kept++] = id;
+                    }
+                }
+            } else {
+                const qint64 *values = store->numberColumn(predicate.column);
+                for (int id : selection) {
+                    const qint64 value = values[id];
+                    bool match = false;
+                    if (predicate.op == Less) {
+                        match = value < predicate.value;
+                    } else if (predicate.op == GreaterEqual) {
+                        match = value >= predicate.value;
+                    } else {
+                        match = value >= predicate.value && value < predicate.upper;
+                    }
+                    if (match != predicate.negate) {
+                        selection[kept++] = id;
+                    }
+                }
+            }
+            selection.resize(kept);
+        }
+
+        // Texte libre pris comme un critère d'appartenance, sans classement
+        if (freeText) {
+            int kept = 0;
+            for (int id : selection) {
+                if (matcher.score(store->title(id)) >= 0 || matcher.score(store->artist(id)) >= 0
+                        || matcher.score(store->album(id)) >= 0) {
+                    selection[kept++] = id;
+                }
+            }
+            selection.resize(kept);
+        }
+    };
+
+    // Un seul morceau, par exemple une piste modifiée : pas de passage par le pool
+    if (chunkCount == 1) {
+        process(chunks.first());
+    } else {
+        QtConcurrent::blockingMap(chunks, process);
+    }
+
+    QVector<int> result;
+    for (const QVector<int> &selection : selections) {
+        result += selection;
+    }
+    return result;
+}
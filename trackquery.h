@@ -0,0 +1,60 @@
+#ifndef TRACKQUERY_H
+#define TRACKQUERY_H
+
+#include <QString>
+#include <QVector>
+#include "fuzzymatcher.h"
+
+class TrackStore;
+
+// Requête de recherche par champs, par exemple :
+//   artist:daft duration>5:00 path:/nas/live -remix
+// Le texte est analysé une fois et compilé en une suite de prédicats sur les
+// colonnes du TrackStore ; les mots libres restants sont classés par le FuzzyMatcher.
+class TrackQuery
+{
+public:
+    explicit TrackQuery(const QString &text = QString());
+
+    bool isEmpty() const;
+    QString text() const;
+    // Dates relatives ("added>30d") : le résultat change avec le temps
+    bool isRelative() const;
+    bool dependsOn(int column) const;
+
+    // Pistes retenues parmi les candidats : dans l'ordre des candidats,
+    // ou par pertinence si la requête contient du texte libre.
+    QVector<int> run(const TrackStore *store, const QVector<int> &candidates) const;
+    // Toutes les pistes qui satisfont la requête, dans l'ordre des candidats
+    QVector<int> matching(const TrackStore *store, const QVector<int> &candidates) const;
+
+private:
+    enum Operator {
+        Contains,
+        Less,
+        GreaterEqual,
+        Between
+    };
+
+    // Colonne -1 : titre, artiste ou album
+    struct Predicate {
+        int column = -1;
+        Operator op = Contains;
+        QString needle;
+        qint64 value = 0;
+        qint64 upper = 0;
+        bool negate = false;
+    };
+
+    static QStringList tokenize(const QString &text);
+    static QString foldText(const QString &text);
+    bool parseTerm(const QString &term, bool negate);
+    QVector<int> filter(const TrackStore *store, const QVector<int> &candidates, bool freeText) const;
+
+    QString source;
+    QVector<Predicate> predicates;
+    FuzzyMatcher matcher;
+    bool relative;
+};
+
+#endif // TRACKQUERY_H
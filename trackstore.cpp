@@ -0,0 +1,636 @@
+#include "trackstore.h"
+#include <QtConcurrent>
+#include <QThread>
+#include <algorithm>
+
+namespace {
+
+// En dessous de cette taille, un tri sur un seul thread est plus rapide
+const int parallelChunkSize = 16384;
+
+struct Range {
+    int first;
+    int middle;
+    int last;
+};
+
+void configureCollator(QCollator &collator)
+{
+    collator.setNumericMode(true);
+    collator.setCaseSensitivity(Qt::CaseInsensitive);
+}
+
+// En-tête de tableau partagé plus les caractères UTF-16
+qint64 stringBytes(const QString &text)
+{
+    return text.isNull() ? 0 : qint64(sizeof(QArrayData)) + (qint64(text.capacity()) + 1) * 2;
+}
+
+// Une clé de tri n'expose pas sa taille : environ quatre octets par caractère
+qint64 sortKeyBytes(int length)
+{
+    return length == 0 ? 0 : 32 + qint64(length) * 4;
+}
+
+// Nœud de QHash : pointeur suivant, hachage, clé et valeur
+const qint64 hashNodeBytes = 32;
+
+}
+
+class TrackStore::Less
+{
+public:
+    Less(const QCollatorSortKey *keys, const qint64 *values, Qt::SortOrder order)
+        : keys(keys)
+        , values(values)
+        , descending(order == Qt::DescendingOrder)
+    {
+    }
+
+    bool operator()(int a, int b) const
+    {
+        int result = 0;
+        if (keys) {
+            result = keys[a].compare(keys[b]);
+        } else if (values) {
+            result = values[a] < values[b] ? -1 : (values[b] < values[a] ? 1 : 0);
+        }
+        if (result != 0) {
+            return descending ? result > 0 : result < 0;
+        }
+        return a < b;
+    }
+
+private:
+    const QCollatorSortKey *keys;
+    const qint64 *values;
+    bool descending;
+};
+
+
+TrackStore::TrackStore()
+    : emptyKey(collator.sortKey(QString()))
+    , liveCount(0)
+    , durationTotal(0)
+{
+    configureCollator(collator);
+}
+
+int TrackStore::add(const QString &path, const QString &title, qint64 dateAdded)
+{
+    const int id = titles.size();
+    titles.append(title);
+    artists.append(QString());
+    albums.append(QString());
+    QString directoryPath;
+    QString fileName;
+    PathTable::split(path, &directoryPath, &fileName);
+    const int directory = pathTable.insert(directoryPath);
+    directories.append(directory);
+    fileNames.append(fileName);
+    if (directoryTracks.size() < pathTable.count()) {
+        directoryTracks.resize(pathTable.count());
+    }
+    directoryTracks[directory].append(id);
+    durations.append(0);
+    addedTimes.append(dateAdded);
+    playCounts.append(0);
+    skipCounts.append(0);
+    alive.append(true);
+
+    for (int slot = 0; slot < KeySlotCount; ++slot) {
+        sortKeys[slot].push_back(emptyKey);
+    }
+    markKeysDirty(id);
+
+    const QPair<int, QString> key(directory, fileName);
+    if (!pathIds.contains(key)) {
+        pathIds.insert(key, id);
+    }
+    ++liveCount;
+    return id;
+}
+
+void TrackStore::remove(int id)
+{
+    if (!contains(id)) {
+        return;
+    }
+
+    const QPair<int, QString> key(directories[id], fileNames[id]);
+    if (pathIds.value(key, -1) == id) {
+        pathIds.remove(key);
+    }
+    directoryTracks[directories[id]].removeOne(id);
+    alive[id] = false;
+    durationTotal -= durations[id];
+    durations[id] = 0;
+    titles[id].clear();
+    artists[id].clear();
+    albums[id].clear();
+    directories[id] = -1;
+    fileNames[id].clear();
+    segments.remove(id);
+    for (int slot = 0; slot < KeySlotCount; ++slot) {
+        sortKeys[slot][size_t(id)] = emptyKey;
+    }
+    --liveCount;
+}
+
+void TrackStore::clear()
+{
+    // Tout est remplacé d'un bloc, sans retirer les pistes une à une. Les colonnes
+    // gardent leur longueur : les identifiants déjà distribués restent invalides
+    const int size = alive.size();
+    titles = QVector<QString>(size);
+    artists = QVector<QString>(size);
+    albums = QVector<QString>(size);
+    directories = QVector<int>(size, -1);
+    fileNames = QVector<QString>(size);
+    durations = QVector<qint64>(size, 0);
+    addedTimes = QVector<qint64>(size, 0);
+    playCounts = QVector<qint64>(size, 0);
+    skipCounts = QVector<int>(size, 0);
+    alive = QVector<bool>(size, false);
+    for (int slot = 0; slot < KeySlotCount; ++slot) {
+        std::vector<QCollatorSortKey>(size_t(size), emptyKey).swap(sortKeys[slot]);
+        dirtyKeys[slot].clear();
+        dirtyMarks[slot].clear();
+    }
+    pathTable.clear();
+    directoryTracks.clear();
+    pathIds.clear();
+    segments.clear();
+    liveCount = 0;
+    durationTotal = 0;
+}
+
+bool TrackStore::contains(int id) const
+{
+    return id >= 0 && id < alive.size() && alive[id];
+}
+
+int TrackStore::idForPath(const QString &path) const
+{
+    QString directoryPath;
+    QString fileName;
+    PathTable::split(path, &directoryPath, &fileName);
+    const int directory = pathTable.find(directoryPath);
+    return directory >= 0 ? pathIds.value(qMakePair(directory, fileName), -1) : -1;
+}
+
+int TrackStore::count() const
+{
+    return liveCount;
+}
+
+int TrackStore::capacity() const
+{
+    return alive.size();
+}
+
+QVector<int> TrackStore::ids() const
+{
+    QVector<int> result;
+    result.reserve(liveCount);
+    for (int id = 0; id < alive.size(); ++id) {
+        if (alive[id]) {
+            result.append(id);
+        }
+    }
+    return result;
+}
+
+QString TrackStore::title(int id) const
+{
+    return titles.value(id);
+}
+
+QString TrackStore::artist(int id) const
+{
+    return artists.value(id);
+}
+
+QString TrackStore::album(int id) const
+{
+    return albums.value(id);
+}
+
+QString TrackStore::path(int id) const
+{
+    if (!contains(id)) {
+        return QString();
+    }
+    return pathTable.filePath(directories.at(id), fileNames.at(id));
+}
+
+qint64 TrackStore::duration(int id) const
+{
+    return durations.value(id);
+}
+
+qint64 TrackStore::dateAdded(int id) const
+{
+    return addedTimes.value(id);
+}
+
+qint64 TrackStore::playCount(int id) const
+{
+    return playCounts.value(id);
+}
+
+int TrackStore::skipCount(int id) const
+{
+    return skipCounts.value(id);
+}
+
+qint64 TrackStore::totalDuration() const
+{
+    return durationTotal;
+}
+
+bool TrackStore::hasSegment(int id) const
+{
+    return segments.contains(id);
+}
+
+TrackStore::Segment TrackStore::segment(int id) const
+{
+    return segments.value(id);
+}
+
+QString TrackStore::mediaPath(int id) const
+{
+    QHash<int, Segment>::const_iterator it = segments.constFind(id);
+    return it != segments.constEnd() ? it->file : path(id);
+}
+
+QVector<int> TrackStore::tracksUnder(const QString &directory) const
+{
+    QVector<int> result;
+    const int root = pathTable.find(directory);
+    if (root <= 0) {
+        return result;
+    }
+    for (int node : pathTable.subtree(root)) {
+        if (node < directoryTracks.size()) {
+            result += directoryTracks.at(node);
+        }
+    }
+    return result;
+}
+
+QVector<int> TrackStore::moveDirectory(const QString &from, const QString &to)
+{
+    const int directory = pathTable.find(from);
+    if (directory <= 0) {
+        return QVector<int>();
+    }
+    const QString oldRoot = pathTable.path(directory);
+    const QVector<int> moved = tracksUnder(oldRoot);
+
+    // Les clés (dossier, nom) restent valables : seul l'ordre des chemins est à refaire
+    if (pathTable.move(directory, to)) {
+        for (int id : moved) {
+            markKeyDirty(keySlot(Path), id);
+        }
+        return moved;
+    }
+
+    // Destination déjà connue : les chemins sont repris un par un, tous ou aucun
+    QString newRoot = to;
+    while (newRoot.size() > 1 && newRoot.endsWith('/')) {
+        newRoot.chop(1);
+    }
+    QStringList newPaths;
+    for (int id : moved) {
+        const QString newPath = newRoot + path(id).mid(oldRoot.size());
+        if (idForPath(newPath) >= 0) {
+            return QVector<int>();
+        }
+        newPaths.append(newPath);
+    }
+    for (int i = 0; i < moved.size(); ++i) {
+        setPath(moved.at(i), newPaths.at(i));
+    }
+    return moved;
+}
+
+const QString *TrackStore::textColumn(int column) const
+{
+    switch (column) {
+    case Title:
+        return titles.constData();
+    case Artist:
+        return artists.constData();
+    case Album:
+        return albums.constData();
+    default:
+        return nullptr;
+    }
+}
+
+const qint64 *TrackStore::numberColumn(int column) const
+{
+    return valuesFor(column);
+}
+
+void TrackStore::setTitle(int id, const QString &title)
+{
+    if (contains(id)) {
+        titles[id] = title;
+        markKeysDirty(id);
+    }
+}
+
+void TrackStore::setPath(int id, const QString &path)
+{
+    // Fichier déplacé : même piste, nouvel emplacement
+    if (!contains(id) || idForPath(path) >= 0) {
+        return;
+    }
+    const QPair<int, QString> oldKey(directories[id], fileNames[id]);
+    if (pathIds.value(oldKey, -1) == id) {
+        pathIds.remove(oldKey);
+    }
+    directoryTracks[directories[id]].removeOne(id);
+
+    QString directoryPath;
+    QString fileName;
+    PathTable::split(path, &directoryPath, &fileName);
+    const int directory = pathTable.insert(directoryPath);
+    if (directoryTracks.size() < pathTable.count()) {
+        directoryTracks.resize(pathTable.count());
+    }
+    directories[id] = directory;
+    fileNames[id] = fileName;
+    directoryTracks[directory].append(id);
+    pathIds.insert(qMakePair(directory, fileName), id);
+    markKeysDirty(id);
+}
+
+void TrackStore::setTags(int id, const QString &artist, const QString &album)
+{
+    if (contains(id)) {
+        artists[id] = artist;
+        albums[id] = album;
+        markKeysDirty(id);
+    }
+}
+
+void TrackStore::setDuration(int id, qint64 duration)
+{
+    if (contains(id)) {
+        durationTotal += duration - durations[id];
+        durations[id] = duration;
+    }
+}
+
+void TrackStore::setPlayCount(int id, qint64 count)
+{
+    if (contains(id)) {
+        playCounts[id] = count;
+    }
+}
+
+void TrackStore::setSkipCount(int id, int count)
+{
+    if (contains(id)) {
+        skipCounts[id] = count;
+    }
+}
+
+void TrackStore::setSegment(int id, const Segment &segment)
+{
+    if (contains(id)) {
+        segments.insert(id, segment);
+    }
+}
+
+void TrackStore::sort(QVector<int> &ids, int column, Qt::SortOrder order)
+{
+    std::vector<QCollatorSortKey> *keys = keysFor(column);
+    if (keys) {
+        updateSortKeys(column);
+    }
+    const Less less(keys ? keys->data() : nullptr, valuesFor(column), order);
+
+    const int chunkCount = qBound(1, ids.size() / parallelChunkSize, qMax(1, QThread::idealThreadCount()));
+    int *data = ids.data();
+    if (chunkCount == 1) {
+        std::sort(data, data + ids.size(), less);
+        return;
+    }
+
+    // Chaque morceau est trié sur son thread, puis les morceaux voisins sont
+    // fusionnés deux à deux jusqu'à n'en garder qu'un.
+    QVector<Range> ranges;
+    for (int i = 0; i < chunkCount; ++i) {
+        Range range;
+        range.first = int(qint64(ids.size()) * i / chunkCount);
+        range.last = int(qint64(ids.size()) * (i + 1) / chunkCount);
+        range.middle = range.last;
+        ranges.append(range);
+    }
+    QtConcurrent::blockingMap(ranges, [data, less](const Range &range) {
+        std::sort(data + range.first, data + range.last, less);
+    });
+
+    while (ranges.size() > 1) {
+        QVector<Range> merges;
+        for (int i = 0; i + 1 < ranges.size(); i += 2) {
+            Range range;
+            range.first = ranges[i].first;
+            range.middle = ranges[i].last;
+            range.last = ranges[i + 1].last;
+            merges.append(range);
+        }
+        QtConcurrent::blockingMap(merges, [data, less](const Range &range) {
+            std::inplace_merge(data + range.first, data + range.middle, data + range.last, less);
+        });
+        if (ranges.size() % 2) {
+            merges.append(ranges.last());
+        }
+        ranges = merges;
+    }
+}
+
+void TrackStore::merge(QVector<int> &sorted, const QVector<int> &batch, int column, Qt::SortOrder order)
+{
+    QVector<int> incoming = batch;
+    sort(incoming, column, order);
+
+    std::vector<QCollatorSortKey> *keys = keysFor(column);
+    const Less less(keys ? keys->data() : nullptr, valuesFor(column), order);
+
+    QVector<int> result(sorted.size() + incoming.size());
+    std::merge(sorted.constBegin(), sorted.constEnd(), incoming.constBegin(), incoming.constEnd(), result.begin(), less);
+    sorted.swap(result);
+}
+
+TrackStore::MemoryUsage TrackStore::memoryUsage() const
+{
+    MemoryUsage usage;
+    usage.columns = qint64(titles.capacity() + artists.capacity() + albums.capacity() + fileNames.capacity())
+            * qint64(sizeof(QString))
+            + qint64(directories.capacity() + skipCounts.capacity()) * qint64(sizeof(int))
+            + qint64(directoryTracks.capacity()) * qint64(sizeof(QVector<int>))
+            + qint64(durations.capacity() + addedTimes.capacity() + playCounts.capacity()) * qint64(sizeof(qint64))
+            + alive.capacity()
+            + qint64(pathIds.capacity()) * qint64(sizeof(void *)) + qint64(pathIds.size()) * hashNodeBytes
+            + qint64(segments.capacity()) * qint64(sizeof(void *))
+            + qint64(segments.size()) * (hashNodeBytes + qint64(sizeof(Segment)));
+
+    for (const QVector<int> &tracks : directoryTracks) {
+        usage.columns += qint64(tracks.capacity()) * qint64(sizeof(int));
+    }
+    // Les clés de pathIds partagent les noms de fichier
+    usage.strings = pathTable.memoryUsage();
+
+    for (int slot = 0; slot < KeySlotCount; ++slot) {
+        usage.sortKeys += qint64(sortKeys[slot].capacity()) * qint64(sizeof(QCollatorSortKey))
+                + qint64(dirtyKeys[slot].capacity()) * qint64(sizeof(int))
+                + qint64(dirtyMarks[slot].capacity() / 8);
+    }
+
+    // Longueur des chemins de dossier, calculée une fois par dossier
+    QVector<int> directoryLengths(pathTable.count(), -1);
+    for (int id = 0; id < alive.size(); ++id) {
+        if (!alive.at(id)) {
+            continue;
+        }
+        usage.strings += stringBytes(titles.at(id)) + stringBytes(artists.at(id))
+                + stringBytes(albums.at(id)) + stringBytes(fileNames.at(id));
+        QHash<int, Segment>::const_iterator segment = segments.constFind(id);
+        if (segment != segments.constEnd()) {
+            usage.strings += stringBytes(segment->file);
+        }
+        int &directoryLength = directoryLengths[directories.at(id)];
+        if (directoryLength < 0) {
+            directoryLength = pathTable.pathLength(directories.at(id));
+        }
+        const int lengths[KeySlotCount] = {
+            titles.at(id).size(), artists.at(id).size(), albums.at(id).size(),
+            directoryLength + 1 + fileNames.at(id).size()
+        };
+        for (int slot = 0; slot < KeySlotCount; ++slot) {
+            if (size_t(id) >= dirtyMarks[slot].size() || !dirtyMarks[slot][size_t(id)]) {
+                usage.sortKeys += sortKeyBytes(lengths[slot]);
+            }
+        }
+    }
+    return usage;
+}
+
+void TrackStore::releaseSortKeys(int keepColumn)
+{
+    const QVector<int> live = ids();
+    for (int slot = 0; slot < KeySlotCount; ++slot) {
+        if (slot == keySlot(keepColumn)) {
+            continue;
+        }
+        std::vector<QCollatorSortKey>().swap(sortKeys[slot]);
+        sortKeys[slot].resize(size_t(alive.size()), emptyKey);
+        dirtyKeys[slot] = live;
+        dirtyMarks[slot].assign(size_t(alive.size()), false);
+        for (int id : live) {
+            dirtyMarks[slot][size_t(id)] = true;
+        }
+    }
+}
+
+int TrackStore::keySlot(int column)
+{
+    switch (column) {
+    case Title:
+        return 0;
+    case Artist:
+        return 1;
+    case Album:
+        return 2;
+    case Path:
+        return 3;
+    default:
+        return -1;
+    }
+}
+
+std::vector<QCollatorSortKey> *TrackStore::keysFor(int column)
+{
+    const int slot = keySlot(column);
+    return slot >= 0 ? &sortKeys[slot] : nullptr;
+}
+
+const qint64 *TrackStore::valuesFor(int column) const
+{
+    switch (column) {
+    case Duration:
+        return durations.constData();
+    case DateAdded:
+        return addedTimes.constData();
+    case PlayCount:
+        return playCounts.constData();
+    default:
+        return nullptr;
+    }
+}
+
+void TrackStore::markKeysDirty(int id)
+{
+    for (int slot = 0; slot < KeySlotCount; ++slot) {
+        markKeyDirty(slot, id);
+    }
+}
+
+void TrackStore::markKeyDirty(int slot, int id)
+{
+    std::vector<bool> &marks = dirtyMarks[slot];
+    if (size_t(id) >= marks.size()) {
+        marks.resize(size_t(alive.size()), false);
+    }
+    if (!marks[size_t(id)]) {
+        marks[size_t(id)] = true;
+        dirtyKeys[slot].append(id);
+    }
+}
+
+void TrackStore::updateSortKeys(int column)
+{
+    // Seules les clés de la colonne triée sont calculées
+    const int slot = keySlot(column);
+    QVector<int> &dirty = dirtyKeys[slot];
+    if (dirty.isEmpty()) {
+        return;
+    }
+
+    // QCollator n'est pas réentrant : un collateur par morceau
+    QVector<Range> ranges;
+    const int chunkCount = qBound(1, dirty.size() / 1024, qMax(1, QThread::idealThreadCount()) * 4);
+    for (int i = 0; i < chunkCount; ++i) {
+        Range range;
+        range.first = int(qint64(dirty.size()) * i / chunkCount);
+        range.last = int(qint64(dirty.size()) * (i + 1) / chunkCount);
+        range.middle = range.last;
+        ranges.append(range);
+    }
+
+    const QLocale locale = collator.locale();
+    // Les chemins ne sont reconstruits que le temps de calculer leur clé
+    const QString *texts = textColumn(column);
+    std::vector<QCollatorSortKey> &keys = sortKeys[slot];
+    QtConcurrent::blockingMap(ranges, [this, locale, &dirty, texts, &keys](const Range &range) {
+        QCollator local(locale);
+        configureCollator(local);
+        for (int i = range.first; i < range.last; ++i) {
+            const int id = dirty.at(i);
+            if (alive.at(id)) {
+                keys[size_t(id)] = local.sortKey(texts ? texts[id] : path(id));
+            }
+        }
+    });
+
+    for (int id : dirty) {
+        dirtyMarks[slot][size_t(id)] = false;
+    }
+    dirty.clear();
+}
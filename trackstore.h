@@ -0,0 +1,138 @@
+#ifndef TRACKSTORE_H
+#define TRACKSTORE_H
+
+#include <QString>
+#include <QVector>
+#include <QHash>
+#include <QCollator>
+#include <QPair>
+#include <vector>
+#include "pathtable.h"
+
+// Table des pistes rangée par colonnes. Un identifiant de piste est l'indice
+// de sa ligne dans chaque colonne ; il n'est jamais réutilisé pendant la session.
+// Les chemins sont gardés en (dossier, nom de fichier), dossiers partagés.
+class TrackStore
+{
+public:
+    enum Column {
+        Title = 0,
+        Artist,
+        Album,
+        Duration,
+        Path,
+        DateAdded,
+        PlayCount,
+        ColumnCount
+    };
+
+    // Piste virtuelle d'une feuille CUE : portion d'un fichier audio partagé,
+    // en trames CD (1/75 s)
+    struct Segment {
+        QString file;
+        qint64 start = 0;
+        qint64 end = -1;    // -1 : jusqu'à la fin du fichier
+    };
+
+    TrackStore();
+
+    int add(const QString &path, const QString &title, qint64 dateAdded);
+    void remove(int id);
+    void clear();
+
+    bool contains(int id) const;
+    int idForPath(const QString &path) const;
+    int count() const;
+    int capacity() const;
+    QVector<int> ids() const;
+
+    QString title(int id) const;
+    QString artist(int id) const;
+    QString album(int id) const;
+    QString path(int id) const;
+    qint64 duration(int id) const;
+    qint64 dateAdded(int id) const;
+    qint64 playCount(int id) const;
+    // Pas une colonne affichée : sert au tirage aléatoire sans relire l'historique
+    int skipCount(int id) const;
+    qint64 totalDuration() const;
+
+    bool hasSegment(int id) const;
+    Segment segment(int id) const;
+    // Fichier à ouvrir pour jouer la piste : le fichier partagé d'une piste virtuelle
+    QString mediaPath(int id) const;
+
+    // Pistes d'un dossier et de ses sous-dossiers, sans parcourir la bibliothèque
+    QVector<int> tracksUnder(const QString &directory) const;
+    // Dossier renommé ou déplacé : les chemins de toutes ses pistes changent d'un coup.
+    // Rend les pistes déplacées ; aucune si un de leurs nouveaux chemins est déjà pris
+    QVector<int> moveDirectory(const QString &from, const QString &to);
+
+    // Accès direct aux colonnes, indexées par identifiant (nullptr si la colonne n'est pas
+    // de ce type ; les chemins, reconstruits à la demande, passent par path())
+    const QString *textColumn(int column) const;
+    const qint64 *numberColumn(int column) const;
+
+    void setTitle(int id, const QString &title);
+    void setPath(int id, const QString &path);
+    void setTags(int id, const QString &artist, const QString &album);
+    void setDuration(int id, qint64 duration);
+    void setPlayCount(int id, qint64 count);
+    void setSkipCount(int id, int count);
+    void setSegment(int id, const Segment &segment);
+
+    // Tri parallèle des identifiants, à égalité l'ordre d'insertion est gardé
+    void sort(QVector<int> &ids, int column, Qt::SortOrder order);
+    // Fusionne un lot de nouveaux identifiants dans une liste déjà triée
+    void merge(QVector<int> &sorted, const QVector<int> &batch, int column, Qt::SortOrder order);
+
+    // Octets occupés, estimés à partir des capacités réservées
+    struct MemoryUsage {
+        qint64 columns = 0;
+        qint64 strings = 0;
+        qint64 sortKeys = 0;
+    };
+    MemoryUsage memoryUsage() const;
+    // Libère les clés de tri des autres colonnes, recalculées au prochain tri
+    void releaseSortKeys(int keepColumn);
+
+private:
+    class Less;
+
+    static int keySlot(int column);
+    std::vector<QCollatorSortKey> *keysFor(int column);
+    const qint64 *valuesFor(int column) const;
+    void markKeysDirty(int id);
+    void markKeyDirty(int slot, int id);
+    void updateSortKeys(int column);
+
+    QVector<QString> titles;
+    QVector<QString> artists;
+    QVector<QString> albums;
+    QVector<int> directories;       // -1 pour une piste supprimée
+    QVector<QString> fileNames;
+    QVector<qint64> durations;
+    QVector<qint64> addedTimes;
+    QVector<qint64> playCounts;
+    QVector<int> skipCounts;
+    QVector<bool> alive;
+
+    // Une clé de tri par colonne texte : titre, artiste, album, chemin
+    enum { KeySlotCount = 4 };
+    std::vector<QCollatorSortKey> sortKeys[KeySlotCount];
+    QVector<int> dirtyKeys[KeySlotCount];
+    // Déjà dans dirtyKeys : une piste n'y figure qu'une fois, les morceaux
+    // du calcul parallèle n'écrivent jamais la même clé
+    std::vector<bool> dirtyMarks[KeySlotCount];
+
+    PathTable pathTable;
+    QVector<QVector<int> > directoryTracks;
+    QHash<QPair<int, QString>, int> pathIds;
+    QHash<int, Segment> segments;
+    QCollator collator;
+    QCollatorSortKey emptyKey;
+    int liveCount;
+    qint64 durationTotal;
+};
+
+#endif // TRACKSTORE_H
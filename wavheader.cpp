@@ -0,0 +1,88 @@
+#include "wavheader.h"
+#include <QtEndian>
+
+bool WavHeader::isValid() const
+{
+    return (formatTag == Pcm || formatTag == IeeeFloat)
+            && channels > 0 && sampleRate > 0 && blockAlign > 0 && dataOffset > 0;
+}
+
+qint64 WavHeader::frameCount() const
+{
+    return blockAlign > 0 ? dataSize / blockAlign : 0;
+}
+
+qint64 WavHeader::durationMs() const
+{
+    return sampleRate > 0 ? frameCount() * 1000 / sampleRate : 0;
+}
+
+WavHeader WavHeader::parse(QIODevice *device)
+{
+    WavHeader header;
+    if (!device->seek(0)) {
+        return header;
+    }
+
+    const QByteArray riff = device->read(12);
+    if (riff.size() < 12 || riff.mid(8, 4) != "WAVE") {
+        return header;
+    }
+    header.rf64 = riff.startsWith("RF64");
+    if (!header.rf64 && !riff.startsWith("RIFF")) {
+        return header;
+    }
+
+    // En RF64 les tailles 32 bits valent 0xFFFFFFFF, la vraie taille est dans "ds64"
+    qint64 ds64DataSize = -1;
+    qint64 pos = 12;
+    bool haveFormat = false;
+
+    while (pos + 8 <= device->size()) {
+        if (!device->seek(pos)) {
+            break;
+        }
+        const QByteArray chunk = device->read(8);
+        if (chunk.size() < 8) {
+            break;
+        }
+        const QByteArray id = chunk.left(4);
+        const quint32 size = qFromLittleEndian<quint32>(reinterpret_cast<const uchar *>(chunk.constData() + 4));
+        const qint64 body = pos + 8;
+
+        if (id == "ds64") {
+            const QByteArray ds64 = device->read(24);
+            if (ds64.size() >= 16) {
+                ds64DataSize = qint64(qFromLittleEndian<quint64>(reinterpret_cast<const uchar *>(ds64.constData() + 8)));
+            }
+        } else if (id == "fmt ") {
+            const QByteArray fmt = device->read(qMin<quint32>(size, 40));
+            if (fmt.size() < 16) {
+                return header;
+            }
+            const uchar *data = reinterpret_cast<const uchar *>(fmt.constData());
+            header.formatTag = qFromLittleEndian<quint16>(data);
+            header.channels = qFromLittleEndian<quint16>(data + 2);
+            header.sampleRate = qFromLittleEndian<quint32>(data + 4);
+            header.blockAlign = qFromLittleEndian<quint16>(data + 12);
+            header.bitsPerSample = qFromLittleEndian<quint16>(data + 14);
+            if (header.formatTag == Extensible && fmt.size() >= 26) {
+                // Le sous-format commence par le code de format réel
+                header.formatTag = qFromLittleEndian<quint16>(data + 24);
+            }
+            haveFormat = true;
+        } else if (id == "data") {
+            header.dataOffset = body;
+            header.dataSize = (header.rf64 && size == 0xFFFFFFFFu && ds64DataSize >= 0) ? ds64DataSize : qint64(size);
+            header.dataSize = qMin(header.dataSize, device->size() - body);
+            if (!haveFormat) {
+                header.dataOffset = 0;
+            }
+            break;
+        }
+
+        pos = body + qint64(size) + (size & 1);
+    }
+
+    return header;
+}
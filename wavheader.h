@@ -0,0 +1,31 @@
+#ifndef WAVHEADER_H
+#define WAVHEADER_H
+
+#include <QIODevice>
+
+// En-tête d'un fichier WAV (RIFF ou RF64) : format PCM et position des données.
+struct WavHeader
+{
+    enum Format : quint16 {
+        Pcm = 0x0001,
+        IeeeFloat = 0x0003,
+        Extensible = 0xFFFE
+    };
+
+    quint16 formatTag = 0;
+    quint16 channels = 0;
+    quint32 sampleRate = 0;
+    quint16 blockAlign = 0;
+    quint16 bitsPerSample = 0;
+    qint64 dataOffset = 0;
+    qint64 dataSize = 0;
+    bool rf64 = false;
+
+    bool isValid() const;
+    qint64 frameCount() const;
+    qint64 durationMs() const;
+
+    static WavHeader parse(QIODevice *device);
+};
+
+#endif // WAVHEADER_H
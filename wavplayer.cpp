@@ -0,0 +1,619 @@
+#include "wavplayer.h"
+#include <QAudioOutput>
+#include <QAudioDeviceInfo>
+#include <QSysInfo>
+#include <QtEndian>
+#include <cmath>
+#include <cstring>
+
+#ifdef Q_OS_LINUX
+#include <sys/mman.h>
+#endif
+
+namespace {
+
+// Tampon de sortie par défaut : assez long pour que le système ne réveille le lecteur que rarement
+const int defaultBufferMs = 500;
+// Marge après le dernier tampon avant d'annoncer la fin
+const int endMarginMs = 20;
+// Boucle la plus courte : même le plus long tampon n'en contient qu'un nombre borné de reprises
+const int minLoopMs = 50;
+
+enum SampleKind {
+    Unsupported = -1,
+    UInt8,
+    Int16,
+    Int24,
+    Int32,
+    Float32,
+    Float64
+};
+
+int kindBytes(int kind)
+{
+    static const int bytes[] = { 1, 2, 3, 4, 4, 8 };
+    return bytes[kind];
+}
+
+int sampleKind(const WavHeader &header)
+{
+    // Taille du conteneur : un 24 bits rangé sur 32 se lit comme du 32 bits
+    if (header.channels == 0 || header.blockAlign % header.channels != 0) {
+        return Unsupported;
+    }
+    const int bytes = header.blockAlign / header.channels;
+    if (header.formatTag == WavHeader::IeeeFloat) {
+        return bytes == 4 ? Float32 : (bytes == 8 ? Float64 : Unsupported);
+    }
+    switch (bytes) {
+    case 1:
+        return UInt8;
+    case 2:
+        return Int16;
+    case 3:
+        return Int24;
+    case 4:
+        return Int32;
+    default:
+        return Unsupported;
+    }
+}
+
+QAudioFormat audioFormat(int kind, int sampleRate, int channels, QAudioFormat::Endian order)
+{
+    QAudioFormat format;
+    format.setCodec("audio/pcm");
+    format.setSampleRate(sampleRate);
+    format.setChannelCount(channels);
+    format.setSampleSize(kindBytes(kind) * 8);
+    format.setByteOrder(order);
+    format.setSampleType(kind == UInt8 ? QAudioFormat::UnSignedInt
+                                       : (kind >= Float32 ? QAudioFormat::Float : QAudioFormat::SignedInt));
+    return format;
+}
+
+// Lecture d'un échantillon petit-boutiste, ramené entre -1 et 1
+template <int Kind> float decode(const uchar *p);
+
+template <> inline float decode<UInt8>(const uchar *p)
+{
+    return (int(p[0]) - 128) / 128.0f;
+}
+
+template <> inline float decode<Int16>(const uchar *p)
+{
+    return qFromLittleEndian<qint16>(p) / 32768.0f;
+}
+
+template <> inline float decode<Int24>(const uchar *p)
+{
+    return (int(p[0]) | (int(p[1]) << 8) | (int(qint8(p[2])) << 16)) / 8388608.0f;
+}
+
+template <> inline float decode<Int32>(const uchar *p)
+{
+    return qFromLittleEndian<qint32>(p) / 2147483648.0f;
+}
+
+template <> inline float decode<Float32>(const uchar *p)
+{
+    const quint32 bits = qFromLittleEndian<quint32>(p);
+    float value;
+    std::memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+template <> inline float decode<Float64>(const uchar *p)
+{
+    const quint64 bits = qFromLittleEndian<quint64>(p);
+    double value;
+    std::memcpy(&value, &bits, sizeof(value));
+    return float(value);
+}
+
+// Conversion vers le flottant ou le 16 bits natifs, directement dans le tampon de sortie
+template <int Kind>
+void convert(const uchar *in, qint64 samples, int outputKind, char *out)
+{
+    const int stride = kindBytes(Kind);
+    if (outputKind == Float32) {
+        float *target = reinterpret_cast<float *>(out);
+        for (qint64 i = 0; i < samples; ++i) {
+            target[i] = decode<Kind>(in + i * stride);
+        }
+    } else {
+        qint16 *target = reinterpret_cast<qint16 *>(out);
+        for (qint64 i = 0; i < samples; ++i) {
+            const long value = std::lrint(decode<Kind>(in + i * stride) * 32768.0f);
+            target[i] = qint16(qBound(-32768L, value, 32767L));
+        }
+    }
+}
+
+void convertSamples(int kind, const uchar *in, qint64 samples, int outputKind, char *out)
+{
+    switch (kind) {
+    case UInt8:
+        convert<UInt8>(in, samples, outputKind, out);
+        break;
+    case Int16:
+        convert<Int16>(in, samples, outputKind, out);
+        break;
+    case Int24:
+        convert<Int24>(in, samples, outputKind, out);
+        break;
+    case Int32:
+        convert<Int32>(in, samples, outputKind, out);
+        break;
+    case Float32:
+        convert<Float32>(in, samples, outputKind, out);
+        break;
+    case Float64:
+        convert<Float64>(in, samples, outputKind, out);
+        break;
+    }
+}
+
+}
+
+
+// Source tirée par la sortie audio : lit la projection à la position courante
+class WavPlayer::Source : public QIODevice
+{
+public:
+    explicit Source(WavPlayer *player)
+        : QIODevice(player)
+        , player(player)
+    {
+    }
+
+    bool isSequential() const override
+    {
+        return true;
+    }
+
+protected:
+    qint64 readData(char *data, qint64 maxSize) override
+    {
+        return player->readFrames(data, maxSize);
+    }
+
+    qint64 writeData(const char *, qint64) override
+    {
+        return -1;
+    }
+
+private:
+    WavPlayer *player;
+};
+
+
+WavPlayer::WavPlayer(QObject *parent)
+    : QObject(parent)
+    , map(nullptr)
+    , kind(Unsupported)
+    , outputKind(Unsupported)
+    , outputFrameBytes(0)
+    , output(nullptr)
+    , frames(0)
+    , readFrame(0)
+    , loopStart(-1)
+    , loopEnd(-1)
+    , deliveredFrames(0)
+    , anchorCount(0)
+    , heardAnchors(0)
+    , notifyInterval(1000)
+    , bufferMs(defaultBufferMs)
+    , restarting(false)
+    , probing(false)
+    , currentState(QMediaPlayer::StoppedState)
+    , currentStatus(QMediaPlayer::NoMedia)
+{
+    source = new Source(this);
+    source->open(QIODevice::ReadOnly);
+
+    endTimer.setSingleShot(true);
+    connect(&endTimer, &QTimer::timeout, this, &WavPlayer::finishPlayback);
+}
+
+WavPlayer::~WavPlayer()
+{
+    close();
+}
+
+bool WavPlayer::open(const QString &filePath)
+{
+    close();
+    file.setFileName(filePath);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+    header = WavHeader::parse(&file);
+    kind = header.isValid() ? sampleKind(header) : Unsupported;
+    if (kind == Unsupported || header.frameCount() <= 0) {
+        file.close();
+        return false;
+    }
+
+    // Format d'origine tel quel si possible, sinon flottant, sinon 16 bits
+    const QAudioDeviceInfo device = QAudioDeviceInfo::defaultOutputDevice();
+    const QAudioFormat::Endian hostOrder = QAudioFormat::Endian(QSysInfo::ByteOrder);
+    const int candidates[] = { kind, Float32, Int16 };
+    outputKind = Unsupported;
+    for (int candidate : candidates) {
+        const QAudioFormat format = audioFormat(candidate, int(header.sampleRate), header.channels,
+                                                candidate == kind ? QAudioFormat::LittleEndian : hostOrder);
+        if (device.isFormatSupported(format)) {
+            outputFormat = format;
+            outputKind = candidate;
+            break;
+        }
+    }
+    if (outputKind == Unsupported) {
+        file.close();
+        return false;
+    }
+
+    // Tout le fichier, RF64 de plusieurs gigaoctets compris : les pages sont lues
+    // par le système au fil de la lecture et ne comptent pas dans le tas
+    map = file.map(0, file.size());
+    if (!map) {
+        file.close();
+        return false;
+    }
+#ifdef Q_OS_LINUX
+    posix_madvise(map, size_t(file.size()), POSIX_MADV_SEQUENTIAL);
+#endif
+
+    frames = header.frameCount();
+    outputFrameBytes = kindBytes(outputKind) * header.channels;
+    readFrame = 0;
+
+    output = new QAudioOutput(device, outputFormat, this);
+    output->setNotifyInterval(notifyInterval);
+    connect(output, &QAudioOutput::stateChanged, this, &WavPlayer::outputStateChanged);
+    connect(output, &QAudioOutput::notify, this, &WavPlayer::outputNotify);
+
+    setStatus(QMediaPlayer::LoadedMedia);
+    emit durationChanged(duration());
+    emit positionChanged(0);
+    return true;
+}
+
+void WavPlayer::close()
+{
+    endTimer.stop();
+    if (output) {
+        restarting = true;
+        output->stop();
+        restarting = false;
+        delete output;
+        output = nullptr;
+    }
+    if (map) {
+        file.unmap(map);
+        map = nullptr;
+    }
+    file.close();
+    frames = 0;
+    readFrame = 0;
+    clearLoop();
+    setState(QMediaPlayer::StoppedState);
+    setStatus(QMediaPlayer::NoMedia);
+}
+
+bool WavPlayer::isOpen() const
+{
+    return output != nullptr;
+}
+
+void WavPlayer::play()
+{
+    if (!output) {
+        return;
+    }
+    if (currentStatus == QMediaPlayer::EndOfMedia) {
+        readFrame = 0;
+    }
+    if (output->state() == QAudio::SuspendedState) {
+        output->resume();
+    } else if (output->state() == QAudio::StoppedState) {
+        startOutput();
+    }
+    setState(QMediaPlayer::PlayingState);
+    setStatus(QMediaPlayer::BufferedMedia);
+}
+
+void WavPlayer::pause()
+{
+    if (!output) {
+        return;
+    }
+    if (output->state() == QAudio::ActiveState || output->state() == QAudio::IdleState) {
+        output->suspend();
+    }
+    setState(QMediaPlayer::PausedState);
+}
+
+void WavPlayer::stop()
+{
+    if (!output) {
+        return;
+    }
+    endTimer.stop();
+    restarting = true;
+    output->stop();
+    restarting = false;
+    readFrame = 0;
+    setState(QMediaPlayer::StoppedState);
+    setStatus(QMediaPlayer::LoadedMedia);
+    emit positionChanged(0);
+}
+
+qint64 WavPlayer::position() const
+{
+    return header.sampleRate > 0 ? framePosition() * 1000 / header.sampleRate : 0;
+}
+
+qint64 WavPlayer::duration() const
+{
+    return header.sampleRate > 0 ? frames * 1000 / header.sampleRate : 0;
+}
+
+void WavPlayer::setPosition(qint64 position)
+{
+    setFramePosition(position * header.sampleRate / 1000);
+}
+
+qint64 WavPlayer::framePosition() const
+{
+    if (!output || output->state() == QAudio::StoppedState) {
+        return readFrame;
+    }
+    // Trame du fichier jouée à cet endroit du flux : celle de la dernière reprise atteinte
+    const qint64 played = playedFrames();
+    for (int i = anchorCount - 1; i >= qMax(0, anchorCount - maxAnchors); --i) {
+        const Anchor &anchor = anchors[i % maxAnchors];
+        if (anchor.stream <= played) {
+            return qBound<qint64>(0, anchor.frame + played - anchor.stream, frames);
+        }
+    }
+    return anchors[qMax(0, anchorCount - maxAnchors) % maxAnchors].frame;
+}
+
+qint64 WavPlayer::frameCount() const
+{
+    return frames;
+}
+
+void WavPlayer::setFramePosition(qint64 frame)
+{
+    if (!output) {
+        return;
+    }
+    endTimer.stop();
+    readFrame = qBound<qint64>(0, frame, frames);
+
+    // Le son déjà confié à la sortie est abandonné : le déplacement s'entend aussitôt
+    const QAudio::State outputState = output->state();
+    if (outputState == QAudio::ActiveState || outputState == QAudio::IdleState) {
+        restartOutput();
+    } else if (outputState == QAudio::SuspendedState) {
+        restarting = true;
+        output->stop();
+        restarting = false;
+    }
+    if (currentStatus == QMediaPlayer::EndOfMedia) {
+        setStatus(QMediaPlayer::LoadedMedia);
+    }
+    emit positionChanged(position());
+}
+
+int WavPlayer::sampleRate() const
+{
+    return int(header.sampleRate);
+}
+
+void WavPlayer::setLoop(qint64 startFrame, qint64 endFrame)
+{
+    startFrame = qBound<qint64>(0, startFrame, frames);
+    endFrame = qBound<qint64>(0, endFrame, frames);
+    if (endFrame - startFrame < qint64(header.sampleRate) * minLoopMs / 1000) {
+        clearLoop();
+        return;
+    }
+    loopStart = startFrame;
+    loopEnd = endFrame;
+
+    // Déjà livré au-delà de la fin : la sortie repart de ce qui est entendu, ou du début
+    if (readFrame > loopEnd) {
+        const qint64 played = framePosition();
+        setFramePosition(played < loopEnd ? played : loopStart);
+    }
+}
+
+void WavPlayer::clearLoop()
+{
+    loopStart = -1;
+    loopEnd = -1;
+}
+
+bool WavPlayer::isLooping() const
+{
+    return loopEnd >= 0;
+}
+
+QMediaPlayer::State WavPlayer::state() const
+{
+    return currentState;
+}
+
+QMediaPlayer::MediaStatus WavPlayer::mediaStatus() const
+{
+    return currentStatus;
+}
+
+void WavPlayer::setNotifyInterval(int milliseconds)
+{
+    notifyInterval = milliseconds;
+    if (output) {
+        output->setNotifyInterval(milliseconds);
+    }
+}
+
+bool WavPlayer::isConverting() const
+{
+    return output && outputKind != kind;
+}
+
+void WavPlayer::setBufferDuration(int milliseconds)
+{
+    bufferMs = milliseconds;
+}
+
+void WavPlayer::setProbing(bool enabled)
+{
+    probing = enabled;
+}
+
+qint64 WavPlayer::memoryUsage() const
+{
+    return output ? output->bufferSize() : 0;
+}
+
+void WavPlayer::outputStateChanged(QAudio::State outputState)
+{
+    if (restarting) {
+        return;
+    }
+
+    if (outputState == QAudio::IdleState && readFrame >= frames && loopEnd < 0 && !endTimer.isActive()) {
+        // Le dernier tampon est encore dans la sortie : la fin est annoncée une fois joué
+        const qint64 queued = qMax(0, output->bufferSize() - output->bytesFree());
+        const qint64 bytesPerSecond = qint64(header.sampleRate) * outputFrameBytes;
+        endTimer.start(int(queued * 1000 / bytesPerSecond) + endMarginMs);
+    } else if (outputState == QAudio::StoppedState && output->error() != QAudio::NoError) {
+        // Périphérique perdu ou refusé en cours de route
+        setState(QMediaPlayer::StoppedState);
+        setStatus(QMediaPlayer::InvalidMedia);
+    }
+}
+
+void WavPlayer::outputNotify()
+{
+    // Reprises livrées depuis la dernière notification et désormais jouées
+    const qint64 played = playedFrames();
+    const int heard = heardAnchors;
+    heardAnchors = qMax(heardAnchors, anchorCount - maxAnchors);
+    while (heardAnchors + 1 < anchorCount && anchors[(heardAnchors + 1) % maxAnchors].stream <= played) {
+        ++heardAnchors;
+    }
+    if (heardAnchors > heard) {
+        emit looped();
+    }
+    emit positionChanged(position());
+}
+
+void WavPlayer::finishPlayback()
+{
+    restarting = true;
+    output->stop();
+    restarting = false;
+    readFrame = frames;
+    setState(QMediaPlayer::StoppedState);
+    setStatus(QMediaPlayer::EndOfMedia);
+    emit positionChanged(duration());
+}
+
+qint64 WavPlayer::readFrames(char *data, qint64 maxSize)
+{
+    if (!map) {
+        return 0;
+    }
+
+    const qint64 capacity = maxSize / qMax(1, outputFrameBytes);
+    qint64 done = 0;
+    while (done < capacity) {
+        // Fin de boucle : le début suit dans le même tampon, à l'échantillon près
+        if (loopEnd >= 0 && readFrame >= loopEnd) {
+            readFrame = loopStart;
+            addAnchor(deliveredFrames + done, loopStart);
+        }
+        const qint64 count = qMin(capacity - done, (loopEnd >= 0 ? loopEnd : frames) - readFrame);
+        if (count <= 0) {
+            break;
+        }
+
+        // Simple arithmétique sur la projection : pas d'appel système par tampon
+        const uchar *in = map + header.dataOffset + readFrame * header.blockAlign;
+        char *out = data + done * outputFrameBytes;
+        if (outputKind == kind) {
+            std::memcpy(out, in, size_t(count * outputFrameBytes));
+        } else {
+            convertSamples(kind, in, count * header.channels, outputKind, out);
+        }
+        readFrame += count;
+        done += count;
+    }
+    deliveredFrames += done;
+
+    const qint64 bytes = done * outputFrameBytes;
+    if (bytes <= 0) {
+        return 0;
+    }
+    if (probing) {
+        emit audioBufferProbed(QAudioBuffer(QByteArray(data, int(bytes)), outputFormat));
+    }
+    return bytes;
+}
+
+qint64 WavPlayer::playedFrames() const
+{
+    // Ce qui a été confié à la sortie, moins ce qu'elle n'a pas encore joué
+    const qint64 processed = output->processedUSecs() * header.sampleRate / 1000000;
+    const qint64 queued = qMax(0, output->bufferSize() - output->bytesFree()) / outputFrameBytes;
+    return qBound<qint64>(0, processed - queued, deliveredFrames);
+}
+
+void WavPlayer::addAnchor(qint64 stream, qint64 frame)
+{
+    Anchor &anchor = anchors[anchorCount % maxAnchors];
+    anchor.stream = stream;
+    anchor.frame = frame;
+    ++anchorCount;
+}
+
+void WavPlayer::restartOutput()
+{
+    restarting = true;
+    output->stop();
+    startOutput();
+    restarting = false;
+}
+
+void WavPlayer::startOutput()
+{
+    // La taille du tampon ne se règle qu'à l'arrêt
+    output->setBufferSize(int(qint64(header.sampleRate) * outputFrameBytes * bufferMs / 1000));
+    deliveredFrames = 0;
+    anchorCount = 0;
+    heardAnchors = 0;
+    addAnchor(0, readFrame);
+    output->start(source);
+}
+
+void WavPlayer::setState(QMediaPlayer::State value)
+{
+    if (currentState != value) {
+        currentState = value;
+        emit stateChanged(value);
+    }
+}
+
+void WavPlayer::setStatus(QMediaPlayer::MediaStatus value)
+{
+    if (currentStatus != value) {
+        currentStatus = value;
+        emit mediaStatusChanged(value);
+    }
+}
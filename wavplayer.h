@@ -0,0 +1,130 @@
+#ifndef WAVPLAYER_H
+#define WAVPLAYER_H
+
+#include <QObject>
+#include <QFile>
+#include <QTimer>
+#include <QAudio>
+#include <QAudioFormat>
+#include <QAudioBuffer>
+#include <QMediaPlayer>
+#include "wavheader.h"
+
+class QAudioOutput;
+
+// Lecture directe des WAV PCM (RIFF ou RF64) : le fichier est projeté en
+// mémoire et la sortie audio tire ses échantillons de la projection, convertis
+// seulement si le périphérique refuse le format d'origine. Un déplacement
+// n'est qu'un changement d'indice ; aucune allocation pendant la lecture.
+class WavPlayer : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit WavPlayer(QObject *parent = nullptr);
+    ~WavPlayer();
+
+    // Faux si le fichier n'est pas un WAV PCM que la sortie audio peut jouer
+    bool open(const QString &filePath);
+    void close();
+    bool isOpen() const;
+
+    void play();
+    void pause();
+    void stop();
+
+    // Positions en millisecondes, comme QMediaPlayer
+    qint64 position() const;
+    qint64 duration() const;
+    void setPosition(qint64 position);
+
+    // Positions exactes, en trames d'échantillons
+    qint64 framePosition() const;
+    qint64 frameCount() const;
+    void setFramePosition(qint64 frame);
+    int sampleRate() const;
+
+    // Boucle entre deux trames, fin exclue : la lecture reprend au début dans le
+    // même tampon, sans silence ni rechargement. Ignorée si elle est trop courte
+    void setLoop(qint64 startFrame, qint64 endFrame);
+    void clearLoop();
+    bool isLooping() const;
+
+    QMediaPlayer::State state() const;
+    QMediaPlayer::MediaStatus mediaStatus() const;
+    void setNotifyInterval(int milliseconds);
+    // Longueur du tampon de sortie : plus long, moins de réveils, déplacements plus lents à s'entendre.
+    // Pris en compte au prochain démarrage de la sortie (piste, déplacement)
+    void setBufferDuration(int milliseconds);
+    bool isConverting() const;
+
+    // Copie des tampons joués pour le visualiseur, coûteuse : seulement à la demande
+    void setProbing(bool enabled);
+
+    // Tampon de la sortie audio ; le fichier projeté est compté par le système
+    qint64 memoryUsage() const;
+
+signals:
+    void positionChanged(qint64 position);
+    void durationChanged(qint64 duration);
+    void stateChanged(QMediaPlayer::State state);
+    void mediaStatusChanged(QMediaPlayer::MediaStatus status);
+    void audioBufferProbed(const QAudioBuffer &buffer);
+    // Une reprise de la boucle vient d'être entendue
+    void looped();
+
+private slots:
+    void outputStateChanged(QAudio::State outputState);
+    void outputNotify();
+    void finishPlayback();
+
+private:
+    class Source;
+    // Le banc d'essai tire les trames comme la sortie audio, sans carte son
+    friend struct WavPlayerBench;
+
+    // Reprise dans le flux confié à la sortie : à partir de la trame stream du
+    // flux, la sortie joue la trame frame du fichier
+    struct Anchor {
+        qint64 stream;
+        qint64 frame;
+    };
+    // Assez pour le plus long tampon parcouru par la plus courte boucle
+    enum { maxAnchors = 64 };
+
+    qint64 readFrames(char *data, qint64 maxSize);
+    qint64 playedFrames() const;
+    void addAnchor(qint64 stream, qint64 frame);
+    void restartOutput();
+    void startOutput();
+    void setState(QMediaPlayer::State value);
+    void setStatus(QMediaPlayer::MediaStatus value);
+
+    QFile file;
+    uchar *map;
+    WavHeader header;
+    int kind;               // genre d'échantillon du fichier, voir wavplayer.cpp
+    QAudioFormat outputFormat;
+    int outputKind;
+    int outputFrameBytes;
+    QAudioOutput *output;
+    Source *source;
+    QTimer endTimer;
+
+    qint64 frames;
+    qint64 readFrame;       // prochaine trame livrée à la sortie
+    qint64 loopStart;       // -1 sans boucle
+    qint64 loopEnd;
+    qint64 deliveredFrames; // trames livrées depuis le dernier démarrage de la sortie
+    Anchor anchors[maxAnchors];
+    int anchorCount;        // depuis le dernier démarrage, la première est le démarrage lui-même
+    int heardAnchors;
+    int notifyInterval;
+    int bufferMs;
+    bool restarting;
+    bool probing;
+    QMediaPlayer::State currentState;
+    QMediaPlayer::MediaStatus currentStatus;
+};
+
+#endif // WAVPLAYER_H